@@ -11,21 +11,31 @@ BIN_DIR="bin"
 OUTPUT_SHADER_DIR="${BIN_DIR}/shaders"
 OBJ_DIR="${BIN_DIR}/o"
 
+TEST_DIR="tests"
+TEST_BIN_DIR="${BIN_DIR}/tests"
+
 C_SOURCES=$(find "${SRC_DIR}" -name "*.c")
 LIB_SOURCES=$(find "${LIBS_DIR}" -name "*.c")
 SHADER_SRCS=$(find "${SHADER_DIR}" -name "*.vert" -o -name "*.frag")
 
 CFLAGS=" -g -Wall -Wextra -Wshadow -Wpedantic -DDEBUG=1 -DOS_LINUX=1 -std=gnu17"
-LDFLAGS="-lglfw -lvulkan -lm"
+# Extra flags from the environment, ie. EXTRA_CFLAGS="-DMEMORY_TRACKING=1" ./build.sh --full
+CFLAGS+=" ${EXTRA_CFLAGS:-}"
+LDFLAGS="-lglfw -lvulkan -lm -lpthread"
 
 OBJ_FILES=()
 
-# Check if full rebuild is requested
+# Check if full rebuild is requested, and if the tests should run after building
 FULL_REBUILD=1
-if [[ "$#" -gt 0 && "$1" == "--full" ]]; then
-	FULL_REBUILD=0
-	echo "Full rebuild..."
-fi
+RUN_TESTS=1
+for ARG in "$@"; do
+	if [[ "${ARG}" == "--full" ]]; then
+		FULL_REBUILD=0
+		echo "Full rebuild..."
+	elif [[ "${ARG}" == "--test" ]]; then
+		RUN_TESTS=0
+	fi
+done
 
 mkdir -p "${BIN_DIR}"
 mkdir -p "${OUTPUT_SHADER_DIR}"
@@ -91,3 +101,40 @@ else
 fi
 
 echo "Build Complete... (${BIN_DIR}/${PROJECT_NAME})"
+
+# Tests ------------------------------------------------------------------------
+
+# Each tests/*.c is its own program, built once per instruction set with the SIMD paths on. No FMA
+# contraction, so the scalar references do exactly the multiplies and adds the kernels do. They all
+# link against the sources that don't need a window or a device
+mkdir -p "${TEST_BIN_DIR}"
+TEST_CFLAGS="${CFLAGS} -O2 -DLINEAR_ALGEBRA_SIMD -ffp-contract=off"
+TEST_LDFLAGS="-lm -lpthread"
+TEST_TARGETS=("sse41:-msse4.1" "avx2:-mavx2")
+TEST_SOURCES=$(find "${TEST_DIR}" -name "*.c")
+TEST_LINK_SOURCES=$(find "${SRC_DIR}/core" "${SRC_DIR}/os" -name "*.c" ! -name "window.c")
+TEST_LINK_SOURCES+=" ${SRC_DIR}/game/transform.c"
+TEST_BINS=()
+
+for TEST in ${TEST_SOURCES}; do
+	for TARGET in "${TEST_TARGETS[@]}"; do
+		TEST_BIN="${TEST_BIN_DIR}/$(basename ${TEST} .c)_${TARGET%%:*}"
+		TEST_BINS+=("${TEST_BIN}")
+
+		# Any change to the code under test counts too
+		if needs_rebuild "${TEST}" "${TEST_BIN}" ||
+			[[ -n $(find "${SRC_DIR}" -name "*.[ch]" -newer "${TEST_BIN}") ]]; then
+			echo "Compiling ${TEST} (${TARGET%%:*}) ..."
+			gcc ${TEST_CFLAGS} ${TARGET#*:} -I${SRC_DIR} "${TEST}" ${TEST_LINK_SOURCES} ${TEST_LDFLAGS} \
+				-o "${TEST_BIN}"
+		else
+			echo "${TEST_BIN} up to date"
+		fi
+	done
+done
+
+if [[ ${RUN_TESTS} == 0 ]]; then
+	for TEST_BIN in "${TEST_BINS[@]}"; do
+		"${TEST_BIN}"
+	done
+fi
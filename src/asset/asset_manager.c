@@ -1,35 +1,151 @@
 #include "asset/asset_manager.h"
+#include "asset/asset_obj.h"
 
 #include "core/arena.h"
 #include "core/linear_algebra.h"
 #include "core/log.h"
 #include "core/thread_context.h"
+#include "os/os.h"
 #include "render/render_mesh.h"
 
 #include <errno.h>
-#include <stdio.h>
 
 void ass_manager_init(Arena *arena, ASS_Manager *ass) {
-  ass->entry_pool = pool_make_type(ASS_MAX_ENTRIES, ASS_Entry);
-  ass->mesh_pool = pool_make_type(ASS_MAX_MESHES, RND_Mesh);
+  ass->entries = packed_array_make_type(ASS_MAX_ENTRIES, ASS_Entry);
+  ass->index = arena_calloc(arena, ASS_INDEX_CAPACITY, ASS_Index_Slot);
+  ass->mesh_pool = shared_pool_make_type(ASS_MAX_MESHES, RND_Mesh);
+  packed_array_set_tag(&ass->entries, "asset_entries");
+  shared_pool_set_tag(&ass->mesh_pool, "asset_mesh_pool");
 }
 
 void ass_manager_free(ASS_Manager *ass, RND_Context *rc) {
-  // Free meshes
-  u32 mesh_last = 0;
-  RND_Mesh *meshes = pool_as_array(&ass->mesh_pool, &mesh_last);
-  u32 entry_last = 0;
-  ASS_Entry *entries = pool_as_array(&ass->entry_pool, &entry_last);
-  for (u32 i = 0; i < mesh_last; i++) {
-    rnd_mesh_free(rc, &meshes[i]);
+  // Free meshes, every live one belongs to exactly one entry, popped ones were already freed
+  u32 entry_count = 0;
+  ASS_Entry *entries = packed_array_as_array(&ass->entries, &entry_count);
+  for (u32 i = 0; i < entry_count; i++) {
+    if (entries[i].type == ASS_TYPE_MESH) {
+      rnd_mesh_free(rc, entries[i].mesh_data);
+    }
   }
-  pool_free(&ass->mesh_pool);
+  shared_pool_free(&ass->mesh_pool);
 
   // Free asset table
-  pool_free(&ass->entry_pool);
+  packed_array_free(&ass->entries);
+}
+
+// Index -----------------------------------------------------------------------
+
+translation_local u64 ass_name_hash(const char *name) {
+  // 0 is the empty slot marker
+  u64 hash = hash_string(name);
+  return hash != 0 ? hash : 1;
+}
+
+translation_local void ass_index_insert(ASS_Manager *ass, u64 hash, ASS_Handle handle) {
+  u32 mask = ASS_INDEX_CAPACITY - 1;
+  u32 slot = hash & mask;
+  while (ass->index[slot].hash != 0) {
+    slot = (slot + 1) & mask;
+  }
+
+  ass->index[slot] = (ASS_Index_Slot){
+      .hash = hash,
+      .entry = handle,
+  };
+}
+
+// Backward shift instead of tombstones, anything after the hole that would have landed at or
+// before it gets pulled back, so probes never have to walk over dead slots
+translation_local void ass_index_remove(ASS_Manager *ass, u64 hash, ASS_Handle handle) {
+  u32 mask = ASS_INDEX_CAPACITY - 1;
+  u32 hole = hash & mask;
+  while (ass->index[hole].entry.index != handle.index ||
+         ass->index[hole].entry.generation != handle.generation) {
+    ASSERT(ass->index[hole].hash != 0, "Asset handle %u missing from the index", handle.index);
+    hole = (hole + 1) & mask;
+  }
+
+  for (u32 next = (hole + 1) & mask; ass->index[next].hash != 0; next = (next + 1) & mask) {
+    u32 home = ass->index[next].hash & mask;
+    if (((next - home) & mask) >= ((next - hole) & mask)) {
+      ass->index[hole] = ass->index[next];
+      hole = next;
+    }
+  }
+  ass->index[hole] = (ASS_Index_Slot){0};
+}
+
+ASS_Handle ass_find_existing(ASS_Manager *ass, const char *name) {
+  if (name == NULL)
+    return POOL_HANDLE_NIL;
+
+  u64 hash = ass_name_hash(name);
+  u32 mask = ASS_INDEX_CAPACITY - 1;
+  for (u32 slot = hash & mask; ass->index[slot].hash != 0; slot = (slot + 1) & mask) {
+    // Full hash match first so the string compare almost always succeeds when we get to it
+    if (ass->index[slot].hash == hash &&
+        strcmp(ass_get(ass, ass->index[slot].entry)->name, name) == 0)
+      return ass->index[slot].entry;
+  }
+
+  return POOL_HANDLE_NIL;
+}
+
+// New entry with one reference, findable by name from here on
+translation_local ASS_Handle ass_entry_make_mesh(ASS_Manager *ass, const char *name,
+                                                 RND_Mesh *mesh) {
+  ASSERT(strlen(name) < ASS_MAX_FILE_NAME, "Asset name (%s) too long", name);
+
+  ASS_Handle handle = POOL_HANDLE_NIL;
+  ASS_Entry *entry = packed_array_alloc(&ass->entries, &handle);
+  entry->mesh_data = mesh;
+  entry->reference_count++;
+  entry->type = ASS_TYPE_MESH;
+  entry->id = 0;
+  strcpy(entry->name, name);
+  entry->name_hash = ass_name_hash(name);
+
+  ass_index_insert(ass, entry->name_hash, handle);
+
+  return handle;
+}
+
+// Out of the index and the entries, every handle to it goes stale
+translation_local void ass_entry_remove(ASS_Manager *ass, ASS_Handle handle) {
+  ass_index_remove(ass, ass_get(ass, handle)->name_hash, handle);
+  packed_array_pop(&ass->entries, handle);
 }
 
-void ass_free_entry(ASS_Manager *manager, RND_Context *render_context, ASS_Entry *asset_entry) {
+// Another reference to something already loaded
+translation_local ASS_Handle ass_entry_reuse(ASS_Manager *ass, ASS_Handle handle) {
+  ASS_Entry *existing = ass_get(ass, handle);
+  existing->reference_count++;
+  LOG_DEBUG("Asset (%s) has been reused: reference count = %u", existing->name,
+            existing->reference_count);
+
+  return handle;
+}
+
+ASS_Entry *ass_get(ASS_Manager *ass, ASS_Handle handle) {
+  return packed_array_get(&ass->entries, handle);
+}
+
+void ass_resolve_meshes(ASS_Manager *ass, const ASS_Handle *handles, u32 count,
+                        RND_Mesh **out_meshes) {
+  for (u32 i = 0; i < count; i++) {
+    ASS_Entry *entry = packed_array_get(&ass->entries, handles[i]);
+    out_meshes[i] = entry != NULL && entry->type == ASS_TYPE_MESH ? entry->mesh_data : NULL;
+  }
+}
+
+void ass_free_entry(ASS_Manager *manager, RND_Context *render_context, ASS_Handle handle) {
+  ASS_Entry *asset_entry = ass_get(manager, handle);
+  if (asset_entry == NULL) {
+    LOG_ERROR("Tried to free stale asset handle %u (generation %u)", handle.index,
+              handle.generation);
+    return;
+  }
+
   switch (asset_entry->type) {
   case ASS_TYPE_UNKOWN:
     LOG_ERROR("Tried to free asset entry of unkown type");
@@ -57,7 +173,7 @@ void ass_free_entry(ASS_Manager *manager, RND_Context *render_context, ASS_Entry
     case ASS_TYPE_MESH:
       ASSERT(asset_entry->mesh_data != NULL, "Tried to free unallocated asset");
       rnd_mesh_free(render_context, asset_entry->mesh_data);
-      pool_pop(&manager->mesh_pool, asset_entry->mesh_data);
+      shared_pool_pop(&manager->mesh_pool, asset_entry->mesh_data);
       LOG_DEBUG("Asset (%s) has no more references, freeing pool spot", asset_entry->name);
       break;
 
@@ -69,185 +185,64 @@ void ass_free_entry(ASS_Manager *manager, RND_Context *render_context, ASS_Entry
       break;
     }
 
-    pool_pop(&manager->entry_pool, asset_entry);
+    ass_entry_remove(manager, handle);
   }
 }
 
-// Check if we've already loaded this file
-ASS_Entry *ass_find_existing(ASS_Manager *ass, char *name) {
-  ASS_Entry *entry = NULL;
+// Stand in for meshes that couldn't be loaded
+translation_local ASS_Handle ass_load_default_cube(ASS_Manager *ass, RND_Context *rc) {
+  // Check if we've already loaded the default cube
+  ASS_Handle loaded_cube = ass_find_existing(ass, "default_cube");
+  if (loaded_cube.generation != 0)
+    return ass_entry_reuse(ass, loaded_cube);
 
-  // TODO(ss): This is not going to scale, probably need hash table
-  if (name != NULL) {
+  // First time an invalid file was loaded, load the default cube into memory
+  RND_Mesh *mesh = shared_pool_alloc(&ass->mesh_pool);
+  rnd_mesh_default_cube(rc, mesh);
 
-    u32 entries_last = 0;
-    ASS_Entry *entries = pool_as_array(&ass->entry_pool, &entries_last);
-    for (u32 i = 0; i < entries_last; i++) {
-      if (strcmp(entries[i].name, name) == 0) {
-        entry = &entries[i];
-        break;
-      }
-    }
-  }
-
-  return entry;
+  return ass_entry_make_mesh(ass, "default_cube", mesh);
 }
 
-ASS_Entry *ass_load_mesh_obj(ASS_Manager *ass, RND_Context *rc, char *file_name) {
+ASS_Handle ass_load_mesh_obj(ASS_Manager *ass, RND_Context *rc, char *file_name) {
   // Check if we already loaded this
-  ASS_Entry *existing = ass_find_existing(ass, file_name);
-  if (existing != NULL) {
-    existing->reference_count++;
-    LOG_DEBUG("Asset (%s) has been reused: reference count = %u", existing->name,
-              existing->reference_count);
-    return existing;
-  }
+  ASS_Handle existing = ass_find_existing(ass, file_name);
+  if (existing.generation != 0)
+    return ass_entry_reuse(ass, existing);
 
-  FILE *obj_file = fopen(file_name, "rb");
-
-  if (obj_file == NULL) {
+  OS_File_Map file;
+  if (!os_file_map(file_name, &file)) {
     LOG_ERROR("Failed to open .obj file \"%s\", (%s)... loading default cube", file_name,
               strerror(errno));
-
-    // Check if we've already loaded the default cube
-    ASS_Entry *loaded_cube = ass_find_existing(ass, "default_cube");
-    if (loaded_cube != NULL) {
-      loaded_cube->reference_count++;
-      LOG_DEBUG("Asset (%s) has been reused: reference count = %u", loaded_cube->name,
-                loaded_cube->reference_count);
-      return loaded_cube;
-    }
-
-    // First time an invalid file was loaded, load the default cube into memory
-    RND_Mesh *mesh = pool_alloc(&ass->mesh_pool);
-    rnd_mesh_default_cube(rc, mesh);
-    ASS_Entry *entry = pool_alloc(&ass->entry_pool);
-    entry->mesh_data = mesh;
-    entry->reference_count++;
-    entry->type = ASS_TYPE_MESH;
-    entry->id = 0;
-    strcpy(entry->name, "default_cube");
-
-    return entry;
-  }
-
-  // HACK(ss): 2 Pass approach, so I can just use the scratch pad bump allocator and allocate
-  // upfront
-
-  char line[512];
-  u32 vertex_count = 0;
-  u32 index_count = 0;
-  u32 uv_count = 0;
-  u32 normal_count = 0;
-  while (fgets(line, 512, obj_file) != NULL) {
-    if (line[0] == '\0') // Empty
-      continue;
-    if (line[0] == '#') // Comment
-      continue;
-
-    if (line[0] == 'v' && line[1] == ' ') { // Vertices
-      vertex_count++;
-    } else if (line[0] == 'f' && line[1] == ' ') { // Face Indices
-      index_count += 3;
-    } else if (line[0] == 'v' && line[1] == 't') {
-      uv_count++;
-    } else if (line[0] == 'v' && line[1] == 'n') {
-      normal_count++;
-    }
+    return ass_load_default_cube(ass, rc);
   }
-  rewind(obj_file);
 
+  // Straight out of the page cache, no copying it into a buffer first
   Scratch scratch = thread_get_scratch();
-
-  RND_Vertex *vertices = arena_calloc(scratch.arena, vertex_count, RND_Vertex);
-  u32 vertex_current_index = 0;
-
-  u32 *indices = arena_calloc(scratch.arena, index_count, u32);
-  u32 index_current_index = 0;
-
-  vec3 *normals = arena_calloc(scratch.arena, normal_count, vec3);
-  u32 normal_current_index = 0;
-
-  vec2 *uvs = arena_calloc(scratch.arena, normal_count, vec2);
-  u32 uv_current_index = 0;
-
-  while (fgets(line, 512, obj_file) != NULL) {
-    if (line[0] == '\0') // Empty
-      continue;
-    if (line[0] == '#') // Comment
-      continue;
-
-    // Real stuff
-    if (line[0] == 'v' && line[1] == ' ') { // Vertices
-      vec3 obj_vertex;
-      if (!sscanf(line, "v %f %f %f", &obj_vertex.x, &obj_vertex.y, &obj_vertex.z)) {
-        LOG_ERROR("Error reading vertex data from .obj file (%s)", file_name);
-      }
-
-      vertices[vertex_current_index].position = obj_vertex;
-      vertices[vertex_current_index].color = vec3(1.0f, 0.5f, 0.2f); // Default
-      vertex_current_index++;
-    } else if (line[0] == 'v' && line[1] == 't') { // Vertex UV's
-      vec2 uv_vertex;
-      if (!sscanf(line, "vt %f %f", &uv_vertex.x, &uv_vertex.y)) {
-        LOG_ERROR("Error reading vertex data from .obj file (%s)", file_name);
-      }
-
-      uvs[uv_current_index] = uv_vertex;
-      uv_current_index++;
-    } else if (line[0] == 'v' && line[1] == 'n') {
-      vec3 normal;
-      if (!sscanf(line, "vn %f %f %f", &normal.x, &normal.y, &normal.z)) {
-        LOG_ERROR("Error reading vertex data from .obj file (%s)", file_name);
-      }
-
-      normals[normal_current_index] = normal;
-      normal_current_index++;
-    } else if (line[0] == 'f' && line[1] == ' ') { // Face Indices
-      u32 vertex_indices[3];
-      u32 texture_indices[3];
-      u32 normal_indices[3];
-
-      if (!sscanf(line, "f %u/%u/%u %u/%u/%u %u/%u/%u", &vertex_indices[0], &texture_indices[0],
-                  &normal_indices[0], &vertex_indices[1], &texture_indices[1], &normal_indices[1],
-                  &vertex_indices[2], &texture_indices[2], &normal_indices[2])) {
-        LOG_ERROR("Error reading vertex indice data from .obj file (%s)", file_name);
-      }
-
-      // Adjusting for the fact .obj indices start at 1
-      indices[index_current_index + 0] = vertex_indices[0] - 1;
-      indices[index_current_index + 1] = vertex_indices[1] - 1;
-      indices[index_current_index + 2] = vertex_indices[2] - 1;
-      index_current_index += 3;
-
-      vertices[vertex_indices[0] - 1].uv = uvs[texture_indices[0] - 1];
-      vertices[vertex_indices[1] - 1].uv = uvs[texture_indices[1] - 1];
-      vertices[vertex_indices[2] - 1].uv = uvs[texture_indices[2] - 1];
-
-      vertices[vertex_indices[0] - 1].normal = normals[normal_indices[0] - 1];
-      vertices[vertex_indices[1] - 1].normal = normals[normal_indices[1] - 1];
-      vertices[vertex_indices[2] - 1].normal = normals[normal_indices[2] - 1];
-    }
+  ASS_OBJ_Mesh obj = ass_obj_parse(scratch.arena, file.data, file.size, file_name);
+  os_file_unmap(&file);
+
+  // Every face was malformed (or there were none), an empty vertex buffer is no use to anyone
+  if (obj.index_count == 0) {
+    LOG_ERROR("No faces loaded from .obj file \"%s\" (%u malformed lines)... loading default cube",
+              file_name, obj.error_count);
+    thread_end_scratch(&scratch);
+    return ass_load_default_cube(ass, rc);
   }
 
   // Get a new mesh out of the mesh pool, and initialize
-  RND_Mesh *mesh = pool_alloc(&ass->mesh_pool);
-  rnd_mesh_init(rc, mesh, vertices, vertex_count, indices, index_count);
+  RND_Mesh *mesh = shared_pool_alloc(&ass->mesh_pool);
+  rnd_mesh_init(rc, mesh, obj.vertices, obj.vertex_count, obj.indices, obj.index_count);
 
   // And done with those vertices on the CPU side
   thread_end_scratch(&scratch);
 
   // Create a new asset entry
-  ASS_Entry *entry = pool_alloc(&ass->entry_pool);
-  entry->mesh_data = mesh;
-  entry->reference_count++;
-  entry->type = ASS_TYPE_MESH;
-  entry->id = 0;
-  strcpy(entry->name, file_name);
+  ASS_Handle entry = ass_entry_make_mesh(ass, file_name, mesh);
   LOG_DEBUG("Loaded asset (%s) for the first time", file_name);
 
-  fclose(obj_file);
   return entry;
 }
 
-ASS_Entry *ass_load_mesh_gtlf(ASS_Manager *ass, RND_Context *rc, char *file_name) { return NULL; }
+ASS_Handle ass_load_mesh_gtlf(ASS_Manager *ass, RND_Context *rc, char *file_name) {
+  return POOL_HANDLE_NIL;
+}
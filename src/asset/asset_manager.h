@@ -1,14 +1,17 @@
 #ifndef ASSET_MANAGER_H
 #define ASSET_MANAGER_H
 
+#include "core/packed_array.h"
 #include "core/pool.h"
+#include "core/shared_pool.h"
 #include "render/render_context.h"
 #include "render/render_mesh.h"
 
 enum ASS_Manager_Constants {
   ASS_INVALID_ITEM_ID = -1,
-  ASS_MAX_ENTRIES = 64,
-  ASS_MAX_MESHES = 32,
+  ASS_MAX_ENTRIES = KB(16),
+  ASS_INDEX_CAPACITY = 2 * ASS_MAX_ENTRIES, // Power of 2, never more than half full
+  ASS_MAX_MESHES = 1024,
   ASS_MAX_TEXTURES = 32,
   ASS_MAX_FILE_NAME = 128,
 };
@@ -20,21 +23,39 @@ typedef enum ASS_Type {
   ASS_TYPE_COUNT,
 } ASS_Type;
 
+typedef struct ASS_Entry ASS_Entry;
+
+// What anything outside the asset manager holds on to instead of an ASS_Entry pointer. Entries move
+// around in the dense table as others are freed, the handle keeps finding them, and once the asset
+// is gone (or was evicted and loaded again) the generation won't match and it resolves to NULL
+typedef Pool_Handle ASS_Handle;
+
+// Open addressing with linear probing, a hash of 0 marks an empty slot
+typedef struct ASS_Index_Slot ASS_Index_Slot;
+struct ASS_Index_Slot {
+  u64 hash;
+  ASS_Handle entry;
+};
+
 typedef struct ASS_Manager ASS_Manager;
 struct ASS_Manager {
-  Pool entry_pool;
+  Packed_Array entries; // ASS_Entry
+
+  // Name hash -> entry, ASS_INDEX_CAPACITY slots, so checking for an already loaded asset is one
+  // hash and a probe or two no matter how many are loaded
+  ASS_Index_Slot *index;
 
-  // Individual asset type pools
-  Pool mesh_pool;
+  // Individual asset type pools, shared so meshes can be made and dropped from any thread
+  Shared_Pool mesh_pool;
 };
 
-typedef struct ASS_Entry ASS_Entry;
 struct ASS_Entry {
   u32 id;
   u32 reference_count;
 
   // Other way?
   char name[ASS_MAX_FILE_NAME];
+  u64 name_hash; // Hashed the once, when the entry is made
 
   // Tagged union for different asset types
   ASS_Type type;
@@ -42,15 +63,6 @@ struct ASS_Entry {
     RND_Mesh *mesh_data;
     // Textures, sounds, etc
   };
-
-  void *next_in_hash;
-};
-
-// TODO(ss): Would be nice to use handles instead
-typedef struct ASS_Handle ASS_Handle;
-struct ASS_Handle {
-  u32 id;
-  ASS_Type type;
 };
 
 // TODO(ss): Could change pool implementation to allow using backing buffer... so we can keep
@@ -63,11 +75,24 @@ void ass_manager_free(ASS_Manager *ass, RND_Context *rc);
 
 // Returns a handle to a mesh, managed by asset manager, OJB loader taken
 // straight from a previous project... needs work probably
-ASS_Entry *ass_load_mesh_obj(ASS_Manager *asset_manager, RND_Context *render_context,
+ASS_Handle ass_load_mesh_obj(ASS_Manager *asset_manager, RND_Context *render_context,
                              char *file_name);
-ASS_Entry *ass_load_mesh_gtlf(ASS_Manager *asset_manager, RND_Context *render_context,
+ASS_Handle ass_load_mesh_gtlf(ASS_Manager *asset_manager, RND_Context *render_context,
                               char *file_name);
 
-void ass_free_entry(ASS_Manager *manager, RND_Context *render_context, ASS_Entry *asset_entry);
+// Drops a reference, the asset is freed (and every handle to it goes stale) once none are left
+void ass_free_entry(ASS_Manager *manager, RND_Context *render_context, ASS_Handle handle);
+
+// Already loaded entry for this file, or a nil handle
+ASS_Handle ass_find_existing(ASS_Manager *ass, const char *name);
+
+// NULL if the handle is stale. NOTE(ss): Pointer is only good until the next free, since that can
+// move entries around, resolve again rather than holding on to it
+ASS_Entry *ass_get(ASS_Manager *ass, ASS_Handle handle);
+
+// Resolves a whole batch at once, what the draw path wants once a frame. Stale handles and ones
+// that aren't meshes come back as NULL
+void ass_resolve_meshes(ASS_Manager *ass, const ASS_Handle *handles, u32 count,
+                        RND_Mesh **out_meshes);
 
 #endif // ASSET_MANAGER_H
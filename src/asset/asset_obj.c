@@ -0,0 +1,491 @@
+#include "asset/asset_obj.h"
+
+#include "core/log.h"
+#include "core/thread_context.h"
+
+#include <stdlib.h>
+
+enum ASS_OBJ_Constants {
+  ASS_OBJ_ARRAY_MIN_CAPACITY = 1024,
+  ASS_OBJ_MAX_REPORTED_ERRORS = 8, // Past this only the total gets logged
+  ASS_OBJ_MAX_NUMBER_LENGTH = 64,  // For the slow path, anything longer isn't a number we want
+  ASS_OBJ_MIN_SLOT_CAPACITY = 4096,
+  ASS_OBJ_SLOT_EMPTY = UINT32_MAX,
+  ASS_OBJ_NONE = UINT32_MAX, // Corner without a uv or normal
+};
+
+// Exactly representable as doubles, so scaling by one of these rounds only the once
+translation_local const f64 ASS_OBJ_POWERS_OF_10[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+// Doubles inside the arena as it fills and leaves the old copy behind, so worst case it costs
+// about twice its final size, all of which goes away with the arena
+typedef struct ASS_OBJ_Array ASS_OBJ_Array;
+struct ASS_OBJ_Array {
+  u8 *data;
+  u32 count;
+  u32 capacity;
+};
+
+translation_local void *ass_obj_array_push(Arena *arena, ASS_OBJ_Array *array, isize element_size,
+                                           isize alignment) {
+  if (array->count == array->capacity) {
+    u32 capacity = MAX(array->capacity * 2, ASS_OBJ_ARRAY_MIN_CAPACITY);
+    u8 *data = arena_alloc_nozero(arena, capacity * element_size, alignment);
+    if (array->count > 0) {
+      memcpy(data, array->data, array->count * element_size);
+    }
+
+    array->data = data;
+    array->capacity = capacity;
+  }
+
+  return array->data + (array->count++) * element_size;
+}
+
+#define ass_obj_array_push_type(arena, array, T)                                                   \
+  ((T *)ass_obj_array_push(arena, array, sizeof(T), alignof(T)))
+
+// Scanning ---------------------------------------------------------------------
+
+// NOTE(ss): Nothing here expects the buffer to be null terminated, a mapped file isn't
+
+static inline bool ass_obj_is_blank(u8 c) { return c == ' ' || c == '\t' || c == '\r'; }
+static inline bool ass_obj_is_digit(u8 c) { return (u8)(c - '0') < 10; }
+
+translation_local void ass_obj_skip_blanks(const u8 **at, const u8 *end) {
+  while (*at < end && ass_obj_is_blank(**at)) {
+    (*at)++;
+  }
+}
+
+// Just past the next newline, or the end
+translation_local void ass_obj_skip_line(const u8 **at, const u8 *end) {
+  const u8 *newline = memchr(*at, '\n', end - *at);
+  *at = newline != NULL ? newline + 1 : end;
+}
+
+// End of a token, a comment runs to the end of the line so it ends one too
+translation_local bool ass_obj_at_line_end(const u8 *at, const u8 *end) {
+  return at == end || *at == '\n' || *at == '#' || ass_obj_is_blank(*at);
+}
+
+// For whatever the fast path gives up on (huge exponents, more digits than a u64 holds, inf and
+// nan). strtod wants a terminated string so copy the token out first
+translation_local bool ass_obj_scan_f32_slow(const u8 **at, const u8 *end, f32 *out) {
+  char token[ASS_OBJ_MAX_NUMBER_LENGTH];
+  u32 length = 0;
+  for (const u8 *p = *at; p < end && !ass_obj_at_line_end(p, end); p++) {
+    if (length == ASS_OBJ_MAX_NUMBER_LENGTH - 1)
+      return false;
+    token[length++] = *p;
+  }
+  token[length] = '\0';
+
+  char *parsed_end = NULL;
+  f64 value = strtod(token, &parsed_end);
+  if (length == 0 || parsed_end != token + length)
+    return false;
+
+  *out = (f32)value;
+  *at += length;
+  return true;
+}
+
+// Plain decimals with an optional exponent, which is all any exporter actually writes. Digits go
+// into a u64 and get scaled by an exact power of 10 once at the end, no locale and no format
+// string to interpret like sscanf
+translation_local bool ass_obj_scan_f32(const u8 **at, const u8 *end, f32 *out) {
+  ass_obj_skip_blanks(at, end);
+
+  const u8 *p = *at;
+  bool negative = false;
+  if (p < end && (*p == '-' || *p == '+')) {
+    negative = *p == '-';
+    p++;
+  }
+
+  // Past 19 significant digits the rest can't change a float anyway, only their count matters
+  u64 mantissa = 0;
+  i32 exponent = 0;
+  u32 significant = 0;
+  u32 digits = 0;
+  for (; p < end && ass_obj_is_digit(*p); p++, digits++) {
+    if (significant < 19) {
+      mantissa = mantissa * 10 + (*p - '0');
+      significant += mantissa != 0;
+    } else {
+      exponent++;
+    }
+  }
+
+  if (p < end && *p == '.') {
+    p++;
+    for (; p < end && ass_obj_is_digit(*p); p++, digits++) {
+      if (significant < 19) {
+        mantissa = mantissa * 10 + (*p - '0');
+        significant += mantissa != 0;
+        exponent--;
+      }
+    }
+  }
+
+  if (digits == 0)
+    return ass_obj_scan_f32_slow(at, end, out);
+
+  if (p < end && (*p == 'e' || *p == 'E')) {
+    const u8 *e = p + 1;
+    bool exponent_negative = false;
+    if (e < end && (*e == '-' || *e == '+')) {
+      exponent_negative = *e == '-';
+      e++;
+    }
+
+    i32 written = 0;
+    const u8 *exponent_digits = e;
+    for (; e < end && ass_obj_is_digit(*e) && written < 10000; e++) {
+      written = written * 10 + (*e - '0');
+    }
+    if (e == exponent_digits)
+      return false;
+
+    exponent += exponent_negative ? -written : written;
+    p = e;
+  }
+
+  if (!ass_obj_at_line_end(p, end) && *p != '/')
+    return false;
+
+  i32 max_exponent = STATIC_ARRAY_COUNT(ASS_OBJ_POWERS_OF_10) - 1;
+  if (exponent < -max_exponent || exponent > max_exponent)
+    return ass_obj_scan_f32_slow(at, end, out);
+
+  f64 value = (f64)mantissa;
+  value = exponent < 0 ? value / ASS_OBJ_POWERS_OF_10[-exponent]
+                       : value * ASS_OBJ_POWERS_OF_10[exponent];
+
+  *out = (f32)(negative ? -value : value);
+  *at = p;
+  return true;
+}
+
+// No blank skipping, face corners are written packed like 1/2/3
+translation_local bool ass_obj_scan_i64(const u8 **at, const u8 *end, i64 *out) {
+  const u8 *p = *at;
+  bool negative = p < end && *p == '-';
+  if (negative) {
+    p++;
+  }
+
+  const u8 *digits = p;
+  i64 value = 0;
+  for (; p < end && ass_obj_is_digit(*p); p++) {
+    // Clamp instead of overflowing, anything this big is out of range as an index anyways
+    value = MIN(value * 10 + (*p - '0'), (i64)UINT32_MAX + 1);
+  }
+  if (p == digits)
+    return false;
+
+  *out = negative ? -value : value;
+  *at = p;
+  return true;
+}
+
+// Parsing ----------------------------------------------------------------------
+
+// Which position, uv and normal a face corner uses, 0 based, uv and normal can be ASS_OBJ_NONE
+typedef struct ASS_OBJ_Corner ASS_OBJ_Corner;
+struct ASS_OBJ_Corner {
+  u32 position;
+  u32 uv;
+  u32 normal;
+};
+
+// Every distinct corner becomes one vertex, the table maps corners to the vertex made for them
+typedef struct ASS_OBJ_Vertex_Slot ASS_OBJ_Vertex_Slot;
+struct ASS_OBJ_Vertex_Slot {
+  ASS_OBJ_Corner corner;
+  u32 vertex; // ASS_OBJ_SLOT_EMPTY when unused
+};
+
+typedef struct ASS_OBJ_Parser ASS_OBJ_Parser;
+struct ASS_OBJ_Parser {
+  Arena *arena;   // Results
+  Arena *scratch; // Everything else
+
+  ASS_OBJ_Array positions; // vec3
+  ASS_OBJ_Array uvs;       // vec2
+  ASS_OBJ_Array normals;   // vec3
+
+  ASS_OBJ_Array vertices; // RND_Vertex, one per distinct corner
+  ASS_OBJ_Array indices;  // u32
+
+  ASS_OBJ_Array face; // ASS_OBJ_Corner, the face being parsed, reused for every face
+
+  // Open addressing, linear probing, power of 2 capacity
+  ASS_OBJ_Vertex_Slot *slots;
+  u32 slot_capacity;
+
+  const char *name;
+  u32 line;
+  u32 error_count;
+};
+
+translation_local void ass_obj_error(ASS_OBJ_Parser *parser, const char *what) {
+  if (parser->error_count < ASS_OBJ_MAX_REPORTED_ERRORS) {
+    LOG_ERROR("%s:%u: %s, skipping line", parser->name, parser->line, what);
+  }
+  parser->error_count++;
+}
+
+translation_local bool ass_obj_parse_vec(const u8 **at, const u8 *end, f32 *out, u32 count) {
+  for (u32 i = 0; i < count; i++) {
+    if (!ass_obj_scan_f32(at, end, &out[i]))
+      return false;
+  }
+
+  return true;
+}
+
+// Neighbouring corners tend to be neighbouring indices, so mix well enough that they don't all
+// land in one run of slots
+static inline u32 ass_obj_corner_hash(ASS_OBJ_Corner corner) {
+  u64 hash = corner.position;
+  hash = hash * 0x9E3779B97F4A7C15ull + corner.uv;
+  hash = hash * 0x9E3779B97F4A7C15ull + corner.normal;
+  hash *= 0x9E3779B97F4A7C15ull;
+  return (u32)(hash >> 32);
+}
+
+translation_local ASS_OBJ_Vertex_Slot *ass_obj_slot_find(ASS_OBJ_Vertex_Slot *slots,
+                                                         u32 slot_capacity, ASS_OBJ_Corner corner) {
+  u32 mask = slot_capacity - 1;
+  for (u32 i = ass_obj_corner_hash(corner) & mask;; i = (i + 1) & mask) {
+    ASS_OBJ_Vertex_Slot *slot = &slots[i];
+    if (slot->vertex == ASS_OBJ_SLOT_EMPTY ||
+        (slot->corner.position == corner.position && slot->corner.uv == corner.uv &&
+         slot->corner.normal == corner.normal)) {
+      return slot;
+    }
+  }
+}
+
+// Doubles the table, the old one is left behind in the scratch like the arrays
+translation_local void ass_obj_slots_grow(ASS_OBJ_Parser *parser) {
+  u32 capacity = MAX(parser->slot_capacity * 2, ASS_OBJ_MIN_SLOT_CAPACITY);
+  ASS_OBJ_Vertex_Slot *slots =
+      arena_calloc_nozero(parser->scratch, capacity, ASS_OBJ_Vertex_Slot);
+  memset(slots, 0xFF, capacity * sizeof(*slots)); // All ASS_OBJ_SLOT_EMPTY
+
+  for (u32 i = 0; i < parser->slot_capacity; i++) {
+    ASS_OBJ_Vertex_Slot *slot = &parser->slots[i];
+    if (slot->vertex != ASS_OBJ_SLOT_EMPTY) {
+      *ass_obj_slot_find(slots, capacity, slot->corner) = *slot;
+    }
+  }
+
+  parser->slots = slots;
+  parser->slot_capacity = capacity;
+}
+
+// Vertex index for the corner, making the vertex the first time the corner shows up
+translation_local u32 ass_obj_corner_vertex(ASS_OBJ_Parser *parser, ASS_OBJ_Corner corner) {
+  // Kept at most half full, every vertex has exactly one slot
+  if ((parser->vertices.count + 1) * 2 > parser->slot_capacity) {
+    ass_obj_slots_grow(parser);
+  }
+
+  ASS_OBJ_Vertex_Slot *slot = ass_obj_slot_find(parser->slots, parser->slot_capacity, corner);
+  if (slot->vertex != ASS_OBJ_SLOT_EMPTY)
+    return slot->vertex;
+
+  slot->corner = corner;
+  slot->vertex = parser->vertices.count;
+
+  // Missing normals start at zero and get the faces around them added in, see below
+  RND_Vertex *vertex = ass_obj_array_push_type(parser->arena, &parser->vertices, RND_Vertex);
+  *vertex = (RND_Vertex){
+      .position = ((vec3 *)parser->positions.data)[corner.position],
+      .color = vec3(1.0f, 0.5f, 0.2f), // Default
+  };
+  if (corner.uv != ASS_OBJ_NONE) {
+    vertex->uv = ((vec2 *)parser->uvs.data)[corner.uv];
+  }
+  if (corner.normal != ASS_OBJ_NONE) {
+    vertex->normal = ((vec3 *)parser->normals.data)[corner.normal];
+  }
+
+  return slot->vertex;
+}
+
+// Positive indices count from 1, negative ones back from the latest element. Out of range (or 0)
+// comes back as false
+static inline bool ass_obj_resolve_index(i64 index, u32 count, u32 *out) {
+  if (index > 0 && index <= count) {
+    *out = index - 1;
+    return true;
+  }
+  if (index < 0 && -index <= count) {
+    *out = count + index;
+    return true;
+  }
+
+  return false;
+}
+
+// v, v/vt, v//vn or v/vt/vn
+translation_local bool ass_obj_parse_corner(ASS_OBJ_Parser *parser, const u8 **at, const u8 *end,
+                                            ASS_OBJ_Corner *out) {
+  i64 v = 0, vt = 0, vn = 0;
+  if (!ass_obj_scan_i64(at, end, &v))
+    return false;
+
+  if (*at < end && **at == '/') {
+    (*at)++;
+    if (*at < end && **at != '/' && !ass_obj_scan_i64(at, end, &vt))
+      return false;
+
+    if (*at < end && **at == '/') {
+      (*at)++;
+      if (!ass_obj_scan_i64(at, end, &vn))
+        return false;
+    }
+  }
+
+  if (!ass_obj_at_line_end(*at, end))
+    return false;
+
+  *out = (ASS_OBJ_Corner){.uv = ASS_OBJ_NONE, .normal = ASS_OBJ_NONE};
+  return ass_obj_resolve_index(v, parser->positions.count, &out->position) &&
+         (vt == 0 || ass_obj_resolve_index(vt, parser->uvs.count, &out->uv)) &&
+         (vn == 0 || ass_obj_resolve_index(vn, parser->normals.count, &out->normal));
+}
+
+// Any number of corners, fanned out from the first one, so only right for convex faces which is
+// what exporters give anyways
+translation_local bool ass_obj_parse_face(ASS_OBJ_Parser *parser, const u8 **at, const u8 *end) {
+  parser->face.count = 0;
+  while (true) {
+    // Past the blanks only the end of the line or a trailing comment is left
+    ass_obj_skip_blanks(at, end);
+    if (ass_obj_at_line_end(*at, end))
+      break;
+
+    ASS_OBJ_Corner *corner =
+        ass_obj_array_push_type(parser->scratch, &parser->face, ASS_OBJ_Corner);
+    if (!ass_obj_parse_corner(parser, at, end, corner)) {
+      ass_obj_error(parser, "Bad face corner or index out of range");
+      return false;
+    }
+  }
+
+  if (parser->face.count < 3) {
+    ass_obj_error(parser, "Face with less than 3 corners");
+    return false;
+  }
+
+  // Only once the whole face checks out, so a bad one doesn't leave half a polygon behind
+  ASS_OBJ_Corner *corners = (ASS_OBJ_Corner *)parser->face.data;
+  u32 first = ass_obj_corner_vertex(parser, corners[0]);
+  u32 previous = ass_obj_corner_vertex(parser, corners[1]);
+  for (u32 i = 2; i < parser->face.count; i++) {
+    u32 current = ass_obj_corner_vertex(parser, corners[i]);
+
+    *ass_obj_array_push_type(parser->arena, &parser->indices, u32) = first;
+    *ass_obj_array_push_type(parser->arena, &parser->indices, u32) = previous;
+    *ass_obj_array_push_type(parser->arena, &parser->indices, u32) = current;
+
+    // NOTE(ss): Area weighted sum of the faces around it, smooth shading for free. Left
+    // unnormalized since the vertex shader normalizes anyways
+    u32 corner_indices[3] = {0, i - 1, i};
+    u32 vertex_indices[3] = {first, previous, current};
+    RND_Vertex *vertices = (RND_Vertex *)parser->vertices.data;
+    vec3 face_normal = {0};
+    for (u32 c = 0; c < 3; c++) {
+      if (corners[corner_indices[c]].normal != ASS_OBJ_NONE)
+        continue;
+
+      if (face_normal.x == 0.0f && face_normal.y == 0.0f && face_normal.z == 0.0f) {
+        vec3 a = vertices[first].position;
+        face_normal = vec3_cross(vec3_sub(vertices[previous].position, a),
+                                 vec3_sub(vertices[current].position, a));
+      }
+      vertices[vertex_indices[c]].normal =
+          vec3_add(vertices[vertex_indices[c]].normal, face_normal);
+    }
+
+    previous = current;
+  }
+
+  return true;
+}
+
+ASS_OBJ_Mesh ass_obj_parse(Arena *arena, const u8 *data, isize size, const char *name) {
+  Scratch scratch = thread_get_scratch_avoiding(&arena, 1);
+
+  ASS_OBJ_Parser parser = {
+      .arena = arena,
+      .scratch = scratch.arena,
+      .name = name,
+  };
+
+  const u8 *at = data;
+  const u8 *end = data + size;
+  while (at < end) {
+    parser.line++;
+    ass_obj_skip_blanks(&at, end);
+
+    // Keyword and then a blank, anything we don't know (comments, groups, materials, smoothing
+    // groups) just gets skipped
+    const u8 *keyword = at;
+    while (at < end && !ass_obj_at_line_end(at, end)) {
+      at++;
+    }
+    isize keyword_length = at - keyword;
+
+    if (keyword_length == 1 && keyword[0] == 'v') {
+      vec3 position;
+      if (ass_obj_parse_vec(&at, end, position.elements, 3)) {
+        *ass_obj_array_push_type(scratch.arena, &parser.positions, vec3) = position;
+      } else {
+        ass_obj_error(&parser, "Bad vertex position");
+      }
+    } else if (keyword_length == 2 && keyword[0] == 'v' && keyword[1] == 't') {
+      vec2 uv;
+      if (ass_obj_parse_vec(&at, end, uv.elements, 2)) {
+        *ass_obj_array_push_type(scratch.arena, &parser.uvs, vec2) = uv;
+      } else {
+        ass_obj_error(&parser, "Bad vertex uv");
+      }
+    } else if (keyword_length == 2 && keyword[0] == 'v' && keyword[1] == 'n') {
+      vec3 normal;
+      if (ass_obj_parse_vec(&at, end, normal.elements, 3)) {
+        *ass_obj_array_push_type(scratch.arena, &parser.normals, vec3) = normal;
+      } else {
+        ass_obj_error(&parser, "Bad vertex normal");
+      }
+    } else if (keyword_length == 1 && keyword[0] == 'f') {
+      ass_obj_parse_face(&parser, &at, end);
+    }
+
+    ass_obj_skip_line(&at, end);
+  }
+
+  if (parser.error_count > ASS_OBJ_MAX_REPORTED_ERRORS) {
+    LOG_ERROR("%s: %u malformed lines skipped in total", name, parser.error_count);
+  }
+
+  thread_end_scratch(&scratch);
+
+  ASS_OBJ_Mesh mesh = {
+      .vertices = (RND_Vertex *)parser.vertices.data,
+      .vertex_count = parser.vertices.count,
+      .indices = (u32 *)parser.indices.data,
+      .index_count = parser.indices.count,
+      .error_count = parser.error_count,
+  };
+
+  return mesh;
+}
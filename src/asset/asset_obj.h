@@ -0,0 +1,25 @@
+#ifndef ASSET_OBJ_H
+#define ASSET_OBJ_H
+
+#include "core/arena.h"
+#include "core/common.h"
+
+#include "render/render_mesh.h"
+
+// Wavefront .obj parsing, kept apart from the asset manager so it can run on any buffer without a
+// render context around
+
+typedef struct ASS_OBJ_Mesh ASS_OBJ_Mesh;
+struct ASS_OBJ_Mesh {
+  RND_Vertex *vertices;
+  u32 vertex_count;
+  u32 *indices;
+  u32 index_count;
+
+  u32 error_count; // Lines that didn't parse and were skipped
+};
+
+// One pass over the whole file's contents. Results go in arena, name is only for error messages
+ASS_OBJ_Mesh ass_obj_parse(Arena *arena, const u8 *data, isize size, const char *name);
+
+#endif // ASSET_OBJ_H
@@ -3,31 +3,90 @@
 #include "core/common.h"
 #include "core/log.h"
 
+#include "os/os.h"
+
 #include <malloc.h>
 #include <stdlib.h>
 
-Arena arena_make(isize reserve_size, Arena_Flags flags) {
-  Arena arena = {0};
+// Chained blocks keep their header at the very start, allocations begin after it
+#define ARENA_BLOCK_HEADER_SIZE ALIGN_ROUND_UP((isize)sizeof(Arena_Block), 16)
 
-  // NOTE(ss): this will return page-aligned memory (obviously) so I don't think it is
-  // nessecary to make sure that the alignment suffices
-  arena.base = calloc(reserve_size, 1);
+// Grabs the memory for one block, resizable blocks only get reserved here
+translation_local u8 *arena_block_memory_make(isize size, Arena_Flags flags, isize *out_committed) {
+  u8 *memory = NULL;
+
+  if (flags & ARENA_FLAG_RESIZABLE) {
+    memory = os_reserve(size);
+    *out_committed = 0;
+  } else {
+    // NOTE(ss): calloc only promises alignof(max_align_t), anything past that is on the
+    // allocations to line up themselves, see arena_aligned_offset
+    memory = calloc(size, 1);
+    *out_committed = size;
+  }
 
-  if (arena.base == NULL) {
+  if (memory == NULL) {
     LOG_FATAL("Failed to allocate arena memory", EXT_ARENA_ALLOCATION);
   }
 
+  return memory;
+}
+
+translation_local void arena_block_memory_free(u8 *memory, isize size, Arena_Flags flags) {
+  if (flags & ARENA_FLAG_RESIZABLE)
+    os_release(memory, size);
+  else
+    free(memory);
+}
+
+Arena arena_make(isize reserve_size, Arena_Flags flags) {
+  Arena arena = {0};
+
+  if (flags & ARENA_FLAG_RESIZABLE) {
+    reserve_size = ALIGN_ROUND_UP(reserve_size, os_page_size());
+  }
+
+  arena.base = arena_block_memory_make(reserve_size, flags, &arena.committed);
   arena.capacity = reserve_size;
   arena.next_offset = 0;
   arena.flags = flags;
 
+  arena.base_position = 0;
+  arena.block_size = reserve_size;
+  arena.prev_block = NULL;
+  arena.free_block = NULL;
+
+  arena.track = mem_track_register(MEM_TRACK_ARENA, reserve_size);
+
   return arena;
 }
 
 void arena_free(Arena *arena) {
-  if (!(arena->flags & ARENA_FLAG_BACKING))
-    free(arena->base);
+  if (!(arena->flags & ARENA_FLAG_BACKING)) {
+    // Headers live inside the block they describe, so grab what we need before freeing
+    while (arena->prev_block != NULL) {
+      Arena_Block *prev = arena->prev_block;
+      u8 *block_base = arena->base;
+      isize block_capacity = arena->capacity;
+
+      arena->base = prev->base;
+      arena->capacity = prev->capacity;
+      arena->prev_block = prev->prev;
 
+      arena_block_memory_free(block_base, block_capacity, arena->flags);
+    }
+
+    while (arena->free_block != NULL) {
+      Arena_Block *free_block = arena->free_block;
+      arena->free_block = free_block->prev;
+
+      arena_block_memory_free(free_block->base, free_block->capacity, arena->flags);
+    }
+
+    arena_block_memory_free(arena->base, arena->capacity, arena->flags);
+  }
+
+  mem_track_unregister(arena->track);
   ZERO_STRUCT(arena);
 }
 
@@ -36,51 +95,199 @@ Arena arena_make_backing(void *backing, isize size) {
 
   arena.base = (u8 *)backing;
   arena.capacity = size;
+  arena.committed = size;
   arena.next_offset = 0;
   arena.flags = ARENA_FLAG_BACKING;
 
+  arena.track = mem_track_register(MEM_TRACK_ARENA, size);
+
   return arena;
 }
 
-void *arena_alloc(Arena *arena, isize size, isize alignment) {
+void arena_set_tag(Arena *arena, const char *tag) { mem_track_set_tag(arena->track, tag); }
+
+// Hand back committed pages that are well past where the arena is now, keeps the first commit step
+// around so an arena that bounces around near empty doesn't thrash mprotect
+translation_local void arena_decommit_excess(Arena *arena) {
+  if (!(arena->flags & ARENA_FLAG_RESIZABLE))
+    return;
+
+  isize keep = ALIGN_ROUND_UP(MAX(arena->next_offset, 1), ARENA_COMMIT_SIZE);
+  if (arena->committed - keep >= ARENA_DECOMMIT_THRESHOLD) {
+    os_decommit(arena->base + keep, arena->committed - keep);
+    arena->committed = keep;
+  }
+}
+
+// Makes sure [0, needed) of the current block is backed by memory
+translation_local void arena_commit_to(Arena *arena, isize needed) {
+  if (needed <= arena->committed)
+    return;
+
+  isize new_committed = ALIGN_ROUND_UP(needed, ARENA_COMMIT_SIZE);
+  new_committed = MIN(new_committed, arena->capacity);
+
+  if (!os_commit(arena->base + arena->committed, new_committed - arena->committed)) {
+    LOG_FATAL("Failed to commit arena memory,\nNEED: %ld bytes\nHAVE: %ld bytes",
+              EXT_ARENA_ALLOCATION, new_committed, arena->committed);
+  }
+
+  arena->committed = new_committed;
+}
+
+// Current block is full, link in a new one big enough for at least min_size bytes past the header
+translation_local void arena_push_block(Arena *arena, isize min_size) {
+  isize needed = ARENA_BLOCK_HEADER_SIZE + min_size;
+
+  // Try to recycle a block we popped earlier first
+  Arena_Block *reuse = NULL;
+  for (Arena_Block **link = &arena->free_block; *link != NULL; link = &(*link)->prev) {
+    if ((*link)->capacity >= needed) {
+      reuse = *link;
+      *link = reuse->prev;
+      break;
+    }
+  }
+
+  u8 *block_base = NULL;
+  isize block_capacity = 0;
+  isize block_committed = 0;
+  if (reuse != NULL) {
+    block_base = reuse->base;
+    block_capacity = reuse->capacity;
+    block_committed = reuse->committed;
+  } else {
+    block_capacity = MAX(arena->block_size, needed);
+    if (arena->flags & ARENA_FLAG_RESIZABLE) {
+      block_capacity = ALIGN_ROUND_UP(block_capacity, os_page_size());
+    }
+    block_base = arena_block_memory_make(block_capacity, arena->flags, &block_committed);
+    mem_track_add_reserved(arena->track, block_capacity);
+    LOG_DEBUG("Arena chained a new block of %ld bytes", block_capacity);
+  }
+
+  // Save off the current block into the header of the new one
+  Arena saved = *arena;
+
+  arena->base = block_base;
+  arena->capacity = block_capacity;
+  arena->committed = block_committed;
+  arena_commit_to(arena, ARENA_BLOCK_HEADER_SIZE);
+
+  Arena_Block *header = (Arena_Block *)block_base;
+  *header = (Arena_Block){
+      .prev = saved.prev_block,
+      .base = saved.base,
+      .capacity = saved.capacity,
+      .committed = saved.committed,
+      .next_offset = saved.next_offset,
+      .base_position = saved.base_position,
+  };
+
+  arena->next_offset = ARENA_BLOCK_HEADER_SIZE;
+  arena->base_position = saved.base_position + saved.capacity;
+  arena->prev_block = header;
+}
+
+// Unlink the current block and put it on the free list
+translation_local void arena_pop_block(Arena *arena) {
+  Arena_Block *header = arena->prev_block;
+  ASSERT(header != NULL, "Tried to pop the first block of an arena");
+
+  arena->next_offset = 0;
+  arena_decommit_excess(arena);
+
+  Arena_Block restore = *header;
+
+  // Header memory now describes this block, as a free list node
+  *header = (Arena_Block){
+      .prev = arena->free_block,
+      .base = arena->base,
+      .capacity = arena->capacity,
+      .committed = arena->committed,
+  };
+  arena->free_block = header;
+
+  arena->base = restore.base;
+  arena->capacity = restore.capacity;
+  arena->committed = restore.committed;
+  arena->next_offset = restore.next_offset;
+  arena->base_position = restore.base_position;
+  arena->prev_block = restore.prev;
+}
+
+// Offset into the current block that puts the address on the alignment, rounding the offset alone
+// is only right when the base is at least as aligned
+translation_local isize arena_aligned_offset(Arena *arena, isize alignment) {
+  uintptr_t base = (uintptr_t)arena->base;
+  return (isize)(ALIGN_ROUND_UP(base + arena->next_offset, (uintptr_t)alignment) - base);
+}
+
+void *(arena_alloc_nozero)(Arena *arena, isize size, isize alignment) {
   ASSERT(arena->base != NULL, "Arena memory is null");
 
-  isize aligned_offset = ALIGN_ROUND_UP(arena->next_offset, alignment);
+  isize aligned_offset = arena_aligned_offset(arena, alignment);
+  isize needed_capacity = aligned_offset + size;
 
   // Do we need a bigger buffer?
-  if (aligned_offset + size > arena->capacity) {
-    // TODO(ss): Hmm, should we have arena chaining, fixed size arenas, offsets instead of
-    // raw pointers?
-    u64 needed_capacity = aligned_offset + size;
-
-    LOG_FATAL("Not enough memory in arena,\nNEED: %l bytes\nHAVE: %l bytes", needed_capacity,
-              arena->capacity);
-    exit(EXT_ARENA_SIZE);
+  if (needed_capacity > arena->capacity) {
+    if (!(arena->flags & ARENA_FLAG_CHAINABLE)) {
+      LOG_FATAL("Not enough memory in arena,\nNEED: %ld bytes\nHAVE: %ld bytes", EXT_ARENA_SIZE,
+                needed_capacity, arena->capacity);
+    }
+
+    // Pad for alignment, since the block might not start out aligned to it
+    arena_push_block(arena, size + alignment);
+
+    aligned_offset = arena_aligned_offset(arena, alignment);
+    needed_capacity = aligned_offset + size;
   }
 
+  // Still inside the reservation, just need to back more of it
+  arena_commit_to(arena, needed_capacity);
+
   void *ptr = arena->base + aligned_offset;
-  ZERO_SIZE(ptr, size); // make sure memory is zeroed out
 
   // now move the offset
-  arena->next_offset = aligned_offset + size;
+  arena->next_offset = needed_capacity;
+
+  mem_track_alloc(arena->track, size, arena_position(arena));
+
+  return ptr;
+}
+
+void *(arena_alloc)(Arena *arena, isize size, isize alignment) {
+  void *ptr = (arena_alloc_nozero)(arena, size, alignment);
+  ZERO_SIZE(ptr, size); // make sure memory is zeroed out
 
   return ptr;
 }
 
-void arena_pop_to(Arena *arena, isize offset) {
-  ASSERT(offset < arena->next_offset,
+isize arena_position(Arena *arena) { return arena->base_position + arena->next_offset; }
+
+void arena_pop_to(Arena *arena, isize position) {
+  ASSERT(position <= arena_position(arena),
          "Failed to pop arena allocation, more than currently allocated");
 
+  // Unwind any whole blocks first, each one is O(1)
+  while (arena->prev_block != NULL && position < arena->base_position + ARENA_BLOCK_HEADER_SIZE) {
+    arena_pop_block(arena);
+  }
+
   // Should we zero out the memory?
-  arena->next_offset = offset;
+  arena->next_offset = position - arena->base_position;
+
+  arena_decommit_excess(arena);
+
+  mem_track_free(arena->track, arena_position(arena));
 }
 
-void arena_pop(Arena *arena, isize size) { arena_pop_to(arena, arena->next_offset - size); }
+void arena_pop(Arena *arena, isize size) { arena_pop_to(arena, arena_position(arena) - size); }
 
-void arena_clear(Arena *arena) { arena->next_offset = 0; }
+void arena_clear(Arena *arena) { arena_pop_to(arena, 0); }
 
 Scratch scratch_begin(Arena *arena) {
-  Scratch scratch = {.arena = arena, .offset_save = arena->next_offset};
+  Scratch scratch = {.arena = arena, .offset_save = arena_position(arena)};
   return scratch;
 }
 
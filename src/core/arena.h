@@ -2,6 +2,7 @@
 #define ARENA_H
 
 #include "core/common.h"
+#include "core/memory_track.h"
 
 #include <stdalign.h>
 
@@ -14,24 +15,75 @@ typedef enum Arena_Flags {
   ARENA_FLAG_CHAINABLE = (1 << 3),
 } Arena_Flags;
 
+enum Arena_Constants {
+  // Resizable arenas commit in steps of this, lines up with a huge page
+  ARENA_COMMIT_SIZE = MB(2),
+  // Only give pages back to the OS once this much committed memory is sitting unused
+  ARENA_DECOMMIT_THRESHOLD = MB(64),
+};
+
+// Lives at the start of every chained block past the first, remembers the state of the block
+// before it so we can unwind back into it. Blocks sitting on the free list reuse it as their node
+typedef struct Arena_Block Arena_Block;
+struct Arena_Block {
+  Arena_Block *prev;
+  u8 *base;
+  isize capacity;
+  isize committed;
+  isize next_offset;
+  isize base_position;
+};
+
+// NOTE(ss): Resizable arenas only reserve address space up front, capacity is the size of that
+// reservation and committed is how much of it is actually backed by memory
+
+// All the block fields (base, capacity, committed, next_offset) refer to the current block when
+// chaining, base_position is where that block starts if you lined up all the blocks end to end,
+// so base_position + next_offset is a position that is valid across the whole chain
 typedef struct Arena Arena;
 struct Arena {
   u8 *base;
   isize capacity;
+  isize committed;
   isize next_offset;
   Arena_Flags flags;
+
+  // Chaining
+  isize base_position;
+  isize block_size;
+  Arena_Block *prev_block;
+  Arena_Block *free_block;
+
+  Mem_Track *track; // NULL unless built with MEMORY_TRACKING
 };
 
 // Allocates it's own memory
 Arena arena_make(isize reserve_size, Arena_Flags flags);
 void arena_free(Arena *arena);
 
+// Name that shows up in memory tracking dumps, should be a string literal or otherwise outlive the
+// arena
+void arena_set_tag(Arena *arena, const char *tag);
+
 // No resizing or other flags allowed if made with backing, you are in charge of freeing the backing
 // memory
 Arena arena_make_backing(void *backing, isize size);
 
 void *arena_alloc(Arena *arena, isize size, isize alignment);
-void arena_pop_to(Arena *arena, isize offset);
+// Same as above but skips zeroing, only use when you are about to overwrite all of it anyways
+void *arena_alloc_nozero(Arena *arena, isize size, isize alignment);
+
+#ifdef MEMORY_TRACKING
+// NOTE(ss): Same calls, just noting the call site first. The definitions, and calls from one
+// allocator function into another, are written (arena_alloc)(...) to get around these
+#define arena_alloc(a, size, alignment) (MEM_TRACK_SITE(), (arena_alloc)(a, size, alignment))
+#define arena_alloc_nozero(a, size, alignment)                                                     \
+  (MEM_TRACK_SITE(), (arena_alloc_nozero)(a, size, alignment))
+#endif
+
+// Position across all chained blocks, what you want to save if you plan to pop back to it
+isize arena_position(Arena *arena);
+void arena_pop_to(Arena *arena, isize position);
 void arena_pop(Arena *arena, isize size);
 void arena_clear(Arena *arena);
 
@@ -43,10 +95,15 @@ void arena_clear(Arena *arena);
 // t(yped)alloc, useful for structs
 #define arena_talloc(a, T) arena_calloc(a, 1, T)
 
+// Non-zeroing versions of the above, contents are whatever was left in the arena
+#define arena_calloc_nozero(a, count, T)                                                           \
+  (T *)arena_alloc_nozero((a), sizeof(T) * (count), alignof(T))
+#define arena_talloc_nozero(a, T) arena_calloc_nozero(a, 1, T)
+
 // Scratch Use Case -------------------------------------------------------------
 
 // We just want some temporary memory
-// ie we save the offset we wish to return to after using this arena as a scratch pad
+// ie we save the position we wish to return to after using this arena as a scratch pad
 typedef struct Scratch Scratch;
 struct Scratch {
   Arena *arena;
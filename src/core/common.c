@@ -18,3 +18,24 @@ u64 get_time_ns(void) {
   timespec_get(&ts, TIME_UTC);
   return (ts.tv_sec * NSEC_PER_SEC) + (ts.tv_nsec);
 }
+
+u64 hash_bytes(const void *data, isize size) {
+  const u8 *bytes = data;
+  u64 hash = 0xcbf29ce484222325ull;
+  for (isize i = 0; i < size; i++) {
+    hash ^= bytes[i];
+    hash *= 0x100000001b3ull;
+  }
+
+  return hash;
+}
+
+u64 hash_string(const char *string) {
+  u64 hash = 0xcbf29ce484222325ull;
+  for (const u8 *at = (const u8 *)string; *at != '\0'; at++) {
+    hash ^= *at;
+    hash *= 0x100000001b3ull;
+  }
+
+  return hash;
+}
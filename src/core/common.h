@@ -70,4 +70,8 @@ f64 get_time_s(void);
 u64 get_time_ms(void);
 u64 get_time_ns(void);
 
+// 64 bit FNV-1a, cheap and spreads names and paths well enough for hash tables
+u64 hash_bytes(const void *data, isize size);
+u64 hash_string(const char *string);
+
 #endif // COMMON_H
@@ -0,0 +1,453 @@
+#include "core/ecs.h"
+
+#include "core/log.h"
+
+translation_local ECS_Record *ecs_record_at(ECS_World *world, u32 index) {
+  return (ECS_Record *)(world->records.slots + index * world->records.block_size);
+}
+
+translation_local u8 *ecs_chunk_element(ECS_World *world, ECS_Chunk *chunk, ECS_Component component,
+                                        u32 row) {
+  return (u8 *)ecs_chunk_column(chunk, component) + row * world->components[component].size;
+}
+
+// Fits as many entities in a chunk as it can, columns one after the other each aligned for its
+// component. Starts off assuming no padding and backs off until it all fits
+translation_local void ecs_archetype_layout(ECS_World *world, ECS_Archetype *archetype) {
+  isize row_size = sizeof(ECS_Entity);
+  for (u32 i = 0; i < archetype->component_count; i++) {
+    row_size += world->components[archetype->components[i]].size;
+  }
+
+  u32 capacity = (ECS_CHUNK_SIZE - sizeof(ECS_Chunk)) / row_size;
+  for (; capacity > 0; capacity--) {
+    isize offset = ALIGN_ROUND_UP(sizeof(ECS_Chunk), alignof(ECS_Entity));
+    archetype->entities_offset = offset;
+    offset += capacity * sizeof(ECS_Entity);
+
+    for (u32 i = 0; i < archetype->component_count; i++) {
+      ECS_Component_Info *info = &world->components[archetype->components[i]];
+      offset = ALIGN_ROUND_UP(offset, info->alignment);
+      archetype->column_offsets[archetype->components[i]] = offset;
+      offset += capacity * info->size;
+    }
+
+    if (offset <= ECS_CHUNK_SIZE)
+      break;
+  }
+
+  if (capacity == 0) {
+    LOG_FATAL("Components for archetype %#llx don't fit in a %u byte chunk", EXT_ECS_LIMIT,
+              (unsigned long long)archetype->mask, ECS_CHUNK_SIZE);
+  }
+  archetype->chunk_capacity = capacity;
+}
+
+// NOTE(ss): Linear search, but there are only ever a handful of archetypes and this is only hit on
+// structural changes, never while iterating
+translation_local ECS_Archetype *ecs_archetype_get(ECS_World *world, ECS_Mask mask) {
+  for (u32 i = 0; i < world->archetype_count; i++) {
+    if (world->archetypes[i].mask == mask)
+      return &world->archetypes[i];
+  }
+
+  if (world->archetype_count == ECS_MAX_ARCHETYPES) {
+    LOG_FATAL("Too many archetypes, max of %u", EXT_ECS_LIMIT, ECS_MAX_ARCHETYPES);
+  }
+
+  ECS_Archetype *archetype = &world->archetypes[world->archetype_count++];
+  archetype->mask = mask;
+  for (ECS_Component component = 0; component < ECS_MAX_COMPONENTS; component++) {
+    if (mask & ECS_BIT(component)) {
+      archetype->components[archetype->component_count++] = component;
+    }
+  }
+  ecs_archetype_layout(world, archetype);
+
+  return archetype;
+}
+
+// Claims the next row at the end of the archetype, contents are whatever was there before
+translation_local ECS_Chunk *ecs_archetype_push(ECS_World *world, ECS_Archetype *archetype,
+                                                u32 *out_row) {
+  ECS_Chunk *chunk = archetype->last_chunk;
+  if (chunk == NULL || chunk->count == archetype->chunk_capacity) {
+    ECS_Chunk *fresh = pool_alloc(&world->chunks);
+    fresh->archetype = archetype;
+    fresh->prev = chunk;
+
+    if (chunk != NULL) {
+      chunk->next = fresh;
+    } else {
+      archetype->first_chunk = fresh;
+    }
+    archetype->last_chunk = fresh;
+    chunk = fresh;
+  }
+
+  *out_row = chunk->count++;
+  archetype->entity_count++;
+
+  return chunk;
+}
+
+// Fills the hole with the archetype's last entity, and gives back the last chunk if that empties
+translation_local void ecs_archetype_remove(ECS_World *world, ECS_Chunk *chunk, u32 row) {
+  ECS_Archetype *archetype = chunk->archetype;
+  ECS_Chunk *last = archetype->last_chunk;
+  u32 last_row = last->count - 1;
+
+  if (chunk != last || row != last_row) {
+    ECS_Entity moved = ecs_chunk_entities(last)[last_row];
+    ecs_chunk_entities(chunk)[row] = moved;
+
+    for (u32 i = 0; i < archetype->component_count; i++) {
+      ECS_Component component = archetype->components[i];
+      memcpy(ecs_chunk_element(world, chunk, component, row),
+             ecs_chunk_element(world, last, component, last_row),
+             world->components[component].size);
+    }
+
+    ECS_Record *record = ecs_record_at(world, moved.index);
+    record->chunk = chunk;
+    record->row = row;
+  }
+
+  last->count--;
+  archetype->entity_count--;
+
+  if (last->count == 0) {
+    archetype->last_chunk = last->prev;
+    if (last->prev != NULL) {
+      last->prev->next = NULL;
+    } else {
+      archetype->first_chunk = NULL;
+    }
+    pool_pop(&world->chunks, last);
+  }
+
+  world->structure_version++;
+}
+
+// Over to the archetype for the new mask, components in both come along and new ones are zeroed
+translation_local void ecs_move(ECS_World *world, ECS_Entity entity, ECS_Record *record,
+                                ECS_Mask mask) {
+  ECS_Chunk *from = record->chunk;
+  u32 from_row = record->row;
+  ECS_Archetype *archetype = ecs_archetype_get(world, mask);
+
+  u32 row = 0;
+  ECS_Chunk *chunk = ecs_archetype_push(world, archetype, &row);
+  ecs_chunk_entities(chunk)[row] = entity;
+
+  for (u32 i = 0; i < archetype->component_count; i++) {
+    ECS_Component component = archetype->components[i];
+    u8 *element = ecs_chunk_element(world, chunk, component, row);
+    if (ecs_chunk_has(from, component)) {
+      memcpy(element, ecs_chunk_element(world, from, component, from_row),
+             world->components[component].size);
+    } else {
+      memset(element, 0, world->components[component].size);
+    }
+  }
+
+  ecs_archetype_remove(world, from, from_row);
+
+  record->chunk = chunk;
+  record->row = row;
+}
+
+ECS_World ecs_world_make(void) {
+  ECS_World world = {
+      .arena = arena_make(ECS_MAX_ARCHETYPES * sizeof(ECS_Archetype), ARENA_FLAG_DEFAULTS),
+      .records = pool_make_type(ECS_MAX_ENTITIES, ECS_Record),
+      .chunks = pool_make(ECS_MAX_CHUNKS, ECS_CHUNK_SIZE, ECS_CHUNK_ALIGNMENT),
+  };
+  arena_set_tag(&world.arena, "ecs_archetypes");
+  pool_set_tag(&world.records, "ecs_records");
+  pool_set_tag(&world.chunks, "ecs_chunks");
+
+  world.archetypes = arena_calloc(&world.arena, ECS_MAX_ARCHETYPES, ECS_Archetype);
+  ecs_archetype_get(&world, 0);
+
+  return world;
+}
+
+void ecs_world_free(ECS_World *world) {
+  pool_free(&world->chunks);
+  pool_free(&world->records);
+  arena_free(&world->arena);
+  ZERO_STRUCT(world);
+}
+
+ECS_Component ecs_component_register(ECS_World *world, isize size, isize alignment,
+                                     const char *name) {
+  if (world->component_count == ECS_MAX_COMPONENTS) {
+    LOG_FATAL("Too many components registering %s, max of %u", EXT_ECS_LIMIT, name,
+              ECS_MAX_COMPONENTS);
+  }
+
+  ECS_Component component = world->component_count++;
+  world->components[component] = (ECS_Component_Info){
+      .size = size,
+      .alignment = alignment,
+      .name = name,
+  };
+
+  return component;
+}
+
+ECS_Entity ecs_spawn(ECS_World *world, ECS_Mask mask) {
+  ASSERT(world->component_count == ECS_MAX_COMPONENTS || mask >> world->component_count == 0,
+         "Spawning with unregistered components in mask %#llx", (unsigned long long)mask);
+
+  ECS_Entity entity = {0};
+  ECS_Record *record = pool_alloc_handle(&world->records, &entity);
+  ECS_Archetype *archetype = ecs_archetype_get(world, mask);
+
+  record->chunk = ecs_archetype_push(world, archetype, &record->row);
+  ecs_chunk_entities(record->chunk)[record->row] = entity;
+  for (u32 i = 0; i < archetype->component_count; i++) {
+    ECS_Component component = archetype->components[i];
+    memset(ecs_chunk_element(world, record->chunk, component, record->row), 0,
+           world->components[component].size);
+  }
+
+  world->structure_version++;
+
+  return entity;
+}
+
+void ecs_despawn(ECS_World *world, ECS_Entity entity) {
+  ECS_Record *record = pool_get(&world->records, entity);
+  if (record == NULL) {
+    LOG_ERROR("Tried to despawn dead entity %u (generation %u)", entity.index, entity.generation);
+    return;
+  }
+
+  ecs_archetype_remove(world, record->chunk, record->row);
+  pool_pop_handle(&world->records, entity);
+}
+
+bool ecs_alive(ECS_World *world, ECS_Entity entity) {
+  return pool_handle_valid(&world->records, entity);
+}
+
+ECS_Mask ecs_mask_of(ECS_World *world, ECS_Entity entity) {
+  ECS_Record *record = pool_get(&world->records, entity);
+  return record != NULL ? record->chunk->archetype->mask : 0;
+}
+
+void *ecs_get(ECS_World *world, ECS_Entity entity, ECS_Component component) {
+  ECS_Record *record = pool_get(&world->records, entity);
+  if (record == NULL || !ecs_chunk_has(record->chunk, component))
+    return NULL;
+
+  return ecs_chunk_element(world, record->chunk, component, record->row);
+}
+
+void *ecs_add(ECS_World *world, ECS_Entity entity, ECS_Component component) {
+  ASSERT(component < world->component_count, "Adding unregistered component %u", component);
+
+  ECS_Record *record = pool_get(&world->records, entity);
+  if (record == NULL) {
+    LOG_ERROR("Tried to add component %s to dead entity %u", world->components[component].name,
+              entity.index);
+    return NULL;
+  }
+
+  ECS_Mask mask = record->chunk->archetype->mask;
+  if (!(mask & ECS_BIT(component))) {
+    ecs_move(world, entity, record, mask | ECS_BIT(component));
+  }
+
+  return ecs_chunk_element(world, record->chunk, component, record->row);
+}
+
+void ecs_remove(ECS_World *world, ECS_Entity entity, ECS_Component component) {
+  ECS_Record *record = pool_get(&world->records, entity);
+  if (record == NULL)
+    return;
+
+  ECS_Mask mask = record->chunk->archetype->mask;
+  if (mask & ECS_BIT(component)) {
+    ecs_move(world, entity, record, mask & ~ECS_BIT(component));
+  }
+}
+
+void ecs_set_mask(ECS_World *world, ECS_Entity entity, ECS_Mask mask) {
+  ASSERT(world->component_count == ECS_MAX_COMPONENTS || mask >> world->component_count == 0,
+         "Moving to unregistered components in mask %#llx", (unsigned long long)mask);
+
+  ECS_Record *record = pool_get(&world->records, entity);
+  if (record == NULL) {
+    LOG_ERROR("Tried to set the components of dead entity %u", entity.index);
+    return;
+  }
+
+  if (record->chunk->archetype->mask != mask) {
+    ecs_move(world, entity, record, mask);
+  }
+}
+
+ECS_Iter ecs_query_iter(ECS_World *world, ECS_Query query) {
+  ECS_Iter it = {
+      .world = world,
+      .query = query,
+  };
+
+  return it;
+}
+
+bool ecs_iter_next(ECS_Iter *it) {
+  if (it->chunk != NULL && it->chunk->next != NULL) {
+    it->chunk = it->chunk->next;
+    return true;
+  }
+
+  // archetype_index is always the next one to look at
+  while (it->archetype_index < it->world->archetype_count) {
+    ECS_Archetype *archetype = &it->world->archetypes[it->archetype_index++];
+    if (archetype->first_chunk != NULL && ecs_query_matches(it->query, archetype->mask)) {
+      it->chunk = archetype->first_chunk;
+      return true;
+    }
+  }
+
+  it->chunk = NULL;
+  return false;
+}
+
+ECS_Chunk **ecs_query_chunks(ECS_World *world, ECS_Query query, Arena *arena, u32 *out_count) {
+  u32 chunk_count = 0;
+  for (u32 i = 0; i < world->archetype_count; i++) {
+    ECS_Archetype *archetype = &world->archetypes[i];
+    if (ecs_query_matches(query, archetype->mask)) {
+      chunk_count += (archetype->entity_count + archetype->chunk_capacity - 1) /
+                     archetype->chunk_capacity;
+    }
+  }
+
+  ECS_Chunk **chunks = arena_calloc_nozero(arena, chunk_count, ECS_Chunk *);
+  u32 at = 0;
+  ECS_Iter it = ecs_query_iter(world, query);
+  while (ecs_iter_next(&it)) {
+    chunks[at++] = it.chunk;
+  }
+  ASSERT(at == chunk_count, "Archetype chunk lists out of sync with their entity counts");
+
+  *out_count = chunk_count;
+  return chunks;
+}
+
+u32 ecs_query_count(ECS_World *world, ECS_Query query) {
+  u32 count = 0;
+  for (u32 i = 0; i < world->archetype_count; i++) {
+    if (ecs_query_matches(query, world->archetypes[i].mask)) {
+      count += world->archetypes[i].entity_count;
+    }
+  }
+
+  return count;
+}
+
+// Command Buffers -------------------------------------------------------------
+
+typedef enum ECS_Command_Kind {
+  ECS_COMMAND_DESPAWN,
+  ECS_COMMAND_ADD,
+  ECS_COMMAND_REMOVE,
+} ECS_Command_Kind;
+
+// Packed back to back in the arena, each followed by size bytes of component data
+typedef struct ECS_Command ECS_Command;
+struct ECS_Command {
+  ECS_Command_Kind kind;
+  ECS_Component component;
+  ECS_Entity entity;
+  isize size;
+};
+
+translation_local ECS_Command *ecs_commands_push(ECS_Commands *commands, ECS_Command_Kind kind,
+                                                 ECS_Entity entity, ECS_Component component,
+                                                 isize size) {
+  ECS_Command *command = arena_alloc_nozero(&commands->arena, sizeof(ECS_Command) + size,
+                                            alignof(ECS_Command));
+  *command = (ECS_Command){
+      .kind = kind,
+      .component = component,
+      .entity = entity,
+      .size = size,
+  };
+  commands->count++;
+
+  return command;
+}
+
+ECS_Commands ecs_commands_make(void) {
+  ECS_Commands commands = {
+      .arena = arena_make(ECS_COMMANDS_RESERVE_SIZE, ARENA_FLAG_RESIZABLE),
+  };
+  arena_set_tag(&commands.arena, "ecs_commands");
+
+  return commands;
+}
+
+void ecs_commands_free(ECS_Commands *commands) {
+  arena_free(&commands->arena);
+  ZERO_STRUCT(commands);
+}
+
+void ecs_commands_despawn(ECS_Commands *commands, ECS_Entity entity) {
+  ecs_commands_push(commands, ECS_COMMAND_DESPAWN, entity, 0, 0);
+}
+
+void ecs_commands_add(ECS_Commands *commands, ECS_Entity entity, ECS_Component component,
+                      const void *data, isize size) {
+  if (data == NULL)
+    size = 0;
+
+  ECS_Command *command = ecs_commands_push(commands, ECS_COMMAND_ADD, entity, component, size);
+  if (size > 0) {
+    memcpy(command + 1, data, size);
+  }
+}
+
+void ecs_commands_remove(ECS_Commands *commands, ECS_Entity entity, ECS_Component component) {
+  ecs_commands_push(commands, ECS_COMMAND_REMOVE, entity, component, 0);
+}
+
+void ecs_commands_flush(ECS_Commands *commands, ECS_World *world) {
+  // Resizable arena so it's all one block, walk it the same way it was handed out
+  isize offset = 0;
+  for (u32 i = 0; i < commands->count; i++) {
+    offset = ALIGN_ROUND_UP(offset, alignof(ECS_Command));
+    ECS_Command *command = (ECS_Command *)(commands->arena.base + offset);
+    offset += sizeof(ECS_Command) + command->size;
+
+    if (!ecs_alive(world, command->entity))
+      continue;
+
+    switch (command->kind) {
+    case ECS_COMMAND_DESPAWN:
+      ecs_despawn(world, command->entity);
+      break;
+    case ECS_COMMAND_ADD: {
+      ASSERT(command->size == 0 || command->size == world->components[command->component].size,
+             "Size of data for %s doesn't match the component",
+             world->components[command->component].name);
+
+      void *component = ecs_add(world, command->entity, command->component);
+      if (command->size > 0) {
+        memcpy(component, command + 1, command->size);
+      }
+    } break;
+    case ECS_COMMAND_REMOVE:
+      ecs_remove(world, command->entity, command->component);
+      break;
+    }
+  }
+
+  arena_clear(&commands->arena);
+  commands->count = 0;
+}
@@ -0,0 +1,198 @@
+#ifndef ECS_H
+#define ECS_H
+
+#include "core/arena.h"
+#include "core/common.h"
+#include "core/pool.h"
+
+#include <stdbool.h>
+
+// Archetype component store. Every distinct set of components an entity can have is an archetype,
+// and every archetype keeps its entities in fixed size chunks, each chunk laid out as one column
+// per component (SoA) with the entity handles as the first column. Loops only ever touch the
+// columns they ask for, and only in archetypes that have them all.
+//
+// An archetype's entities are always packed, every chunk full but the last. Removing swaps the
+// archetype's last entity into the hole, adding or removing a component moves the entity (and a
+// copy of its other components) over to the archetype for its new set
+
+// NOTE(ss): Anything that moves entities around (spawn, despawn, add, remove) invalidates component
+// pointers and chunks from queries, so don't do it while iterating, record an ECS_Commands instead
+// and flush it once done
+
+enum ECS_Constants {
+  ECS_MAX_COMPONENTS = 64, // One bit each in an ECS_Mask
+  ECS_MAX_ARCHETYPES = 256,
+  ECS_CHUNK_SIZE = KB(16),
+  ECS_CHUNK_ALIGNMENT = 64,
+  ECS_MAX_CHUNKS = 4096, // 64 MB worth, only touched as they get used
+  ECS_MAX_ENTITIES = 1 << 18,
+  ECS_COMMANDS_RESERVE_SIZE = MB(64),
+};
+
+// Stays valid until the entity is despawned, after that it never resolves to anything again
+typedef Pool_Handle ECS_Entity;
+
+typedef u32 ECS_Component;
+typedef u64 ECS_Mask;
+
+#define ECS_BIT(component) (1ull << (component))
+
+typedef struct ECS_Archetype ECS_Archetype;
+
+typedef struct ECS_Chunk ECS_Chunk;
+struct ECS_Chunk {
+  ECS_Archetype *archetype;
+  ECS_Chunk *prev;
+  ECS_Chunk *next;
+  u32 count;
+  // Columns follow, at the archetype's offsets
+};
+
+struct ECS_Archetype {
+  ECS_Mask mask;
+  u32 chunk_capacity; // Entities per chunk
+  u32 entity_count;
+
+  u32 entities_offset;                          // Column of ECS_Entity, every archetype has one
+  u32 column_offsets[ECS_MAX_COMPONENTS];       // Only good for components in the mask
+  ECS_Component components[ECS_MAX_COMPONENTS]; // The ones in the mask, lowest first
+  u32 component_count;
+
+  ECS_Chunk *first_chunk;
+  ECS_Chunk *last_chunk; // The only one that may not be full
+};
+
+typedef struct ECS_Component_Info ECS_Component_Info;
+struct ECS_Component_Info {
+  isize size;
+  isize alignment;
+  const char *name;
+};
+
+// Where an entity's components live right now
+typedef struct ECS_Record ECS_Record;
+struct ECS_Record {
+  ECS_Chunk *chunk;
+  u32 row;
+};
+
+typedef struct ECS_World ECS_World;
+struct ECS_World {
+  Arena arena;  // Archetypes
+  Pool records; // ECS_Record, the handles out of this are the entities
+  Pool chunks;  // ECS_CHUNK_SIZE blocks
+
+  ECS_Component_Info components[ECS_MAX_COMPONENTS];
+  u32 component_count;
+
+  // Index 0 is the empty archetype, entities with no components still need somewhere to live
+  ECS_Archetype *archetypes; // ECS_MAX_ARCHETYPES of them
+  u32 archetype_count;
+
+  // Bumped whenever an entity moves to a different chunk or row, anything caching component
+  // pointers can check this to know when to look them up again
+  u64 structure_version;
+};
+
+// Matches archetypes that have everything in all and nothing in none
+typedef struct ECS_Query ECS_Query;
+struct ECS_Query {
+  ECS_Mask all;
+  ECS_Mask none;
+};
+
+typedef struct ECS_Iter ECS_Iter;
+struct ECS_Iter {
+  ECS_World *world;
+  ECS_Query query;
+  u32 archetype_index;
+
+  ECS_Chunk *chunk; // Current chunk, only good after ecs_iter_next() returns true
+};
+
+ECS_World ecs_world_make(void);
+void ecs_world_free(ECS_World *world);
+
+// Name should be a string literal or otherwise outlive the world. Size 0 makes a tag, it takes no
+// room in the chunks and only shows up in the mask, for sorting entities into archetypes
+ECS_Component ecs_component_register(ECS_World *world, isize size, isize alignment,
+                                     const char *name);
+
+// Components all start zeroed
+ECS_Entity ecs_spawn(ECS_World *world, ECS_Mask mask);
+void ecs_despawn(ECS_World *world, ECS_Entity entity);
+bool ecs_alive(ECS_World *world, ECS_Entity entity);
+
+// 0 if the entity is dead
+ECS_Mask ecs_mask_of(ECS_World *world, ECS_Entity entity);
+
+// NULL if the entity is dead or doesn't have the component
+void *ecs_get(ECS_World *world, ECS_Entity entity, ECS_Component component);
+
+// Gives back the component, zeroed if it wasn't there yet and left alone if it was
+void *ecs_add(ECS_World *world, ECS_Entity entity, ECS_Component component);
+void ecs_remove(ECS_World *world, ECS_Entity entity, ECS_Component component);
+// Straight over to the archetype for mask in one move, same as a run of adds and removes would end
+// up with but without stopping at every archetype on the way
+void ecs_set_mask(ECS_World *world, ECS_Entity entity, ECS_Mask mask);
+
+static inline bool ecs_query_matches(ECS_Query query, ECS_Mask mask) {
+  return (mask & query.all) == query.all && (mask & query.none) == 0;
+}
+
+// while (ecs_iter_next(&it)) { T *column = ecs_chunk_column(it.chunk, component); ... }
+ECS_Iter ecs_query_iter(ECS_World *world, ECS_Query query);
+bool ecs_iter_next(ECS_Iter *it);
+
+// Every matching chunk in one array, what you want to split a query across jobs. Chunks are in the
+// same order ecs_iter_next() would go over them
+ECS_Chunk **ecs_query_chunks(ECS_World *world, ECS_Query query, Arena *arena, u32 *out_count);
+// Total entities across every matching archetype
+u32 ecs_query_count(ECS_World *world, ECS_Query query);
+
+static inline ECS_Entity *ecs_chunk_entities(ECS_Chunk *chunk) {
+  return (ECS_Entity *)((u8 *)chunk + chunk->archetype->entities_offset);
+}
+
+static inline bool ecs_chunk_has(ECS_Chunk *chunk, ECS_Component component) {
+  return chunk->archetype->mask & ECS_BIT(component);
+}
+
+// NOTE(ss): No check that the archetype has the component, query for it or ecs_chunk_has() first
+static inline void *ecs_chunk_column(ECS_Chunk *chunk, ECS_Component component) {
+  return (u8 *)chunk + chunk->archetype->column_offsets[component];
+}
+
+#define ecs_component_register_type(world, T)                                                      \
+  ecs_component_register(world, sizeof(T), alignof(T), #T)
+
+#define ecs_get_type(world, entity, component, T) ((T *)ecs_get(world, entity, component))
+#define ecs_add_type(world, entity, component, T) ((T *)ecs_add(world, entity, component))
+#define ecs_chunk_column_type(chunk, component, T) ((T *)ecs_chunk_column(chunk, component))
+
+// Command Buffers -------------------------------------------------------------
+
+// Structural changes recorded now and applied later with ecs_commands_flush(), so systems can ask
+// for them while iterating. Not thread safe, give each worker its own (index by
+// job_worker_index()) and flush them one after the other. Commands on entities that are dead by
+// the time they get flushed are skipped
+typedef struct ECS_Commands ECS_Commands;
+struct ECS_Commands {
+  Arena arena;
+  u32 count;
+};
+
+ECS_Commands ecs_commands_make(void);
+void ecs_commands_free(ECS_Commands *commands);
+
+void ecs_commands_despawn(ECS_Commands *commands, ECS_Entity entity);
+// Data is copied in now, NULL leaves the component zeroed (or as it was if already there)
+void ecs_commands_add(ECS_Commands *commands, ECS_Entity entity, ECS_Component component,
+                      const void *data, isize size);
+void ecs_commands_remove(ECS_Commands *commands, ECS_Entity entity, ECS_Component component);
+
+// Applies everything in the order it was recorded, then clears the buffer
+void ecs_commands_flush(ECS_Commands *commands, ECS_World *world);
+
+#endif // ECS_H
@@ -1,5 +1,224 @@
 #include "heap.h"
 
-#include <stdlib.h>
+#include "core/arena.h"
+#include "core/log.h"
 
-void *heap_alloc(usize size) { return malloc(size); }
+#include "os/os.h"
+
+#include <stdatomic.h>
+
+// Sits right in front of every allocation
+typedef struct Heap_Header Heap_Header;
+struct Heap_Header {
+  u64 size; // What was requested, large mappings are just this plus the header rounded to pages
+  u16 size_class;
+  u16 tag;
+  u32 _pad;
+};
+
+typedef struct Heap_Free_Node Heap_Free_Node;
+struct Heap_Free_Node {
+  Heap_Free_Node *next;
+};
+
+enum Heap_Internal_Constants {
+  HEAP_HEADER_SIZE = ALIGN_ROUND_UP(sizeof(Heap_Header), HEAP_ALIGNMENT),
+  HEAP_LARGE_CLASS = UINT16_MAX,
+  HEAP_ARENA_BLOCK_SIZE = MB(64),
+};
+
+typedef struct Heap Heap;
+struct Heap {
+  atomic_flag lock;
+
+  // Small blocks get carved off of here and never go back, they just cycle through the free lists
+  Arena arena;
+  Heap_Free_Node *free_lists[HEAP_SIZE_CLASS_COUNT];
+
+  Heap_Stats stats[HEAP_TAG_COUNT];
+};
+
+translation_local Heap global_heap = {.lock = ATOMIC_FLAG_INIT};
+
+translation_local const char *heap_tag_names[HEAP_TAG_COUNT] = {"General", "Asset", "Render",
+                                                                "Game"};
+
+// NOTE(ss): 16 byte steps up to 128, past that 4 steps per power of 2 so we never waste more than
+// a quarter of a block to rounding
+translation_local u32 size_class_index(usize size) {
+  if (size <= 128)
+    return (size - 1) / 16;
+
+  u32 log = 63 - __builtin_clzll(size - 1);
+  return 8 + (log - 7) * 4 + ((size - 1) >> (log - 2)) - 4;
+}
+
+translation_local usize size_class_size(u32 index) {
+  if (index < 8)
+    return (index + 1) * 16;
+
+  u32 log = 7 + (index - 8) / 4;
+  u32 step = (index - 8) % 4 + 1;
+  return ((usize)1 << log) + step * ((usize)1 << (log - 2));
+}
+
+translation_local void heap_lock(void) {
+  while (atomic_flag_test_and_set_explicit(&global_heap.lock, memory_order_acquire)) {
+    OS_CPU_RELAX();
+  }
+}
+
+translation_local void heap_unlock(void) {
+  atomic_flag_clear_explicit(&global_heap.lock, memory_order_release);
+}
+
+// Call with the lock held
+translation_local void stats_add(Heap_Tag tag, isize size) {
+  Heap_Stats *stats = &global_heap.stats[tag];
+  stats->bytes_in_use += size;
+  stats->bytes_peak = MAX(stats->bytes_peak, stats->bytes_in_use);
+  stats->alloc_count++;
+}
+
+translation_local void stats_remove(Heap_Tag tag, isize size) {
+  Heap_Stats *stats = &global_heap.stats[tag];
+  stats->bytes_in_use -= size;
+  stats->free_count++;
+}
+
+translation_local usize heap_large_mapping_size(usize size) {
+  return ALIGN_ROUND_UP(size + HEAP_HEADER_SIZE, (usize)os_page_size());
+}
+
+void *heap_alloc(usize size) { return heap_alloc_tagged(size, HEAP_TAG_GENERAL); }
+
+void *heap_alloc_tagged(usize size, Heap_Tag tag) {
+  ASSERT(tag < HEAP_TAG_COUNT, "Invalid heap tag %u", tag);
+
+  usize total = MAX(size, 1) + HEAP_HEADER_SIZE;
+  Heap_Header *header = NULL;
+
+  if (total > HEAP_SMALL_MAX) {
+    // Large, straight to the OS, no lock needed for the mapping itself
+    usize mapping_size = heap_large_mapping_size(MAX(size, 1));
+    header = os_reserve(mapping_size);
+    if (header == NULL || !os_commit(header, mapping_size)) {
+      LOG_FATAL("Failed to map %lu bytes for large heap allocation", EXT_ARENA_ALLOCATION,
+                mapping_size);
+    }
+
+    header->size = size;
+    header->size_class = HEAP_LARGE_CLASS;
+    header->tag = tag;
+
+    heap_lock();
+    stats_add(tag, size);
+    heap_unlock();
+  } else {
+    u32 class_index = size_class_index(total);
+
+    heap_lock();
+
+    if (global_heap.arena.base == NULL) {
+      global_heap.arena =
+          arena_make(HEAP_ARENA_BLOCK_SIZE, ARENA_FLAG_RESIZABLE | ARENA_FLAG_CHAINABLE);
+    }
+
+    Heap_Free_Node *node = global_heap.free_lists[class_index];
+    if (node != NULL) {
+      global_heap.free_lists[class_index] = node->next;
+      header = (Heap_Header *)node;
+    } else {
+      header =
+          arena_alloc_nozero(&global_heap.arena, size_class_size(class_index), HEAP_ALIGNMENT);
+    }
+
+    header->size = size;
+    header->size_class = class_index;
+    header->tag = tag;
+
+    stats_add(tag, size);
+
+    heap_unlock();
+  }
+
+  return (u8 *)header + HEAP_HEADER_SIZE;
+}
+
+translation_local Heap_Header *header_from_ptr(void *ptr) {
+  return (Heap_Header *)((u8 *)ptr - HEAP_HEADER_SIZE);
+}
+
+// Actual usable bytes behind ptr
+translation_local usize heap_usable_size(Heap_Header *header) {
+  if (header->size_class == HEAP_LARGE_CLASS)
+    return heap_large_mapping_size(header->size) - HEAP_HEADER_SIZE;
+
+  return size_class_size(header->size_class) - HEAP_HEADER_SIZE;
+}
+
+void heap_free(void *ptr) {
+  if (ptr == NULL)
+    return;
+
+  Heap_Header *header = header_from_ptr(ptr);
+  ASSERT(header->tag < HEAP_TAG_COUNT, "Tried to free pointer not from the heap");
+
+  if (header->size_class == HEAP_LARGE_CLASS) {
+    heap_lock();
+    stats_remove(header->tag, header->size);
+    heap_unlock();
+
+    os_release(header, heap_large_mapping_size(header->size));
+  } else {
+    heap_lock();
+
+    stats_remove(header->tag, header->size);
+
+    u32 class_index = header->size_class;
+    Heap_Free_Node *node = (Heap_Free_Node *)header;
+    node->next = global_heap.free_lists[class_index];
+    global_heap.free_lists[class_index] = node;
+
+    heap_unlock();
+  }
+}
+
+void *heap_realloc(void *ptr, usize new_size) {
+  if (ptr == NULL)
+    return heap_alloc(new_size);
+
+  Heap_Header *header = header_from_ptr(ptr);
+
+  // Still fits in the block we have, just fix up the accounting
+  if (header->size_class != HEAP_LARGE_CLASS && new_size <= heap_usable_size(header)) {
+    heap_lock();
+    Heap_Stats *stats = &global_heap.stats[header->tag];
+    stats->bytes_in_use += (isize)new_size - (isize)header->size;
+    stats->bytes_peak = MAX(stats->bytes_peak, stats->bytes_in_use);
+    heap_unlock();
+
+    header->size = new_size;
+    return ptr;
+  }
+
+  void *new_ptr = heap_alloc_tagged(new_size, header->tag);
+  memcpy(new_ptr, ptr, MIN(new_size, heap_usable_size(header)));
+  heap_free(ptr);
+
+  return new_ptr;
+}
+
+Heap_Stats heap_get_stats(Heap_Tag tag) {
+  ASSERT(tag < HEAP_TAG_COUNT, "Invalid heap tag %u", tag);
+
+  heap_lock();
+  Heap_Stats stats = global_heap.stats[tag];
+  heap_unlock();
+
+  return stats;
+}
+
+const char *heap_tag_name(Heap_Tag tag) {
+  return tag < HEAP_TAG_COUNT ? heap_tag_names[tag] : "Unknown";
+}
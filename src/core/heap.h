@@ -3,7 +3,43 @@
 
 #include "core/common.h"
 
-// Just calling malloc for now
+// General purpose heap, for when something really does need to be freed individually. Small
+// allocations come out of segregated size class free lists carved from a chained arena, large ones
+// go straight to the OS. Everything is tagged so we can see where the memory is going
+
+typedef enum Heap_Tag {
+  HEAP_TAG_GENERAL,
+  HEAP_TAG_ASSET,
+  HEAP_TAG_RENDER,
+  HEAP_TAG_GAME,
+  HEAP_TAG_COUNT,
+} Heap_Tag;
+
+enum Heap_Constants {
+  HEAP_ALIGNMENT = 16,
+  HEAP_SMALL_MAX = KB(32), // Anything bigger than this (header included) is mapped directly
+  HEAP_SIZE_CLASS_COUNT = 40,
+};
+
+typedef struct Heap_Stats Heap_Stats;
+struct Heap_Stats {
+  isize bytes_in_use; // What was asked for, not counting size class rounding
+  isize bytes_peak;
+  u64 alloc_count;
+  u64 free_count;
+};
+
+// All memory returned is aligned to HEAP_ALIGNMENT, and is NOT zeroed
 void *heap_alloc(usize size);
+void *heap_alloc_tagged(usize size, Heap_Tag tag);
+
+// Keeps the tag of the original allocation
+void *heap_realloc(void *ptr, usize new_size);
+
+// NULL is fine
+void heap_free(void *ptr);
+
+Heap_Stats heap_get_stats(Heap_Tag tag);
+const char *heap_tag_name(Heap_Tag tag);
 
 #endif // HEAP_H
@@ -0,0 +1,393 @@
+#include "core/job.h"
+
+#include "core/arena.h"
+#include "core/log.h"
+#include "core/thread_context.h"
+
+#include "os/os.h"
+
+#include <stdio.h>
+
+// Jobs are stored by value, each field is atomic so a thief reading a slot the owner is
+// overwriting is not a data race... the thief's CAS on top fails in that case and it throws the
+// torn copy away
+typedef struct Job_Slot Job_Slot;
+struct Job_Slot {
+  _Atomic(Job_Proc *) proc;
+  _Atomic(void *) data;
+  _Atomic(Job_Counter *) counter;
+};
+
+// Chase-Lev, the owner pushes and takes from the bottom, thieves steal from the top. Fixed size,
+// see "Correct and Efficient Work-Stealing for Weak Memory Models" (Le et al. 2013) for the
+// orderings
+typedef struct Job_Deque Job_Deque;
+struct Job_Deque {
+  alignas(64) _Atomic i64 top;
+  alignas(64) _Atomic i64 bottom;
+  alignas(64) Job_Slot slots[JOB_DEQUE_CAPACITY];
+};
+
+typedef struct Job_Worker Job_Worker;
+struct Job_Worker {
+  Job_Deque deque;
+  OS_Thread thread;
+  u32 index;
+  u32 rng; // For picking steal victims
+};
+
+typedef struct Job_System Job_System;
+struct Job_System {
+  Arena arena;
+  Job_Worker *workers;
+  u32 worker_count;
+  bool pin_workers;
+
+  _Atomic b32 running;
+
+  // Idle workers futex wait on the epoch, pushers only bump it and make the syscall when someone
+  // is actually asleep
+  _Atomic u32 sleeping;
+  _Atomic u32 wake_epoch;
+};
+
+translation_local Job_System job_system;
+thread_local Job_Worker *job_local_worker;
+
+translation_local bool deque_push(Job_Deque *deque, const Job *job) {
+  i64 bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+  i64 top = atomic_load_explicit(&deque->top, memory_order_acquire);
+
+  if (bottom - top >= JOB_DEQUE_CAPACITY)
+    return false;
+
+  Job_Slot *slot = &deque->slots[bottom & (JOB_DEQUE_CAPACITY - 1)];
+  atomic_store_explicit(&slot->proc, job->proc, memory_order_relaxed);
+  atomic_store_explicit(&slot->data, job->data, memory_order_relaxed);
+  atomic_store_explicit(&slot->counter, job->counter, memory_order_relaxed);
+
+  // Publishes the slot to thieves, they load bottom with acquire
+  atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_release);
+
+  return true;
+}
+
+translation_local void slot_read(Job_Slot *slot, Job *out) {
+  out->proc = atomic_load_explicit(&slot->proc, memory_order_relaxed);
+  out->data = atomic_load_explicit(&slot->data, memory_order_relaxed);
+  out->counter = atomic_load_explicit(&slot->counter, memory_order_relaxed);
+}
+
+// Owner only, LIFO so the most recently pushed (likely still in cache) work runs first
+translation_local bool deque_take(Job_Deque *deque, Job *out) {
+  i64 bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+  atomic_store_explicit(&deque->bottom, bottom, memory_order_relaxed);
+  atomic_thread_fence(memory_order_seq_cst);
+  i64 top = atomic_load_explicit(&deque->top, memory_order_relaxed);
+
+  if (top > bottom) {
+    // Was already empty
+    atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+    return false;
+  }
+
+  slot_read(&deque->slots[bottom & (JOB_DEQUE_CAPACITY - 1)], out);
+
+  if (top == bottom) {
+    // Last one, race any thieves for it
+    bool won = atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1,
+                                                       memory_order_seq_cst, memory_order_relaxed);
+    atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+    return won;
+  }
+
+  return true;
+}
+
+// Any thread, FIFO so thieves take the oldest (likely biggest, if work is split recursively) work
+translation_local bool deque_steal(Job_Deque *deque, Job *out) {
+  i64 top = atomic_load_explicit(&deque->top, memory_order_acquire);
+  atomic_thread_fence(memory_order_seq_cst);
+  i64 bottom = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+
+  if (top >= bottom)
+    return false;
+
+  slot_read(&deque->slots[top & (JOB_DEQUE_CAPACITY - 1)], out);
+
+  return atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1, memory_order_seq_cst,
+                                                 memory_order_relaxed);
+}
+
+translation_local bool job_steal(Job_Worker *worker, Job *out) {
+  u32 count = job_system.worker_count;
+  if (count <= 1)
+    return false;
+
+  // xorshift, just needs to spread thieves out
+  worker->rng ^= worker->rng << 13;
+  worker->rng ^= worker->rng >> 17;
+  worker->rng ^= worker->rng << 5;
+
+  u32 start = worker->rng % count;
+  for (u32 i = 0; i < count; i++) {
+    u32 victim = (start + i) % count;
+    if (victim == worker->index)
+      continue;
+
+    if (deque_steal(&job_system.workers[victim].deque, out))
+      return true;
+  }
+
+  return false;
+}
+
+translation_local void job_execute(const Job *job) {
+  job->proc(job->data);
+
+  if (job->counter != NULL) {
+    atomic_fetch_sub_explicit(&job->counter->pending, 1, memory_order_release);
+  }
+}
+
+translation_local bool job_try_run_one(Job_Worker *worker) {
+  Job job;
+  if (deque_take(&worker->deque, &job) || job_steal(worker, &job)) {
+    job_execute(&job);
+    return true;
+  }
+
+  return false;
+}
+
+translation_local void job_wake(u32 count) {
+  // Pairs with the fence in job_idle, either we see them asleep or they see our push
+  atomic_thread_fence(memory_order_seq_cst);
+  if (atomic_load_explicit(&job_system.sleeping, memory_order_relaxed) > 0) {
+    atomic_fetch_add_explicit(&job_system.wake_epoch, 1, memory_order_release);
+    os_futex_wake(&job_system.wake_epoch, count);
+  }
+}
+
+translation_local void job_idle(Job_Worker *worker) {
+  for (u32 i = 0; i < JOB_SPIN_COUNT; i++) {
+    if (job_try_run_one(worker))
+      return;
+    OS_CPU_RELAX();
+  }
+
+  atomic_fetch_add_explicit(&job_system.sleeping, 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_seq_cst);
+
+  // One last look after announcing we're going to sleep, anything pushed after reading the epoch
+  // will bump it and the wait returns right away
+  u32 epoch = atomic_load_explicit(&job_system.wake_epoch, memory_order_acquire);
+  if (!job_try_run_one(worker) && atomic_load_explicit(&job_system.running, memory_order_acquire)) {
+    os_futex_wait(&job_system.wake_epoch, epoch);
+  }
+
+  atomic_fetch_sub_explicit(&job_system.sleeping, 1, memory_order_relaxed);
+}
+
+translation_local void job_worker_main(void *arg) {
+  Job_Worker *worker = arg;
+
+  char name[THREAD_NAME_MAX];
+  snprintf(name, sizeof(name), "job %u", worker->index);
+
+  Thread_Context tctx;
+  thread_context_init(&tctx, name);
+  job_local_worker = worker;
+
+  if (job_system.pin_workers) {
+    thread_set_affinity(worker->index % os_core_count());
+  }
+
+  while (atomic_load_explicit(&job_system.running, memory_order_acquire)) {
+    if (!job_try_run_one(worker)) {
+      job_idle(worker);
+    }
+  }
+
+  // Don't leave anything behind
+  while (job_try_run_one(worker))
+    ;
+
+  job_local_worker = NULL;
+  thread_context_free();
+}
+
+void job_system_init(u32 worker_count, bool pin_workers) {
+  ASSERT(thread_get_context() != NULL,
+         "Job system needs to be started from a thread with a context");
+  ASSERT(job_system.workers == NULL, "Job system already initialized");
+
+  if (worker_count == 0) {
+    worker_count = os_core_count();
+  }
+  worker_count = CLAMP(worker_count, 1, JOB_MAX_WORKERS);
+
+  // Room to push the workers up to the cache lines the deque members want
+  job_system.arena =
+      arena_make(worker_count * sizeof(Job_Worker) + alignof(Job_Worker), ARENA_FLAG_DEFAULTS);
+  arena_set_tag(&job_system.arena, "job_system");
+  job_system.workers = arena_calloc(&job_system.arena, worker_count, Job_Worker);
+  job_system.worker_count = worker_count;
+  job_system.pin_workers = pin_workers;
+
+  atomic_store(&job_system.sleeping, 0);
+  atomic_store(&job_system.wake_epoch, 0);
+  atomic_store(&job_system.running, true);
+
+  for (u32 i = 0; i < worker_count; i++) {
+    Job_Worker *worker = &job_system.workers[i];
+    worker->index = i;
+    worker->rng = 0x9E3779B9u * (i + 1);
+  }
+
+  // The calling thread is worker 0 and only runs jobs while it waits on them
+  job_local_worker = &job_system.workers[0];
+  if (pin_workers) {
+    thread_set_affinity(0);
+  }
+
+  for (u32 i = 1; i < worker_count; i++) {
+    Job_Worker *worker = &job_system.workers[i];
+    worker->thread = os_thread_make(job_worker_main, worker);
+    if (worker->thread.handle == 0) {
+      LOG_FATAL("Failed to create job worker thread %u", EXT_JOB_THREAD, i);
+    }
+  }
+
+  LOG_DEBUG("Job system started with %u workers", worker_count);
+}
+
+void job_system_free(void) {
+  ASSERT(job_local_worker == &job_system.workers[0],
+         "Job system must be freed from the thread that started it");
+
+  // Our own queue never gets drained by us otherwise
+  while (job_try_run_one(job_local_worker))
+    ;
+
+  atomic_store_explicit(&job_system.running, false, memory_order_release);
+  atomic_fetch_add_explicit(&job_system.wake_epoch, 1, memory_order_release);
+  os_futex_wake(&job_system.wake_epoch, UINT32_MAX);
+
+  for (u32 i = 1; i < job_system.worker_count; i++) {
+    os_thread_join(job_system.workers[i].thread);
+  }
+
+  job_local_worker = NULL;
+  arena_free(&job_system.arena);
+  ZERO_STRUCT(&job_system);
+}
+
+u32 job_worker_count(void) { return job_system.worker_count; }
+
+u32 job_worker_index(void) {
+  return job_local_worker != NULL ? job_local_worker->index : UINT32_MAX;
+}
+
+void job_run(Job_Proc *proc, void *data, Job_Counter *counter) {
+  Job job = {.proc = proc, .data = data, .counter = counter};
+  job_run_batch(&job, 1);
+}
+
+void job_run_batch(const Job *jobs, u32 count) {
+  Job_Worker *worker = job_local_worker;
+  ASSERT(worker != NULL, "Jobs can only be run from inside the job system");
+
+  u32 pushed = 0;
+  for (u32 i = 0; i < count; i++) {
+    if (jobs[i].counter != NULL) {
+      atomic_fetch_add_explicit(&jobs[i].counter->pending, 1, memory_order_relaxed);
+    }
+
+    if (deque_push(&worker->deque, &jobs[i])) {
+      pushed++;
+    } else {
+      // Full, no better place for it than right here
+      job_execute(&jobs[i]);
+    }
+  }
+
+  if (pushed > 0) {
+    job_wake(pushed);
+  }
+}
+
+void job_wait(Job_Counter *counter) {
+  Job_Worker *worker = job_local_worker;
+  ASSERT(worker != NULL, "Can only wait on jobs from inside the job system");
+
+  u32 spins = 0;
+  while (!job_counter_done(counter)) {
+    if (job_try_run_one(worker)) {
+      spins = 0;
+    } else if (++spins < JOB_SPIN_COUNT) {
+      OS_CPU_RELAX();
+    } else {
+      // Whatever is left is running on someone else
+      os_thread_yield();
+    }
+  }
+}
+
+typedef struct Job_Range Job_Range;
+struct Job_Range {
+  Job_Range_Proc *proc;
+  void *data;
+  u32 start;
+  u32 end;
+};
+
+translation_local void job_range_run(void *data) {
+  Job_Range *range = data;
+  range->proc(range->data, range->start, range->end);
+}
+
+void job_parallel_for(u32 count, u32 grain_size, Job_Range_Proc *proc, void *data) {
+  if (count == 0)
+    return;
+
+  if (grain_size == 0) {
+    grain_size = MAX(1, count / (job_system.worker_count * JOB_PARALLEL_FOR_SPLIT));
+  }
+
+  // Not worth the trip through the deque
+  if (count <= grain_size || job_local_worker == NULL) {
+    proc(data, 0, count);
+    return;
+  }
+
+  u32 range_count = (count + grain_size - 1) / grain_size;
+
+  // Only has to live until we're done waiting
+  Scratch scratch = thread_get_scratch();
+  Job_Range *ranges = arena_calloc_nozero(scratch.arena, range_count, Job_Range);
+  Job *jobs = arena_calloc_nozero(scratch.arena, range_count, Job);
+
+  Job_Counter counter = {0};
+  for (u32 i = 0; i < range_count; i++) {
+    ranges[i] = (Job_Range){
+        .proc = proc,
+        .data = data,
+        .start = i * grain_size,
+        .end = MIN((i + 1) * grain_size, count),
+    };
+    jobs[i] = (Job){.proc = job_range_run, .data = &ranges[i], .counter = &counter};
+  }
+
+  // Our own deque pops LIFO, so push in reverse and this thread starts from the front
+  for (u32 i = 0; i < range_count / 2; i++) {
+    Job temp = jobs[i];
+    jobs[i] = jobs[range_count - 1 - i];
+    jobs[range_count - 1 - i] = temp;
+  }
+
+  job_run_batch(jobs, range_count);
+  job_wait(&counter);
+
+  thread_end_scratch(&scratch);
+}
@@ -0,0 +1,67 @@
+#ifndef JOB_H
+#define JOB_H
+
+#include "core/common.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+
+// Fork-join job system. One worker thread per core (minus the thread that calls job_system_init,
+// which takes part as worker 0), each owning a Thread_Context and a Chase-Lev work stealing deque.
+// Jobs pushed from a thread go on that thread's deque, idle workers steal from the top of everyone
+// else's. Completion is tracked with counters, and waiting on one runs other jobs in the meantime
+// so it is fine (and expected) to fork more jobs and wait on them from inside a job
+
+enum Job_Constants {
+  JOB_DEQUE_CAPACITY = 4096, // Per worker, must be a power of 2, pushes past this run inline
+  JOB_MAX_WORKERS = 64,
+  JOB_SPIN_COUNT = 64, // Failed steal attempts before a worker goes to sleep
+  JOB_PARALLEL_FOR_SPLIT = 4, // Default ranges per worker, more helps balance uneven work
+};
+
+typedef void Job_Proc(void *data);
+// Handles [start, end) of a parallel for
+typedef void Job_Range_Proc(void *data, u32 start, u32 end);
+
+// Number of unfinished jobs, zero initialize it and hand it to as many job_run calls as you like
+typedef struct Job_Counter Job_Counter;
+struct Job_Counter {
+  _Atomic i32 pending;
+};
+
+typedef struct Job Job;
+struct Job {
+  Job_Proc *proc;
+  void *data;
+  Job_Counter *counter; // May be NULL for fire and forget
+};
+
+// Worker count of 0 means one per core, calling thread must already have a Thread_Context. Pinning
+// puts worker i on core i (wrapping), the calling thread included as worker 0
+void job_system_init(u32 worker_count, bool pin_workers);
+// Waits for the workers to finish whatever is queued and joins them
+void job_system_free(void);
+
+// Including the thread that called job_system_init
+u32 job_worker_count(void);
+// 0 for the thread that called job_system_init, UINT32_MAX for threads outside the job system
+u32 job_worker_index(void);
+
+// Only callable from inside the job system (the init thread or a job)
+void job_run(Job_Proc *proc, void *data, Job_Counter *counter);
+void job_run_batch(const Job *jobs, u32 count);
+
+// Runs other jobs until the counter hits zero
+void job_wait(Job_Counter *counter);
+
+// Splits [0, count) into ranges of about grain_size items and runs proc on each across the workers,
+// returns once they are all done. Grain size of 0 picks one so every worker gets a few ranges.
+// Ranges run on whichever thread grabs them, so per-worker scratch is thread_get_scratch() inside
+// proc and per-worker output can be indexed with job_worker_index()
+void job_parallel_for(u32 count, u32 grain_size, Job_Range_Proc *proc, void *data);
+
+static inline bool job_counter_done(Job_Counter *counter) {
+  return atomic_load_explicit(&counter->pending, memory_order_acquire) == 0;
+}
+
+#endif // JOB_H
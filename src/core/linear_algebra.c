@@ -9,6 +9,8 @@ void vec3_print(vec3 v) { LOG_DEBUG("vec3(%f, %f, %f)", v.x, v.y, v.z); }
 
 void vec4_print(vec4 v) { LOG_DEBUG("vec4(%f, %f, %f, %f)", v.x, v.y, v.z, v.w); }
 
+void quat_print(quat q) { LOG_DEBUG("quat(%f, %f, %f, %f)", q.x, q.y, q.z, q.w); }
+
 void mat4_print(mat4 m) {
     LOG_DEBUG("mat4(%f, %f, %f, %f\n                    %f, %f, %f, %f\n                    %f, "
               "%f, %f, %f\n                    %f, %f, %f, %f)",
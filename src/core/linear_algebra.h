@@ -10,9 +10,20 @@
     We assume a 0 - > 1 NDC and a right handed system, with z pointing toward us
 */
 
-// TODO(ss): I've been looking through godbolt, and mat4_mul_vec4 seems to easily autovectorise in
-// case -O3 and -mavx, we may not need to so explicit SIMD intrinsics but something to look into as
-// we progress
+// NOTE(ss): Autovectorization handles a lot of this at -O3, but not reliably across compilers.
+// Build with -DLINEAR_ALGEBRA_SIMD to get explicit SSE4.1 kernels for the vec4 ops, mat4_mul_vec4,
+// mat4_mul and mat4_transpose, plus AVX2 for mat4_mul when compiling with -mavx2. The scalar
+// versions (*_scalar) are always available as the reference. The SIMD kernels do the same
+// multiplies and adds in the same order as the scalar ones, so results match bit for bit as long as
+// the scalar build isn't contracting into FMAs (-ffp-contract=off). vec4_dot is the exception, it
+// sums pairwise
+#if defined(LINEAR_ALGEBRA_SIMD) && defined(__SSE4_1__)
+#define LINEAR_ALGEBRA_SSE 1
+#include <immintrin.h>
+#if defined(__AVX2__)
+#define LINEAR_ALGEBRA_AVX2 1
+#endif
+#endif
 
 typedef union vec2 vec2;
 union vec2 {
@@ -180,12 +191,37 @@ union mat3 {
   vec3 cols[3];
 };
 
+// mat3 padded out the way GLSL lays one out in uniform and push constant blocks, each column takes
+// 16 bytes
+typedef union mat3x4 mat3x4;
+union mat3x4 {
+  f32 m[3][4];
+  vec4 cols[3];
+};
+
+typedef union quat quat;
+union quat {
+  struct {
+    union {
+      struct {
+        f32 x, y, z;
+      };
+      vec3 xyz;
+    };
+    f32 w;
+  };
+  vec4 xyzw;
+  f32 elements[4];
+};
+
 void vec2_print(vec2 v);
 
 void vec3_print(vec3 v);
 
 void vec4_print(vec4 v);
 
+void quat_print(quat q);
+
 void mat4_print(mat4 m);
 
 #define vec2(x, y) vec2_make(x, y)
@@ -364,7 +400,7 @@ static inline vec4 vec4_make(f32 x, f32 y, f32 z, f32 w) {
 
 static inline f32 vec4_len(vec4 v) { return sqrtf(v.x * v.x + v.y * v.y + v.z * v.z + v.w * v.w); }
 
-static inline vec4 vec4_add(vec4 v1, vec4 v2) {
+static inline vec4 vec4_add_scalar(vec4 v1, vec4 v2) {
   vec4 result;
   result.x = v1.x + v2.x;
   result.y = v1.y + v2.y;
@@ -374,7 +410,7 @@ static inline vec4 vec4_add(vec4 v1, vec4 v2) {
   return result;
 }
 
-static inline vec4 vec4_sub(vec4 v1, vec4 v2) {
+static inline vec4 vec4_sub_scalar(vec4 v1, vec4 v2) {
   vec4 result;
   result.x = v1.x - v2.x;
   result.y = v1.y - v2.y;
@@ -384,7 +420,7 @@ static inline vec4 vec4_sub(vec4 v1, vec4 v2) {
   return result;
 }
 
-static inline vec4 vec4_mul(vec4 v, f32 s) {
+static inline vec4 vec4_mul_scalar(vec4 v, f32 s) {
   vec4 result;
   result.x = v.x * s;
   result.y = v.y * s;
@@ -394,7 +430,7 @@ static inline vec4 vec4_mul(vec4 v, f32 s) {
   return result;
 }
 
-static inline vec4 vec4_div(vec4 v, f32 s) {
+static inline vec4 vec4_div_scalar(vec4 v, f32 s) {
   vec4 result;
   result.x = v.x / s;
   result.y = v.y / s;
@@ -404,7 +440,40 @@ static inline vec4 vec4_div(vec4 v, f32 s) {
   return result;
 }
 
-static inline f32 vec4_dot(vec4 a, vec4 b) { return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w; }
+static inline f32 vec4_dot_scalar(vec4 a, vec4 b) {
+  return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+}
+
+#if LINEAR_ALGEBRA_SSE
+static inline __m128 vec4_load(vec4 v) { return _mm_loadu_ps(v.elements); }
+static inline vec4 vec4_store(__m128 v) {
+  vec4 result;
+  _mm_storeu_ps(result.elements, v);
+  return result;
+}
+
+static inline vec4 vec4_add(vec4 v1, vec4 v2) {
+  return vec4_store(_mm_add_ps(vec4_load(v1), vec4_load(v2)));
+}
+static inline vec4 vec4_sub(vec4 v1, vec4 v2) {
+  return vec4_store(_mm_sub_ps(vec4_load(v1), vec4_load(v2)));
+}
+static inline vec4 vec4_mul(vec4 v, f32 s) {
+  return vec4_store(_mm_mul_ps(vec4_load(v), _mm_set1_ps(s)));
+}
+static inline vec4 vec4_div(vec4 v, f32 s) {
+  return vec4_store(_mm_div_ps(vec4_load(v), _mm_set1_ps(s)));
+}
+static inline f32 vec4_dot(vec4 a, vec4 b) {
+  return _mm_cvtss_f32(_mm_dp_ps(vec4_load(a), vec4_load(b), 0xF1));
+}
+#else
+static inline vec4 vec4_add(vec4 v1, vec4 v2) { return vec4_add_scalar(v1, v2); }
+static inline vec4 vec4_sub(vec4 v1, vec4 v2) { return vec4_sub_scalar(v1, v2); }
+static inline vec4 vec4_mul(vec4 v, f32 s) { return vec4_mul_scalar(v, s); }
+static inline vec4 vec4_div(vec4 v, f32 s) { return vec4_div_scalar(v, s); }
+static inline f32 vec4_dot(vec4 a, vec4 b) { return vec4_dot_scalar(a, b); }
+#endif // LINEAR_ALGEBRA_SSE
 
 static inline vec4 vec4_norm(vec4 v) { return vec4_mul(v, 1.0f / vec4_len(v)); }
 static inline vec4 vecf_norm0(vec4 v) {
@@ -525,7 +594,7 @@ static inline mat4 mat4_perspective(f32 fov, f32 aspect_ratio, f32 z_near, f32 z
   return p;
 }
 
-static inline vec4 mat4_mul_vec4(mat4 m, vec4 v) {
+static inline vec4 mat4_mul_vec4_scalar(mat4 m, vec4 v) {
   vec4 result;
   result.x = m.cols[0].x * v.x;
   result.y = m.cols[0].y * v.x;
@@ -550,13 +619,401 @@ static inline vec4 mat4_mul_vec4(mat4 m, vec4 v) {
   return result;
 }
 
+static inline mat4 mat4_mul_scalar(mat4 left, mat4 right) {
+  mat4 result;
+  result.cols[0] = mat4_mul_vec4_scalar(left, right.cols[0]);
+  result.cols[1] = mat4_mul_vec4_scalar(left, right.cols[1]);
+  result.cols[2] = mat4_mul_vec4_scalar(left, right.cols[2]);
+  result.cols[3] = mat4_mul_vec4_scalar(left, right.cols[3]);
+
+  return result;
+}
+
+static inline mat4 mat4_transpose_scalar(mat4 m) {
+  mat4 result;
+  for (u32 c = 0; c < 4; c++) {
+    for (u32 r = 0; r < 4; r++) {
+      result.m[c][r] = m.m[r][c];
+    }
+  }
+
+  return result;
+}
+
+#if LINEAR_ALGEBRA_SSE
+// Linear combination of the columns, same order of operations as the scalar one
+static inline __m128 mat4_mul_vec4_sse(const mat4 *m, __m128 v) {
+  __m128 result = _mm_mul_ps(_mm_loadu_ps(m->cols[0].elements), _mm_shuffle_ps(v, v, 0x00));
+  result = _mm_add_ps(result,
+                      _mm_mul_ps(_mm_loadu_ps(m->cols[1].elements), _mm_shuffle_ps(v, v, 0x55)));
+  result = _mm_add_ps(result,
+                      _mm_mul_ps(_mm_loadu_ps(m->cols[2].elements), _mm_shuffle_ps(v, v, 0xAA)));
+  result = _mm_add_ps(result,
+                      _mm_mul_ps(_mm_loadu_ps(m->cols[3].elements), _mm_shuffle_ps(v, v, 0xFF)));
+  return result;
+}
+
+static inline vec4 mat4_mul_vec4(mat4 m, vec4 v) {
+  return vec4_store(mat4_mul_vec4_sse(&m, vec4_load(v)));
+}
+
+static inline mat4 mat4_transpose(mat4 m) {
+  __m128 c0 = _mm_loadu_ps(m.cols[0].elements);
+  __m128 c1 = _mm_loadu_ps(m.cols[1].elements);
+  __m128 c2 = _mm_loadu_ps(m.cols[2].elements);
+  __m128 c3 = _mm_loadu_ps(m.cols[3].elements);
+  _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+
+  mat4 result;
+  _mm_storeu_ps(result.cols[0].elements, c0);
+  _mm_storeu_ps(result.cols[1].elements, c1);
+  _mm_storeu_ps(result.cols[2].elements, c2);
+  _mm_storeu_ps(result.cols[3].elements, c3);
+  return result;
+}
+#else
+static inline vec4 mat4_mul_vec4(mat4 m, vec4 v) { return mat4_mul_vec4_scalar(m, v); }
+static inline mat4 mat4_transpose(mat4 m) { return mat4_transpose_scalar(m); }
+#endif // LINEAR_ALGEBRA_SSE
+
+#if LINEAR_ALGEBRA_AVX2
+// Two result columns per iteration, each left column is broadcast into both halves and each half
+// picks its own element of the right columns. Everything goes through 128 bit loads and stores on
+// purpose, GCC copies the by value mat4s in 16 byte pieces and 256 bit accesses on those stall
+#define MAT4_PAIR(low, high) _mm256_insertf128_ps(_mm256_castps128_ps256(low), (high), 1)
 static inline mat4 mat4_mul(mat4 left, mat4 right) {
+  __m128 c0 = _mm_loadu_ps(left.cols[0].elements);
+  __m128 c1 = _mm_loadu_ps(left.cols[1].elements);
+  __m128 c2 = _mm_loadu_ps(left.cols[2].elements);
+  __m128 c3 = _mm_loadu_ps(left.cols[3].elements);
+  __m256 l0 = MAT4_PAIR(c0, c0);
+  __m256 l1 = MAT4_PAIR(c1, c1);
+  __m256 l2 = MAT4_PAIR(c2, c2);
+  __m256 l3 = MAT4_PAIR(c3, c3);
+
+  // Unrolled by hand, -O2 keeps the loop and bounces everything through the stack
+#define MAT4_MUL_PAIR(i)                                                                           \
+  do {                                                                                             \
+    __m256 r = MAT4_PAIR(_mm_loadu_ps(right.cols[i].elements),                                     \
+                         _mm_loadu_ps(right.cols[(i) + 1].elements));                              \
+    __m256 sum = _mm256_mul_ps(l0, _mm256_shuffle_ps(r, r, 0x00));                                 \
+    sum = _mm256_add_ps(sum, _mm256_mul_ps(l1, _mm256_shuffle_ps(r, r, 0x55)));                    \
+    sum = _mm256_add_ps(sum, _mm256_mul_ps(l2, _mm256_shuffle_ps(r, r, 0xAA)));                    \
+    sum = _mm256_add_ps(sum, _mm256_mul_ps(l3, _mm256_shuffle_ps(r, r, 0xFF)));                    \
+    _mm_storeu_ps(result.cols[i].elements, _mm256_castps256_ps128(sum));                           \
+    _mm_storeu_ps(result.cols[(i) + 1].elements, _mm256_extractf128_ps(sum, 1));                   \
+  } while (0)
+
   mat4 result;
-  result.cols[0] = mat4_mul_vec4(left, right.cols[0]);
-  result.cols[1] = mat4_mul_vec4(left, right.cols[1]);
-  result.cols[2] = mat4_mul_vec4(left, right.cols[2]);
-  result.cols[3] = mat4_mul_vec4(left, right.cols[3]);
+  MAT4_MUL_PAIR(0);
+  MAT4_MUL_PAIR(2);
 
   return result;
 }
+#undef MAT4_MUL_PAIR
+#undef MAT4_PAIR
+#elif LINEAR_ALGEBRA_SSE
+static inline mat4 mat4_mul(mat4 left, mat4 right) {
+  mat4 result;
+  _mm_storeu_ps(result.cols[0].elements,
+                mat4_mul_vec4_sse(&left, _mm_loadu_ps(right.cols[0].elements)));
+  _mm_storeu_ps(result.cols[1].elements,
+                mat4_mul_vec4_sse(&left, _mm_loadu_ps(right.cols[1].elements)));
+  _mm_storeu_ps(result.cols[2].elements,
+                mat4_mul_vec4_sse(&left, _mm_loadu_ps(right.cols[2].elements)));
+  _mm_storeu_ps(result.cols[3].elements,
+                mat4_mul_vec4_sse(&left, _mm_loadu_ps(right.cols[3].elements)));
+
+  return result;
+}
+#else
+static inline mat4 mat4_mul(mat4 left, mat4 right) { return mat4_mul_scalar(left, right); }
+#endif
+
+// Inverses --------------------------------------------------------------------
+
+// Also from HandmadeMath, the 4D cross products of pairs of columns come out of 3D crosses and
+// w weighted differences, each row of the inverse is then a combination of those over the
+// determinant
+static inline mat4 mat4_inverse_scalar(mat4 m) {
+  vec3 c01 = vec3_cross(m.cols[0].xyz, m.cols[1].xyz);
+  vec3 c23 = vec3_cross(m.cols[2].xyz, m.cols[3].xyz);
+  vec3 w10 = vec3_sub(vec3_mul(m.cols[0].xyz, m.cols[1].w), vec3_mul(m.cols[1].xyz, m.cols[0].w));
+  vec3 w32 = vec3_sub(vec3_mul(m.cols[2].xyz, m.cols[3].w), vec3_mul(m.cols[3].xyz, m.cols[2].w));
+
+  f32 inv_det = 1.0f / (vec3_dot(c01, w32) + vec3_dot(c23, w10));
+  c01 = vec3_mul(c01, inv_det);
+  c23 = vec3_mul(c23, inv_det);
+  w10 = vec3_mul(w10, inv_det);
+  w32 = vec3_mul(w32, inv_det);
+
+  // These are the rows of the inverse
+  mat4 rows;
+  rows.cols[0].xyz = vec3_add(vec3_cross(m.cols[1].xyz, w32), vec3_mul(c23, m.cols[1].w));
+  rows.cols[0].w = -vec3_dot(m.cols[1].xyz, c23);
+  rows.cols[1].xyz = vec3_sub(vec3_cross(w32, m.cols[0].xyz), vec3_mul(c23, m.cols[0].w));
+  rows.cols[1].w = vec3_dot(m.cols[0].xyz, c23);
+  rows.cols[2].xyz = vec3_add(vec3_cross(m.cols[3].xyz, w10), vec3_mul(c01, m.cols[3].w));
+  rows.cols[2].w = -vec3_dot(m.cols[3].xyz, c01);
+  rows.cols[3].xyz = vec3_sub(vec3_cross(w10, m.cols[2].xyz), vec3_mul(c01, m.cols[2].w));
+  rows.cols[3].w = vec3_dot(m.cols[2].xyz, c01);
+
+  return mat4_transpose_scalar(rows);
+}
+
+#if LINEAR_ALGEBRA_SSE
+// 2x2 blocks packed into one register as (m00, m01, m10, m11), the helpers are A * B, adj(A) * B
+// and A * adj(B), adj(A) being the 2x2 inverse without dividing by the determinant
+#define MAT2_SWIZZLE(v, x, y, z, w) _mm_shuffle_ps((v), (v), _MM_SHUFFLE(w, z, y, x))
+static inline __m128 mat2_mul_sse(__m128 a, __m128 b) {
+  return _mm_add_ps(_mm_mul_ps(a, MAT2_SWIZZLE(b, 0, 3, 0, 3)),
+                    _mm_mul_ps(MAT2_SWIZZLE(a, 1, 0, 3, 2), MAT2_SWIZZLE(b, 2, 1, 2, 1)));
+}
+static inline __m128 mat2_adj_mul_sse(__m128 a, __m128 b) {
+  return _mm_sub_ps(_mm_mul_ps(MAT2_SWIZZLE(a, 3, 3, 0, 0), b),
+                    _mm_mul_ps(MAT2_SWIZZLE(a, 1, 1, 2, 2), MAT2_SWIZZLE(b, 2, 3, 0, 1)));
+}
+static inline __m128 mat2_mul_adj_sse(__m128 a, __m128 b) {
+  return _mm_sub_ps(_mm_mul_ps(a, MAT2_SWIZZLE(b, 3, 0, 3, 0)),
+                    _mm_mul_ps(MAT2_SWIZZLE(a, 1, 0, 3, 2), MAT2_SWIZZLE(b, 2, 1, 2, 1)));
+}
+
+// Block inverse, split into 2x2 A B / C D and every piece of the result comes out of 2x2 products
+// and adjugates. Works the same whether the registers hold rows or columns, the inverse of the
+// transpose is the transpose of the inverse
+static inline mat4 mat4_inverse(mat4 m) {
+  __m128 c0 = _mm_loadu_ps(m.cols[0].elements);
+  __m128 c1 = _mm_loadu_ps(m.cols[1].elements);
+  __m128 c2 = _mm_loadu_ps(m.cols[2].elements);
+  __m128 c3 = _mm_loadu_ps(m.cols[3].elements);
+
+  __m128 a = _mm_movelh_ps(c0, c1);
+  __m128 b = _mm_movehl_ps(c1, c0);
+  __m128 c = _mm_movelh_ps(c2, c3);
+  __m128 d = _mm_movehl_ps(c3, c2);
+
+  // Determinants of all four blocks at once, (|A|, |B|, |C|, |D|)
+  __m128 det_blocks =
+      _mm_sub_ps(_mm_mul_ps(_mm_shuffle_ps(c0, c2, _MM_SHUFFLE(2, 0, 2, 0)),
+                            _mm_shuffle_ps(c1, c3, _MM_SHUFFLE(3, 1, 3, 1))),
+                 _mm_mul_ps(_mm_shuffle_ps(c0, c2, _MM_SHUFFLE(3, 1, 3, 1)),
+                            _mm_shuffle_ps(c1, c3, _MM_SHUFFLE(2, 0, 2, 0))));
+  __m128 det_a = MAT2_SWIZZLE(det_blocks, 0, 0, 0, 0);
+  __m128 det_b = MAT2_SWIZZLE(det_blocks, 1, 1, 1, 1);
+  __m128 det_c = MAT2_SWIZZLE(det_blocks, 2, 2, 2, 2);
+  __m128 det_d = MAT2_SWIZZLE(det_blocks, 3, 3, 3, 3);
+
+  __m128 d_c = mat2_adj_mul_sse(d, c);
+  __m128 a_b = mat2_adj_mul_sse(a, b);
+
+  // Adjugates of the four blocks of the result
+  __m128 x = _mm_sub_ps(_mm_mul_ps(det_d, a), mat2_mul_sse(b, d_c));
+  __m128 w = _mm_sub_ps(_mm_mul_ps(det_a, d), mat2_mul_sse(c, a_b));
+  __m128 y = _mm_sub_ps(_mm_mul_ps(det_b, c), mat2_mul_adj_sse(d, a_b));
+  __m128 z = _mm_sub_ps(_mm_mul_ps(det_c, b), mat2_mul_adj_sse(a, d_c));
+
+  // |M| = |A||D| + |B||C| - tr(adj(A)B adj(D)C)
+  __m128 trace = _mm_mul_ps(a_b, MAT2_SWIZZLE(d_c, 0, 2, 1, 3));
+  trace = _mm_hadd_ps(trace, trace);
+  trace = _mm_hadd_ps(trace, trace);
+  __m128 det = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(det_a, det_d), _mm_mul_ps(det_b, det_c)), trace);
+
+  // Undo the adjugates with the sign pattern and divide by the determinant in one go
+  __m128 inv_det = _mm_div_ps(_mm_setr_ps(1.0f, -1.0f, -1.0f, 1.0f), det);
+  x = _mm_mul_ps(x, inv_det);
+  y = _mm_mul_ps(y, inv_det);
+  z = _mm_mul_ps(z, inv_det);
+  w = _mm_mul_ps(w, inv_det);
+
+  mat4 result;
+  _mm_storeu_ps(result.cols[0].elements, _mm_shuffle_ps(x, y, _MM_SHUFFLE(1, 3, 1, 3)));
+  _mm_storeu_ps(result.cols[1].elements, _mm_shuffle_ps(x, y, _MM_SHUFFLE(0, 2, 0, 2)));
+  _mm_storeu_ps(result.cols[2].elements, _mm_shuffle_ps(z, w, _MM_SHUFFLE(1, 3, 1, 3)));
+  _mm_storeu_ps(result.cols[3].elements, _mm_shuffle_ps(z, w, _MM_SHUFFLE(0, 2, 0, 2)));
+
+  return result;
+}
+#undef MAT2_SWIZZLE
+#else
+static inline mat4 mat4_inverse(mat4 m) { return mat4_inverse_scalar(m); }
+#endif // LINEAR_ALGEBRA_SSE
+
+// Inverse of the upper 3x3 as rows, the cofactors are just cross products of the columns
+static inline void mat4_inverse_rows3(mat4 m, vec3 *row0, vec3 *row1, vec3 *row2) {
+  vec3 a = m.cols[0].xyz, b = m.cols[1].xyz, c = m.cols[2].xyz;
+  vec3 bc = vec3_cross(b, c);
+  f32 inv_det = 1.0f / vec3_dot(a, bc);
+
+  *row0 = vec3_mul(bc, inv_det);
+  *row1 = vec3_mul(vec3_cross(c, a), inv_det);
+  *row2 = vec3_mul(vec3_cross(a, b), inv_det);
+}
+
+// Only for matrices whose bottom row is (0, 0, 0, 1), ie. anything built out of translation,
+// rotation and scale. Inverse of the 3x3 then the translation run back through it
+static inline mat4 mat4_affine_inverse(mat4 m) {
+  vec3 row0, row1, row2;
+  mat4_inverse_rows3(m, &row0, &row1, &row2);
+
+  vec3 t = m.cols[3].xyz;
+  mat4 result;
+  result.cols[0] = vec4_make(row0.x, row1.x, row2.x, 0.0f);
+  result.cols[1] = vec4_make(row0.y, row1.y, row2.y, 0.0f);
+  result.cols[2] = vec4_make(row0.z, row1.z, row2.z, 0.0f);
+  result.cols[3] = vec4_make(-vec3_dot(row0, t), -vec3_dot(row1, t), -vec3_dot(row2, t), 1.0f);
+
+  return result;
+}
+
+// Inverse transpose of the upper 3x3, what normals go through so they stay perpendicular to the
+// surface under non uniform scale. Transposing the inverse's rows just makes them the columns
+static inline mat3 mat4_normal_mat3(mat4 m) {
+  mat3 result;
+  mat4_inverse_rows3(m, &result.cols[0], &result.cols[1], &result.cols[2]);
+
+  return result;
+}
+
+static inline mat3x4 mat3_to_mat3x4(mat3 m) {
+  mat3x4 result;
+  for (u32 col = 0; col < 3; col++) {
+    result.cols[col].xyz = m.cols[col];
+    result.cols[col].w = 0.0f;
+  }
+
+  return result;
+}
+
+// Trig -----------------------------------------------------------------------
+
+// NOTE(ss): Cephes style sinf/cosf without the branches, so loops over it vectorize.
+// Cody-Waite reduces x by the nearest multiple of pi/2 into [-pi/4, pi/4], a minimax polynomial
+// gives both sin and cos of what's left, and the quadrant picks which is which and the signs.
+// Within a couple of ulp of libm for |x| up to a few thousand, past that the reduction starts
+// losing bits so keep angles that grow forever wrapped
+static inline void f32_sincos(f32 x, f32 *sin_out, f32 *cos_out) {
+  // Adding and subtracting 1.5 * 2^23 rounds to nearest even, same as rintf but vectorizes anywhere
+  f32 j = (x * (f32)(2.0 / PI) + 12582912.0f) - 12582912.0f;
+  i32 quadrant = (i32)j;
+
+  // pi/2 split in three so the first two products are exact
+  f32 r = ((x - j * 1.5703125f) - j * 4.837512969970703125e-4f) - j * 7.54978995489188216e-8f;
+  f32 r2 = r * r;
+
+  f32 s = ((-1.9515295891e-4f * r2 + 8.3321608736e-3f) * r2 - 1.6666654611e-1f) * r2 * r + r;
+  f32 c = ((2.443315711809948e-5f * r2 - 1.388731625493765e-3f) * r2 + 4.166664568298827e-2f) *
+              r2 * r2 -
+          0.5f * r2 + 1.0f;
+
+  // Odd quadrants swap sin and cos, then sin is negative in quadrants 2, 3 and cos in 1, 2
+  i32 swap = quadrant & 1;
+  f32 sin = swap ? c : s;
+  f32 cos = swap ? s : c;
+  *sin_out = (quadrant & 2) ? -sin : sin;
+  *cos_out = ((quadrant + 1) & 2) ? -cos : cos;
+}
+
+// Quaternions -----------------------------------------------------------------
+
+// NOTE(ss): Unit quaternions for rotations, w is the real part. quat_mul(a, b) applies b first then
+// a, same as mat4_mul. Anything that builds a rotation hands back a unit quaternion, but products
+// drift after enough of them so quat_norm() every so often if you keep accumulating
+#define quat_identity() ((quat){.x = 0.0f, .y = 0.0f, .z = 0.0f, .w = 1.0f})
+#define quat(xx, yy, zz, ww) ((quat){.x = (xx), .y = (yy), .z = (zz), .w = (ww)})
+
+static inline quat quat_from_axis_angle(vec3 axis, f32 radians) {
+  f32 sin, cos;
+  f32_sincos(radians * 0.5f, &sin, &cos);
+
+  quat result;
+  result.xyz = vec3_mul(vec3_norm(axis), sin);
+  result.w = cos;
+
+  return result;
+}
+
+static inline quat quat_mul(quat a, quat b) {
+  quat result;
+  result.x = a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y;
+  result.y = a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x;
+  result.z = a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w;
+  result.w = a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z;
+
+  return result;
+}
+
+// Same Tait-Bryan Y, X, Z order entities have always used, ie. Ry * Rx * Rz
+static inline quat quat_from_euler(vec3 radians) {
+  f32 sinx, cosx, siny, cosy, sinz, cosz;
+  f32_sincos(radians.x * 0.5f, &sinx, &cosx);
+  f32_sincos(radians.y * 0.5f, &siny, &cosy);
+  f32_sincos(radians.z * 0.5f, &sinz, &cosz);
+
+  quat result;
+  result.x = cosy * sinx * cosz + siny * cosx * sinz;
+  result.y = siny * cosx * cosz - cosy * sinx * sinz;
+  result.z = cosy * cosx * sinz - siny * sinx * cosz;
+  result.w = cosy * cosx * cosz + siny * sinx * sinz;
+
+  return result;
+}
+
+// Inverse, as long as it's a unit quaternion
+static inline quat quat_conjugate(quat q) { return quat(-q.x, -q.y, -q.z, q.w); }
+
+static inline f32 quat_dot(quat a, quat b) { return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w; }
+
+static inline quat quat_norm(quat q) {
+  f32 inv_len = 1.0f / sqrtf(quat_dot(q, q));
+  return quat(q.x * inv_len, q.y * inv_len, q.z * inv_len, q.w * inv_len);
+}
+
+// q and -q are the same rotation, flip b onto a's side so we take the short way around
+static inline quat quat_nlerp(quat a, quat b, f32 t) {
+  f32 bt = quat_dot(a, b) < 0.0f ? -t : t;
+  f32 at = 1.0f - t;
+
+  return quat_norm(
+      quat(a.x * at + b.x * bt, a.y * at + b.y * bt, a.z * at + b.z * bt, a.w * at + b.w * bt));
+}
+
+// Constant angular velocity unlike nlerp, which is slightly faster in the middle, but costs an acos
+// and a couple of sines. Falls back to nlerp when they're close enough that sin(theta) is useless
+static inline quat quat_slerp(quat a, quat b, f32 t) {
+  f32 cos_theta = quat_dot(a, b);
+  f32 sign = 1.0f;
+  if (cos_theta < 0.0f) {
+    cos_theta = -cos_theta;
+    sign = -1.0f;
+  }
+
+  if (cos_theta > 0.9995f)
+    return quat_nlerp(a, b, t);
+
+  f32 theta = acosf(cos_theta);
+  f32 inv_sin_theta = 1.0f / sinf(theta);
+  f32 at = sinf((1.0f - t) * theta) * inv_sin_theta;
+  f32 bt = sinf(t * theta) * inv_sin_theta * sign;
+
+  return quat(a.x * at + b.x * bt, a.y * at + b.y * bt, a.z * at + b.z * bt, a.w * at + b.w * bt);
+}
+
+static inline mat3 quat_to_mat3(quat q) {
+  f32 xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+  f32 xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+  f32 wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+
+  mat3 result;
+  result.cols[0] = vec3(1.0f - 2.0f * (yy + zz), 2.0f * (xy + wz), 2.0f * (xz - wy));
+  result.cols[1] = vec3(2.0f * (xy - wz), 1.0f - 2.0f * (xx + zz), 2.0f * (yz + wx));
+  result.cols[2] = vec3(2.0f * (xz + wy), 2.0f * (yz - wx), 1.0f - 2.0f * (xx + yy));
+
+  return result;
+}
+
+// Cheaper than going through the matrix, v + 2w(u x v) + 2u x (u x v) with u the vector part
+static inline vec3 quat_rotate_vec3(quat q, vec3 v) {
+  vec3 t = vec3_mul(vec3_cross(q.xyz, v), 2.0f);
+  return vec3_add(vec3_add(v, vec3_mul(t, q.w)), vec3_cross(q.xyz, t));
+}
 #endif // LINEAR_ALGEBRA_H
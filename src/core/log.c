@@ -1,21 +1,40 @@
 #include "core/log.h"
 
+#include "core/thread_context.h"
+
 #include <stdarg.h>
 #include <stdio.h>
 
-translation_local const char *level_strings[LOG_MAX_NUM] = {"FATAL", "ERROR", "WARNING", "DEBUG"};
+#ifdef OS_WINDOWS
+#define flockfile _lock_file
+#define funlockfile _unlock_file
+#endif
+
+translation_local const char *level_strings[LOG_MAX_NUM] = {"FATAL", "ERROR", "WARNING", "DEBUG",
+                                                            "INFO"};
 
 void log_message(Log_Level level, const char *file, u64 line, const char *message, ...) {
-  if (level <= LOG_WARN) {
-    fprintf(stderr, "[Ekwos %s]: (%s:%lu) ", level_strings[level], file, line);
+  // Keep lines from different threads from interleaving
+  flockfile(stderr);
+
+  // Only bother naming threads once there's more than the first
+  Thread_Context *tctx = thread_get_context();
+  if (tctx != NULL && tctx->id != 0) {
+    fprintf(stderr, "[Ekwos %s %s]: ", level_strings[level], tctx->name);
   } else {
     fprintf(stderr, "[Ekwos %s]: ", level_strings[level]);
   }
 
+  if (level <= LOG_WARN) {
+    fprintf(stderr, "(%s:%lu) ", file, line);
+  }
+
   va_list args;
   va_start(args, message);
   vfprintf(stderr, message, args);
   va_end(args);
 
   fprintf(stderr, "\n");
+
+  funlockfile(stderr);
 }
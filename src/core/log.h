@@ -24,6 +24,10 @@ typedef enum Exit_Code {
   EXT_GLFW_EXTENSIONS,
   EXT_ARENA_ALLOCATION,
   EXT_ARENA_SIZE,
+  EXT_POOL_SIZE,
+  EXT_JOB_THREAD,
+  EXT_THREAD_COUNT,
+  EXT_ECS_LIMIT,
   EXT_VK_INSTANCE,
   EXT_VK_LAYERS,
   EXT_VK_DEBUG_MESSENGER,
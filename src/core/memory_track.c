@@ -0,0 +1,334 @@
+#include "core/memory_track.h"
+
+#ifdef MEMORY_TRACKING
+
+#include "core/heap.h"
+#include "core/log.h"
+
+#include "os/os.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+
+typedef enum Mem_Track_Site_State {
+  MEM_TRACK_SITE_EMPTY, // Never used, a lookup can stop here
+  MEM_TRACK_SITE_READY,
+  MEM_TRACK_SITE_FREED, // Record was unregistered, free to take but lookups probe past it
+} Mem_Track_Site_State;
+
+// Allocations from one file and line into one arena or pool. The key (file, line, track and
+// generation) only changes under the lock while the site isn't ready, so lookups can check it
+// without taking the lock. Sites go back to the table when their record is unregistered
+typedef struct Mem_Track_Site Mem_Track_Site;
+struct Mem_Track_Site {
+  _Atomic u32 state;
+  _Atomic(const char *) file;
+  _Atomic u32 line;
+  _Atomic(Mem_Track *) track;
+  _Atomic u32 generation;
+
+  _Atomic u64 alloc_count;
+  _Atomic isize alloc_bytes;
+  _Atomic u64 frame_alloc_count;
+  _Atomic isize frame_alloc_bytes;
+};
+
+typedef struct Mem_Track_Registry Mem_Track_Registry;
+struct Mem_Track_Registry {
+  atomic_flag lock;
+  Mem_Track records[MEM_TRACK_MAX_RECORDS];
+  Mem_Track_Site sites[MEM_TRACK_MAX_SITES];
+  b32 sites_full;
+  u64 frame;
+
+  FILE *frame_dump_out;
+  u32 frame_dump_interval;
+};
+
+translation_local Mem_Track_Registry registry = {.lock = ATOMIC_FLAG_INIT};
+
+// Set by the alloc macros right before calling in, taken by the mem_track_alloc() that follows
+translation_local thread_local const char *pending_site_file;
+translation_local thread_local u32 pending_site_line;
+
+translation_local const char *kind_names[MEM_TRACK_KIND_COUNT] = {"arena", "pool"};
+
+translation_local void registry_lock(void) {
+  while (atomic_flag_test_and_set_explicit(&registry.lock, memory_order_acquire)) {
+    OS_CPU_RELAX();
+  }
+}
+
+translation_local void registry_unlock(void) {
+  atomic_flag_clear_explicit(&registry.lock, memory_order_release);
+}
+
+translation_local b32 site_belongs_to(Mem_Track_Site *site, Mem_Track *track) {
+  return atomic_load_explicit(&site->state, memory_order_acquire) == MEM_TRACK_SITE_READY &&
+         atomic_load_explicit(&site->track, memory_order_relaxed) == track &&
+         atomic_load_explicit(&site->generation, memory_order_relaxed) == track->generation;
+}
+
+Mem_Track *mem_track_register(Mem_Track_Kind kind, isize reserved) {
+  Mem_Track *track = NULL;
+
+  registry_lock();
+  for (u32 i = 0; i < MEM_TRACK_MAX_RECORDS; i++) {
+    if (!registry.records[i].active) {
+      track = &registry.records[i];
+      *track = (Mem_Track){
+          .tag = "untagged",
+          .kind = kind,
+          .active = true,
+          .generation = track->generation + 1,
+          .reserved = reserved,
+      };
+      break;
+    }
+  }
+  registry_unlock();
+
+  if (track == NULL) {
+    LOG_WARN("Ran out of memory tracking records, max of %u", MEM_TRACK_MAX_RECORDS);
+  }
+
+  return track;
+}
+
+void mem_track_unregister(Mem_Track *track) {
+  if (track == NULL)
+    return;
+
+  registry_lock();
+
+  // Hand the sites back, otherwise a long session of making and freeing arenas runs the table out
+  for (u32 s = 0; s < MEM_TRACK_MAX_SITES; s++) {
+    Mem_Track_Site *site = &registry.sites[s];
+    if (site_belongs_to(site, track)) {
+      atomic_store_explicit(&site->alloc_count, 0, memory_order_relaxed);
+      atomic_store_explicit(&site->alloc_bytes, 0, memory_order_relaxed);
+      atomic_store_explicit(&site->frame_alloc_count, 0, memory_order_relaxed);
+      atomic_store_explicit(&site->frame_alloc_bytes, 0, memory_order_relaxed);
+      atomic_store_explicit(&site->state, MEM_TRACK_SITE_FREED, memory_order_release);
+    }
+  }
+  registry.sites_full = false;
+
+  // Keep the generation, so the next owner of this record doesn't match any stale lookups
+  u32 generation = track->generation;
+  ZERO_STRUCT(track);
+  track->generation = generation;
+  registry_unlock();
+}
+
+void mem_track_set_tag(Mem_Track *track, const char *tag) {
+  if (track != NULL)
+    track->tag = tag;
+}
+
+void mem_track_site(const char *file, u32 line) {
+  pending_site_file = file;
+  pending_site_line = line;
+}
+
+translation_local b32 site_matches(Mem_Track_Site *site, Mem_Track *track, const char *file,
+                                   u32 line) {
+  return site_belongs_to(site, track) &&
+         atomic_load_explicit(&site->file, memory_order_relaxed) == file &&
+         atomic_load_explicit(&site->line, memory_order_relaxed) == line;
+}
+
+// Finds or makes the site, NULL once the table is full
+translation_local Mem_Track_Site *site_get(Mem_Track *track, const char *file, u32 line) {
+  u64 hash = ((u64)(uintptr_t)file ^ (u64)(uintptr_t)track) * 0x9E3779B97F4A7C15ull + line;
+  hash *= 0x9E3779B97F4A7C15ull;
+  u32 start = hash >> 32;
+
+  // Every allocation after a site's first finds it here without the lock
+  for (u32 probe = 0; probe < MEM_TRACK_MAX_SITES; probe++) {
+    Mem_Track_Site *site = &registry.sites[(start + probe) & (MEM_TRACK_MAX_SITES - 1)];
+    if (site_matches(site, track, file, line))
+      return site;
+
+    if (atomic_load_explicit(&site->state, memory_order_acquire) == MEM_TRACK_SITE_EMPTY)
+      break;
+  }
+
+  // Look again under the lock, someone may have just added it, otherwise take the first free site
+  registry_lock();
+
+  Mem_Track_Site *found = NULL;
+  Mem_Track_Site *free_site = NULL;
+  for (u32 probe = 0; probe < MEM_TRACK_MAX_SITES; probe++) {
+    Mem_Track_Site *site = &registry.sites[(start + probe) & (MEM_TRACK_MAX_SITES - 1)];
+    if (site_matches(site, track, file, line)) {
+      found = site;
+      break;
+    }
+
+    u32 state = atomic_load_explicit(&site->state, memory_order_relaxed);
+    if (state != MEM_TRACK_SITE_READY && free_site == NULL)
+      free_site = site;
+
+    if (state == MEM_TRACK_SITE_EMPTY)
+      break;
+  }
+
+  if (found == NULL && free_site != NULL) {
+    atomic_store_explicit(&free_site->file, file, memory_order_relaxed);
+    atomic_store_explicit(&free_site->line, line, memory_order_relaxed);
+    atomic_store_explicit(&free_site->track, track, memory_order_relaxed);
+    atomic_store_explicit(&free_site->generation, track->generation, memory_order_relaxed);
+    atomic_store_explicit(&free_site->state, MEM_TRACK_SITE_READY, memory_order_release);
+    found = free_site;
+  }
+
+  if (found == NULL && !registry.sites_full) {
+    LOG_WARN("Ran out of memory tracking call sites, max of %u", MEM_TRACK_MAX_SITES);
+    registry.sites_full = true;
+  }
+
+  registry_unlock();
+
+  return found;
+}
+
+void mem_track_alloc(Mem_Track *track, isize size, isize in_use) {
+  const char *file = pending_site_file;
+  pending_site_file = NULL;
+
+  if (track == NULL)
+    return;
+
+  atomic_store_explicit(&track->in_use, in_use, memory_order_relaxed);
+  isize high_water = atomic_load_explicit(&track->high_water, memory_order_relaxed);
+  while (in_use > high_water &&
+         !atomic_compare_exchange_weak_explicit(&track->high_water, &high_water, in_use,
+                                                memory_order_relaxed, memory_order_relaxed)) {
+  }
+  atomic_fetch_add_explicit(&track->alloc_count, 1, memory_order_relaxed);
+  atomic_fetch_add_explicit(&track->frame_alloc_count, 1, memory_order_relaxed);
+  atomic_fetch_add_explicit(&track->frame_alloc_bytes, size, memory_order_relaxed);
+
+  // Called without going through one of the macros, nowhere to put it
+  if (file == NULL)
+    return;
+
+  Mem_Track_Site *site = site_get(track, file, pending_site_line);
+  if (site != NULL) {
+    atomic_fetch_add_explicit(&site->alloc_count, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&site->alloc_bytes, size, memory_order_relaxed);
+    atomic_fetch_add_explicit(&site->frame_alloc_count, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&site->frame_alloc_bytes, size, memory_order_relaxed);
+  }
+}
+
+void mem_track_free(Mem_Track *track, isize in_use) {
+  if (track != NULL)
+    atomic_store_explicit(&track->in_use, in_use, memory_order_relaxed);
+}
+
+void mem_track_add_reserved(Mem_Track *track, isize delta) {
+  if (track != NULL)
+    atomic_fetch_add_explicit(&track->reserved, delta, memory_order_relaxed);
+}
+
+void mem_track_set_frame_dump(FILE *out, u32 interval) {
+  registry_lock();
+  registry.frame_dump_out = out;
+  registry.frame_dump_interval = interval;
+  registry_unlock();
+}
+
+void mem_track_frame_end(void) {
+  registry_lock();
+
+  FILE *out = registry.frame_dump_out;
+  b32 dump = out != NULL && registry.frame_dump_interval > 0 &&
+             registry.frame % registry.frame_dump_interval == 0;
+  if (dump) {
+    fprintf(out, "[Ekwos Memory]: frame %lu allocations\n", registry.frame);
+    fprintf(out, "  %-6s %-40s %10s %12s %12s\n", "kind", "tag / call site", "allocs", "bytes",
+            "in use");
+  }
+
+  for (u32 i = 0; i < MEM_TRACK_MAX_RECORDS; i++) {
+    Mem_Track *track = &registry.records[i];
+    if (!track->active)
+      continue;
+
+    // Swapped out rather than read then zeroed, so allocations in between still count next frame
+    u64 frame_count = atomic_exchange_explicit(&track->frame_alloc_count, 0, memory_order_relaxed);
+    isize frame_bytes =
+        atomic_exchange_explicit(&track->frame_alloc_bytes, 0, memory_order_relaxed);
+
+    if (frame_count > track->frame_alloc_count_peak) {
+      if (registry.frame > MEM_TRACK_WARMUP_FRAMES) {
+        LOG_WARN("%s (%s) hit a new per frame allocation peak: %lu allocations, %ld bytes",
+                 track->tag, kind_names[track->kind], frame_count, frame_bytes);
+      }
+      track->frame_alloc_count_peak = frame_count;
+    }
+
+    if (dump && frame_count > 0) {
+      fprintf(out, "  %-6s %-40s %10lu %12ld %12ld\n", kind_names[track->kind], track->tag,
+              frame_count, frame_bytes, atomic_load_explicit(&track->in_use, memory_order_relaxed));
+
+      for (u32 s = 0; s < MEM_TRACK_MAX_SITES; s++) {
+        Mem_Track_Site *site = &registry.sites[s];
+        u64 site_count = atomic_load_explicit(&site->frame_alloc_count, memory_order_relaxed);
+        if (site_count > 0 && site_belongs_to(site, track)) {
+          char where[256];
+          snprintf(where, sizeof(where), "%s:%u", site->file, site->line);
+          fprintf(out, "    %-44s %10lu %12ld\n", where, site_count,
+                  atomic_load_explicit(&site->frame_alloc_bytes, memory_order_relaxed));
+        }
+      }
+    }
+  }
+
+  for (u32 s = 0; s < MEM_TRACK_MAX_SITES; s++) {
+    atomic_store_explicit(&registry.sites[s].frame_alloc_count, 0, memory_order_relaxed);
+    atomic_store_explicit(&registry.sites[s].frame_alloc_bytes, 0, memory_order_relaxed);
+  }
+
+  registry.frame++;
+  registry_unlock();
+}
+
+void mem_track_dump(FILE *out) {
+  registry_lock();
+
+  fprintf(out, "[Ekwos Memory]: frame %lu\n", registry.frame);
+  fprintf(out, "  %-6s %-24s %12s %12s %12s %10s %10s\n", "kind", "tag", "in use", "high water",
+          "reserved", "allocs", "frame peak");
+
+  for (u32 i = 0; i < MEM_TRACK_MAX_RECORDS; i++) {
+    Mem_Track *track = &registry.records[i];
+    if (!track->active)
+      continue;
+
+    fprintf(out, "  %-6s %-24s %12ld %12ld %12ld %10lu %10lu\n", kind_names[track->kind],
+            track->tag, atomic_load(&track->in_use), atomic_load(&track->high_water),
+            atomic_load(&track->reserved), atomic_load(&track->alloc_count),
+            track->frame_alloc_count_peak);
+
+    for (u32 s = 0; s < MEM_TRACK_MAX_SITES; s++) {
+      Mem_Track_Site *site = &registry.sites[s];
+      if (site_belongs_to(site, track)) {
+        fprintf(out, "    %s:%u, %lu allocations, %ld bytes\n", site->file, site->line,
+                atomic_load(&site->alloc_count), atomic_load(&site->alloc_bytes));
+      }
+    }
+  }
+
+  registry_unlock();
+
+  for (u32 tag = 0; tag < HEAP_TAG_COUNT; tag++) {
+    Heap_Stats stats = heap_get_stats(tag);
+    fprintf(out, "  %-6s %-24s %12ld %12ld %12s %10lu %10s\n", "heap", heap_tag_name(tag),
+            stats.bytes_in_use, stats.bytes_peak, "-", stats.alloc_count, "-");
+  }
+}
+
+#endif // MEMORY_TRACKING
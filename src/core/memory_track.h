@@ -0,0 +1,83 @@
+#ifndef MEMORY_TRACK_H
+#define MEMORY_TRACK_H
+
+#include "core/common.h"
+
+#include <stdatomic.h>
+#include <stdio.h>
+
+// Compile with -DMEMORY_TRACKING to keep track of how much every arena and pool actually uses, so
+// we can right size reservations and catch allocation regressions frame to frame. Without it all of
+// this compiles away to nothing
+//
+// Allocations are also counted per call site (file and line) under each arena or pool, the alloc
+// macros in arena.h, pool.h and packed_array.h note where they're called from before calling in
+
+typedef enum Mem_Track_Kind {
+  MEM_TRACK_ARENA,
+  MEM_TRACK_POOL,
+  MEM_TRACK_KIND_COUNT,
+} Mem_Track_Kind;
+
+enum Mem_Track_Constants {
+  MEM_TRACK_MAX_RECORDS = 128,
+  MEM_TRACK_MAX_SITES = 1024,          // Power of 2, across all arenas and pools
+  MEM_TRACK_WARMUP_FRAMES = 120,       // Loading and such, no per frame peak warnings before
+  MEM_TRACK_FRAME_DUMP_INTERVAL = 600, // Frames between per frame summaries, 10 s at 60 fps
+};
+
+// NOTE(ss): Counters get bumped from whatever thread allocates (job workers included) while the
+// main thread resets them at the end of the frame, so they're atomics. Relaxed, they're only stats
+typedef struct Mem_Track Mem_Track;
+struct Mem_Track {
+  const char *tag;
+  Mem_Track_Kind kind;
+  b32 active;
+  u32 generation; // Bumped every time the record is reused, sites only count for their own
+
+  _Atomic isize reserved;
+  _Atomic isize in_use;
+  _Atomic isize high_water;
+  _Atomic u64 alloc_count;
+
+  // Reset every frame
+  _Atomic u64 frame_alloc_count;
+  _Atomic isize frame_alloc_bytes;
+  u64 frame_alloc_count_peak; // Only touched at the end of the frame
+};
+
+#ifdef MEMORY_TRACKING
+Mem_Track *mem_track_register(Mem_Track_Kind kind, isize reserved);
+void mem_track_unregister(Mem_Track *track);
+void mem_track_set_tag(Mem_Track *track, const char *tag);
+
+// Where the next tracked allocation on this thread is coming from, used up by that allocation
+void mem_track_site(const char *file, u32 line);
+#define MEM_TRACK_SITE() mem_track_site(__FILE__, __LINE__)
+
+// in_use is what the allocator reports after the alloc or free
+void mem_track_alloc(Mem_Track *track, isize size, isize in_use);
+void mem_track_free(Mem_Track *track, isize in_use);
+void mem_track_add_reserved(Mem_Track *track, isize delta);
+
+// Resets per frame counts, warns if something allocated more times in a frame than it ever has.
+// Every interval frames it also writes what allocated that frame, and from where, to out
+void mem_track_frame_end(void);
+void mem_track_set_frame_dump(FILE *out, u32 interval);
+
+// Table of every live arena and pool, their call sites, plus the heap tags
+void mem_track_dump(FILE *out);
+#else
+#define mem_track_register(kind, reserved) NULL
+#define mem_track_unregister(track) VOID_PROC
+#define mem_track_set_tag(track, tag) ((void)(track), (void)(tag))
+#define MEM_TRACK_SITE() VOID_PROC
+#define mem_track_alloc(track, size, in_use) VOID_PROC
+#define mem_track_free(track, in_use) VOID_PROC
+#define mem_track_add_reserved(track, delta) VOID_PROC
+#define mem_track_frame_end() VOID_PROC
+#define mem_track_set_frame_dump(out, interval) ((void)(out), (void)(interval))
+#define mem_track_dump(out) VOID_PROC
+#endif // MEMORY_TRACKING
+
+#endif // MEMORY_TRACK_H
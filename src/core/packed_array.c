@@ -0,0 +1,161 @@
+#include "core/packed_array.h"
+
+#include "core/log.h"
+
+Packed_Array packed_array_make(isize capacity, isize element_size, isize element_alignment) {
+  ASSERT(capacity > 0 && capacity <= UINT32_MAX, "Requested packed array capacity out of range");
+
+  element_size = ALIGN_ROUND_UP(element_size, element_alignment);
+
+  // Everything in the one allocation. The arena only starts out max_align_t aligned, so leave
+  // room to push the elements up to element_alignment
+  isize total_size = element_alignment + ALIGN_ROUND_UP(capacity * element_size, alignof(u32)) +
+                     capacity * sizeof(u32) * 4;
+
+  Packed_Array pa = {
+      .arena = arena_make(total_size, ARENA_FLAG_DEFAULTS),
+      .element_size = element_size,
+      .capacity = capacity,
+  };
+
+  pa.dense = arena_alloc(&pa.arena, capacity * element_size, element_alignment);
+  pa.dense_to_slot = arena_calloc_nozero(&pa.arena, capacity, u32);
+  pa.slot_to_dense = arena_calloc_nozero(&pa.arena, capacity, u32);
+  pa.generations = arena_calloc(&pa.arena, capacity, u32);
+  pa.free_slots = arena_calloc_nozero(&pa.arena, capacity, u32);
+
+  // Track by elements instead, the arena is just one big up front allocation
+  mem_track_unregister(pa.arena.track);
+  pa.arena.track = NULL;
+  pa.track = mem_track_register(MEM_TRACK_POOL, capacity * element_size);
+
+  return pa;
+}
+
+void packed_array_free(Packed_Array *pa) {
+  mem_track_unregister(pa->track);
+  arena_free(&pa->arena);
+  ZERO_STRUCT(pa);
+}
+
+void packed_array_set_tag(Packed_Array *pa, const char *tag) { mem_track_set_tag(pa->track, tag); }
+
+void *(packed_array_alloc)(Packed_Array *pa, Pool_Handle *out_handle) {
+  if (pa->count >= pa->capacity) {
+    LOG_FATAL("Packed array is full, capacity of %u elements", EXT_POOL_SIZE, pa->capacity);
+  }
+
+  u32 slot = 0;
+  if (pa->free_count > 0) {
+    slot = pa->free_slots[--pa->free_count];
+  } else {
+    slot = pa->slot_last_used++;
+
+    // Fresh slot, generation 0 is reserved for nil handles
+    pa->generations[slot] = 1;
+  }
+
+  u32 dense_index = pa->count++;
+  pa->slot_to_dense[slot] = dense_index;
+  pa->dense_to_slot[dense_index] = slot;
+
+  void *ptr = pa->dense + dense_index * pa->element_size;
+  ZERO_SIZE(ptr, pa->element_size);
+
+  mem_track_alloc(pa->track, pa->element_size, pa->count * pa->element_size);
+
+  if (out_handle != NULL) {
+    *out_handle = (Pool_Handle){.index = slot, .generation = pa->generations[slot]};
+  }
+
+  return ptr;
+}
+
+void packed_array_pop(Packed_Array *pa, Pool_Handle handle) {
+  ASSERT(packed_array_handle_valid(pa, handle),
+         "Tried to pop packed array element with stale handle");
+
+  u32 slot = handle.index;
+  u32 hole = pa->slot_to_dense[slot];
+  u32 last = pa->count - 1;
+
+  // Swap the last element down into the hole to keep everything packed
+  if (hole != last) {
+    memcpy(pa->dense + hole * pa->element_size, pa->dense + last * pa->element_size,
+           pa->element_size);
+
+    u32 moved_slot = pa->dense_to_slot[last];
+    pa->dense_to_slot[hole] = moved_slot;
+    pa->slot_to_dense[moved_slot] = hole;
+  }
+  pa->count--;
+
+  // Invalidate any handles still out there, and skip nil generation on wrap around
+  pa->generations[slot]++;
+  if (pa->generations[slot] == 0)
+    pa->generations[slot] = 1;
+
+  pa->slot_to_dense[slot] = UINT32_MAX;
+  pa->free_slots[pa->free_count++] = slot;
+
+  mem_track_free(pa->track, pa->count * pa->element_size);
+}
+
+void packed_array_swap(Packed_Array *pa, u32 a, u32 b) {
+  ASSERT(a < pa->count && b < pa->count, "Packed array swap of %u and %u out of range", a, b);
+  if (a == b)
+    return;
+
+  // Through a small buffer a chunk at a time, elements can be any size
+  u8 *first = pa->dense + a * pa->element_size;
+  u8 *second = pa->dense + b * pa->element_size;
+  u8 buffer[64];
+  for (isize offset = 0; offset < pa->element_size; offset += sizeof(buffer)) {
+    isize size = MIN((isize)sizeof(buffer), pa->element_size - offset);
+    memcpy(buffer, first + offset, size);
+    memcpy(first + offset, second + offset, size);
+    memcpy(second + offset, buffer, size);
+  }
+
+  u32 slot_a = pa->dense_to_slot[a];
+  u32 slot_b = pa->dense_to_slot[b];
+  pa->dense_to_slot[a] = slot_b;
+  pa->dense_to_slot[b] = slot_a;
+  pa->slot_to_dense[slot_a] = b;
+  pa->slot_to_dense[slot_b] = a;
+}
+
+bool packed_array_handle_valid(Packed_Array *pa, Pool_Handle handle) {
+  return handle.index < pa->slot_last_used && handle.generation != 0 &&
+         pa->generations[handle.index] == handle.generation &&
+         pa->slot_to_dense[handle.index] < pa->count;
+}
+
+void *packed_array_get(Packed_Array *pa, Pool_Handle handle) {
+  if (!packed_array_handle_valid(pa, handle))
+    return NULL;
+
+  return pa->dense + pa->slot_to_dense[handle.index] * pa->element_size;
+}
+
+Pool_Handle packed_array_handle_at(Packed_Array *pa, u32 dense_index) {
+  ASSERT(dense_index < pa->count, "Packed array index %u out of range", dense_index);
+
+  u32 slot = pa->dense_to_slot[dense_index];
+  return (Pool_Handle){.index = slot, .generation = pa->generations[slot]};
+}
+
+Pool_Handle packed_array_handle_of(Packed_Array *pa, void *ptr) {
+  ASSERT((u8 *)ptr >= pa->dense && (u8 *)ptr < pa->dense + pa->count * pa->element_size,
+         "Tried to use packed array element outside of the live range");
+
+  return packed_array_handle_at(pa, ((u8 *)ptr - pa->dense) / pa->element_size);
+}
+
+void *packed_array_as_array(Packed_Array *pa, u32 *out_count) {
+  if (out_count != NULL) {
+    *out_count = pa->count;
+  }
+
+  return pa->dense;
+}
@@ -0,0 +1,73 @@
+#ifndef PACKED_ARRAY_H
+#define PACKED_ARRAY_H
+
+#include "core/arena.h"
+#include "core/pool.h"
+
+#include <stdbool.h>
+
+// Sparse set, the elements themselves are always packed at the front of the dense array so looping
+// over them never touches a dead one. Removing swaps the last element into the hole, so anything
+// that needs to hold on to an element holds a handle, which goes through the slot indirection
+// table (same Pool_Handle layout, index is the slot, not the dense position)
+
+// NOTE(ss): Pointers into the dense array are only good until the next pop, since that moves
+// the last element around
+typedef struct Packed_Array Packed_Array;
+struct Packed_Array {
+  Arena arena;
+  u8 *dense;
+
+  // Dense position -> slot, needed to fix up the indirection when we swap an element down
+  u32 *dense_to_slot;
+
+  // Slot -> dense position, and a generation per slot to catch stale handles
+  u32 *slot_to_dense;
+  u32 *generations;
+
+  u32 *free_slots; // Stack
+  u32 free_count;
+  u32 slot_last_used;
+
+  isize element_size;
+  u32 capacity;
+  u32 count;
+
+  Mem_Track *track; // NULL unless built with MEMORY_TRACKING
+};
+
+Packed_Array packed_array_make(isize capacity, isize element_size, isize element_alignment);
+void packed_array_free(Packed_Array *pa);
+
+// Name that shows up in memory tracking dumps
+void packed_array_set_tag(Packed_Array *pa, const char *tag);
+
+// Memory returned is zeroed, and is always at the end of the dense array
+void *packed_array_alloc(Packed_Array *pa, Pool_Handle *out_handle);
+void packed_array_pop(Packed_Array *pa, Pool_Handle handle);
+
+#ifdef MEMORY_TRACKING
+// Noting the call site first, see arena.h
+#define packed_array_alloc(pa, out_handle) (MEM_TRACK_SITE(), (packed_array_alloc)(pa, out_handle))
+#endif
+
+// Swaps the elements at two dense positions, handles to either still point at the same element
+void packed_array_swap(Packed_Array *pa, u32 a, u32 b);
+
+// NULL if the handle is stale or was never valid
+void *packed_array_get(Packed_Array *pa, Pool_Handle handle);
+bool packed_array_handle_valid(Packed_Array *pa, Pool_Handle handle);
+
+// Handle for the element currently at this dense position, or that this pointer points to
+Pool_Handle packed_array_handle_at(Packed_Array *pa, u32 dense_index);
+Pool_Handle packed_array_handle_of(Packed_Array *pa, void *ptr);
+
+// Every element in [0, out_count) is live
+void *packed_array_as_array(Packed_Array *pa, u32 *out_count);
+
+#define packed_array_make_type(c, T) packed_array_make(c, sizeof(T), alignof(T))
+
+#define packed_array_as_array_type(pa_ptr, out_count_ptr, T)                                       \
+  (T *)packed_array_as_array(pa_ptr, out_count_ptr)
+
+#endif // PACKED_ARRAY_H
@@ -2,61 +2,149 @@
 #include "core/log.h"
 
 Pool pool_make(isize count, isize block_size, isize block_alignment) {
+  ASSERT(count > 0 && count <= UINT32_MAX, "Requested pool block count is out of range");
+
+  block_size = ALIGN_ROUND_UP(block_size, block_alignment);
+  isize occupied_words = (count + 63) / 64;
+
+  // Everything in the one allocation. The arena only starts out max_align_t aligned, so leave
+  // room to push the slots up to block_alignment
+  isize total_size = block_alignment + ALIGN_ROUND_UP(count * block_size, alignof(u64)) +
+                     occupied_words * sizeof(u64) + count * sizeof(u32) * 2;
+
   Pool pool = {
-      .arena = arena_make(count * block_size, ARENA_FLAG_DEFAULTS),
-      .free_block = NULL,
-      .block_size = ALIGN_ROUND_UP(block_size, block_alignment),
+      .arena = arena_make(total_size, ARENA_FLAG_DEFAULTS),
+      .block_size = block_size,
+      .capacity = count,
+      .free_count = 0,
       .block_last_occupied = 0,
   };
 
-  ASSERT(block_size >= sizeof(Pool_Block), "Requested pool block size is too small");
+  pool.slots = arena_alloc(&pool.arena, count * block_size, block_alignment);
+  pool.occupied = arena_calloc(&pool.arena, occupied_words, u64);
+  pool.generations = arena_calloc(&pool.arena, count, u32);
+  pool.free_indices = arena_calloc_nozero(&pool.arena, count, u32);
+
+  // Track by blocks instead, the arena is just one big up front allocation
+  mem_track_unregister(pool.arena.track);
+  pool.arena.track = NULL;
+  pool.track = mem_track_register(MEM_TRACK_POOL, count * block_size);
 
   return pool;
 }
 
 void pool_free(Pool *pool) {
+  mem_track_unregister(pool->track);
   arena_free(&pool->arena);
   ZERO_STRUCT(pool);
 }
 
-void *pool_alloc(Pool *pool) {
-  void *ptr = NULL;
+void pool_set_tag(Pool *pool, const char *tag) { mem_track_set_tag(pool->track, tag); }
+
+translation_local u32 pool_index_of(Pool *pool, void *ptr) {
+  ASSERT((u8 *)ptr >= pool->slots && (u8 *)ptr < pool->slots + pool->capacity * pool->block_size,
+         "Tried to use pool element outside of pool");
+
+  isize byte_offset = (u8 *)ptr - pool->slots;
+  ASSERT(byte_offset % pool->block_size == 0, "Pointer is not at the start of a pool slot");
+
+  return byte_offset / pool->block_size;
+}
+
+void *(pool_alloc_handle)(Pool *pool, Pool_Handle *out_handle) {
+  u32 index = 0;
 
-  // We have a free block! Take that open spot first
-  if (pool->free_block != NULL) {
-    ptr = pool->free_block;
-    pool->free_block = pool->free_block->next;
+  // We have a free slot! Take that open spot first
+  if (pool->free_count > 0) {
+    index = pool->free_indices[--pool->free_count];
   } else {
-    // Don't have a free block, add to the end alignment is 1 since we can just pack these like an
-    // array, as well we can use the arena logic to resize and check capacity and such
-    ptr = arena_alloc(&pool->arena, pool->block_size, 1);
-    pool->block_last_occupied++;
+    // High water mark is only ever below capacity if everything below it is occupied
+    if (pool->block_last_occupied >= pool->capacity) {
+      LOG_FATAL("Pool is full, capacity of %u blocks", EXT_POOL_SIZE, pool->capacity);
+    }
+    index = pool->block_last_occupied;
+
+    // Fresh slot, generation 0 is reserved for nil handles
+    pool->generations[index] = 1;
+  }
+
+  pool->occupied[index / 64] |= (1ull << (index % 64));
+  pool->block_last_occupied = MAX(pool->block_last_occupied, index + 1);
+
+  void *ptr = pool->slots + index * pool->block_size;
+  ZERO_SIZE(ptr, pool->block_size);
+
+  pool->live_count++;
+  mem_track_alloc(pool->track, pool->block_size, pool->live_count * pool->block_size);
+
+  if (out_handle != NULL) {
+    *out_handle = (Pool_Handle){.index = index, .generation = pool->generations[index]};
   }
 
   return ptr;
 }
 
-void pool_pop(Pool *pool, void *ptr) {
-  void *pool_base = pool->arena.base;
-  void *pool_filled = pool->arena.base + pool->arena.next_offset;
-  ASSERT(ptr >= pool_base && ptr <= pool_filled, "Tried to pop pool element outside of pool");
+void *(pool_alloc)(Pool *pool) { return (pool_alloc_handle)(pool, NULL); }
 
-  ZERO_SIZE(ptr, pool->block_size);
+translation_local void pool_pop_index(Pool *pool, u32 index) {
+  ASSERT(pool_is_occupied(pool, index), "Tried to pop pool element that is not occupied");
 
-  // TODO(ss): Seems to be working, but needs more robust verification
-  // Checks if the one we are freeing is the very last one
-  {
-    isize last_block_offset = (pool->block_last_occupied - 1) * pool->block_size;
-    void *last_block_ptr = (void *)(last_block_offset + (isize)pool->arena.base);
-    if (last_block_ptr == ptr)
-      pool->block_last_occupied--;
+  pool->occupied[index / 64] &= ~(1ull << (index % 64));
+
+  // Invalidate any handles still out there, and skip nil generation on wrap around
+  pool->generations[index]++;
+  if (pool->generations[index] == 0)
+    pool->generations[index] = 1;
+
+  pool->free_indices[pool->free_count++] = index;
+
+  pool->live_count--;
+  mem_track_free(pool->track, pool->live_count * pool->block_size);
+
+  // Pull the high water mark back down past any trailing empty slots
+  while (pool->block_last_occupied > 0 && !pool_is_occupied(pool, pool->block_last_occupied - 1)) {
+    pool->block_last_occupied--;
   }
+}
 
-  // Add this to the start of linked list
-  Pool_Block *new_free = (Pool_Block *)ptr;
-  new_free->next = pool->free_block;
+void pool_pop(Pool *pool, void *ptr) { pool_pop_index(pool, pool_index_of(pool, ptr)); }
+
+void pool_pop_handle(Pool *pool, Pool_Handle handle) {
+  ASSERT(pool_handle_valid(pool, handle), "Tried to pop pool element with stale handle");
+  pool_pop_index(pool, handle.index);
+}
+
+bool pool_handle_valid(Pool *pool, Pool_Handle handle) {
+  return handle.index < pool->capacity && handle.generation != 0 &&
+         pool->generations[handle.index] == handle.generation &&
+         pool_is_occupied(pool, handle.index);
+}
+
+void *pool_get(Pool *pool, Pool_Handle handle) {
+  if (!pool_handle_valid(pool, handle))
+    return NULL;
+
+  return pool->slots + handle.index * pool->block_size;
+}
+
+Pool_Handle pool_handle_of(Pool *pool, void *ptr) {
+  u32 index = pool_index_of(pool, ptr);
+  return (Pool_Handle){.index = index, .generation = pool->generations[index]};
+}
+
+u32 pool_next_occupied(const Pool *pool, u32 index) {
+  while (index < pool->block_last_occupied) {
+    u64 word = pool->occupied[index / 64] >> (index % 64);
+    if (word != 0) {
+      index += __builtin_ctzll(word);
+      break;
+    }
+
+    // Nothing left in this word, jump to the start of the next one
+    index = (index / 64 + 1) * 64;
+  }
 
-  pool->free_block = new_free;
+  return MIN(index, pool->block_last_occupied);
 }
 
 void *pool_as_array(Pool *pool, u32 *out_last_index) {
@@ -64,5 +152,5 @@ void *pool_as_array(Pool *pool, u32 *out_last_index) {
     *out_last_index = pool->block_last_occupied;
   }
 
-  return pool->arena.base;
+  return pool->slots;
 }
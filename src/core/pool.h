@@ -2,26 +2,43 @@
 #define POOL_H
 
 #include "core/arena.h"
+#include "core/memory_track.h"
 
-typedef struct Pool_Block Pool_Block;
-struct Pool_Block {
-  Pool_Block *next;
-};
+#include <stdbool.h>
 
 // NOTE(ss): Mostly plan on using this as an array with a free list...
 // not nessecarily like a general purpose pool allocator
 
-// Backed by an arena, this may not be great, since using arena functions we may be going through a
-// lot of logic that isn't neseccary for this data structure? Need to think more.
+// Handles stay valid until the slot they point to is popped, after that the generation won't
+// match anymore and looking them up gives back NULL instead of whatever moved in after
+typedef struct Pool_Handle Pool_Handle;
+struct Pool_Handle {
+  u32 index;
+  u32 generation;
+};
+
+// Generation 0 is never handed out, so a zeroed handle is always invalid
+#define POOL_HANDLE_NIL ((Pool_Handle){0})
+
+// Slots, generations, free indices, and occupancy bits all live in the one arena. The free list is
+// kept off to the side so popped slots are left alone, and iteration goes by the occupancy bits
 typedef struct Pool Pool;
 struct Pool {
   Arena arena;
-  Pool_Block *free_block;
+  u8 *slots;
+  u32 *generations;
+  u32 *free_indices; // Stack
+  u64 *occupied;     // Bitset, one bit per slot
+
   isize block_size;
+  u32 capacity;
+  u32 free_count;
+  u32 live_count;
+
+  Mem_Track *track; // NULL unless built with MEMORY_TRACKING
 
-  // We need to keep track of the last occupied index if we want to make sure to loop through all
-  // elements in a pool, but do we want do do this??
-  isize block_last_occupied;
+  // One past the last occupied slot, so looping up to this covers every live element
+  u32 block_last_occupied;
 };
 
 // Allocates it's own memory
@@ -32,11 +49,38 @@ Pool pool_make_backing(void *backing, isize block_count, isize block_size, isize
 
 void pool_free(Pool *pool);
 
+// Name that shows up in memory tracking dumps
+void pool_set_tag(Pool *pool, const char *tag);
+
+// Memory returned is zeroed
 void *pool_alloc(Pool *pool);
 void pool_pop(Pool *pool, void *ptr);
 
+void *pool_alloc_handle(Pool *pool, Pool_Handle *out_handle);
+void pool_pop_handle(Pool *pool, Pool_Handle handle);
+
+#ifdef MEMORY_TRACKING
+// Noting the call site first, see arena.h
+#define pool_alloc(pool) (MEM_TRACK_SITE(), (pool_alloc)(pool))
+#define pool_alloc_handle(pool, out_handle)                                                        \
+  (MEM_TRACK_SITE(), (pool_alloc_handle)(pool, out_handle))
+#endif
+
+// NULL if the handle is stale or was never valid
+void *pool_get(Pool *pool, Pool_Handle handle);
+Pool_Handle pool_handle_of(Pool *pool, void *ptr);
+bool pool_handle_valid(Pool *pool, Pool_Handle handle);
+
+static inline bool pool_is_occupied(const Pool *pool, u32 index) {
+  return (pool->occupied[index / 64] >> (index % 64)) & 1;
+}
+
+// Next occupied slot at or after index, block_last_occupied if there are no more. Skips whole words
+// of empty slots at a time
+u32 pool_next_occupied(const Pool *pool, u32 index);
+
 // Cast this as your underlying type to access it like an array!
-// Use pool->blocks_occupied
+// Use pool->blocks_occupied, and pool_next_occupied() to skip the empty slots
 void *pool_as_array(Pool *pool, u32 *out_last_index);
 
 #define pool_make_type(c, T) pool_make(c, sizeof(T), alignof(T))
@@ -0,0 +1,326 @@
+#include "core/ring_queue.h"
+
+#include "core/log.h"
+
+#include "os/os.h"
+
+translation_local u32 round_up_pow2(u32 value) {
+  u32 result = 1;
+  while (result < value) {
+    result <<= 1;
+  }
+  return result;
+}
+
+// Signal ----------------------------------------------------------------------
+
+translation_local void signal_notify(Ring_Queue_Signal *signal) {
+  // Pairs with the fence in signal_prepare, either we see the waiter or it sees our push/pop
+  atomic_thread_fence(memory_order_seq_cst);
+  if (atomic_load_explicit(&signal->waiters, memory_order_relaxed) > 0) {
+    atomic_fetch_add_explicit(&signal->epoch, 1, memory_order_release);
+    os_futex_wake(&signal->epoch, UINT32_MAX);
+  }
+}
+
+// Announce we're about to sleep, then the caller has to check the queue once more before
+// signal_wait so nothing pushed in between gets missed
+translation_local u32 signal_prepare(Ring_Queue_Signal *signal) {
+  atomic_fetch_add_explicit(&signal->waiters, 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_seq_cst);
+  return atomic_load_explicit(&signal->epoch, memory_order_acquire);
+}
+
+translation_local void signal_wait(Ring_Queue_Signal *signal, u32 epoch) {
+  os_futex_wait(&signal->epoch, epoch);
+}
+
+translation_local void signal_done(Ring_Queue_Signal *signal) {
+  atomic_fetch_sub_explicit(&signal->waiters, 1, memory_order_relaxed);
+}
+
+// Copies count elements in or out starting at position, wrapping around the end of the ring
+translation_local void ring_copy_in(u8 *slots, u32 mask, isize element_size, u32 position,
+                                    const void *elements, u32 count) {
+  u32 start = position & mask;
+  u32 first = MIN(count, mask + 1 - start);
+
+  memcpy(slots + start * element_size, elements, first * element_size);
+  memcpy(slots, (const u8 *)elements + first * element_size, (count - first) * element_size);
+}
+
+translation_local void ring_copy_out(const u8 *slots, u32 mask, isize element_size, u32 position,
+                                     void *out, u32 count) {
+  u32 start = position & mask;
+  u32 first = MIN(count, mask + 1 - start);
+
+  memcpy(out, slots + start * element_size, first * element_size);
+  memcpy((u8 *)out + first * element_size, slots, (count - first) * element_size);
+}
+
+// SPSC ------------------------------------------------------------------------
+
+SPSC_Queue spsc_queue_make(u32 capacity, isize element_size, isize element_alignment) {
+  ASSERT(capacity > 0 && capacity <= (1u << 31), "Requested queue capacity is out of range");
+  capacity = round_up_pow2(capacity);
+
+  SPSC_Queue queue = {
+      .arena = arena_make(capacity * element_size + element_alignment, ARENA_FLAG_DEFAULTS),
+      .element_size = element_size,
+      .capacity = capacity,
+      .mask = capacity - 1,
+  };
+  queue.slots = arena_alloc_nozero(&queue.arena, capacity * element_size, element_alignment);
+
+  atomic_init(&queue.head, 0);
+  atomic_init(&queue.tail, 0);
+
+  return queue;
+}
+
+void spsc_queue_free(SPSC_Queue *queue) {
+  arena_free(&queue->arena);
+  ZERO_STRUCT(queue);
+}
+
+u32 spsc_queue_push(SPSC_Queue *queue, const void *elements, u32 count) {
+  u32 tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+
+  u32 free = queue->capacity - (tail - queue->cached_head);
+  if (free < count) {
+    queue->cached_head = atomic_load_explicit(&queue->head, memory_order_acquire);
+    free = queue->capacity - (tail - queue->cached_head);
+  }
+
+  count = MIN(count, free);
+  if (count == 0)
+    return 0;
+
+  ring_copy_in(queue->slots, queue->mask, queue->element_size, tail, elements, count);
+  atomic_store_explicit(&queue->tail, tail + count, memory_order_release);
+
+  signal_notify(&queue->not_empty);
+
+  return count;
+}
+
+u32 spsc_queue_pop(SPSC_Queue *queue, void *out, u32 max_count) {
+  u32 head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+
+  u32 available = queue->cached_tail - head;
+  if (available < max_count) {
+    queue->cached_tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+    available = queue->cached_tail - head;
+  }
+
+  u32 count = MIN(max_count, available);
+  if (count == 0)
+    return 0;
+
+  ring_copy_out(queue->slots, queue->mask, queue->element_size, head, out, count);
+  atomic_store_explicit(&queue->head, head + count, memory_order_release);
+
+  signal_notify(&queue->not_full);
+
+  return count;
+}
+
+void spsc_queue_push_wait(SPSC_Queue *queue, const void *elements, u32 count) {
+  const u8 *remaining = elements;
+  u32 spins = 0;
+
+  while (count > 0) {
+    u32 pushed = spsc_queue_push(queue, remaining, count);
+    remaining += pushed * queue->element_size;
+    count -= pushed;
+
+    if (count == 0)
+      break;
+
+    if (pushed > 0 || ++spins < RING_QUEUE_SPIN_COUNT) {
+      OS_CPU_RELAX();
+      continue;
+    }
+
+    u32 epoch = signal_prepare(&queue->not_full);
+    pushed = spsc_queue_push(queue, remaining, count);
+    if (pushed == 0) {
+      signal_wait(&queue->not_full, epoch);
+    }
+    signal_done(&queue->not_full);
+
+    remaining += pushed * queue->element_size;
+    count -= pushed;
+    spins = 0;
+  }
+}
+
+u32 spsc_queue_pop_wait(SPSC_Queue *queue, void *out, u32 max_count) {
+  for (u32 spins = 0;; spins++) {
+    u32 popped = spsc_queue_pop(queue, out, max_count);
+    if (popped > 0)
+      return popped;
+
+    if (spins < RING_QUEUE_SPIN_COUNT) {
+      OS_CPU_RELAX();
+      continue;
+    }
+
+    u32 epoch = signal_prepare(&queue->not_empty);
+    popped = spsc_queue_pop(queue, out, max_count);
+    if (popped == 0) {
+      signal_wait(&queue->not_empty, epoch);
+    }
+    signal_done(&queue->not_empty);
+
+    if (popped > 0)
+      return popped;
+  }
+}
+
+// MPSC ------------------------------------------------------------------------
+
+MPSC_Queue mpsc_queue_make(u32 capacity, isize element_size, isize element_alignment) {
+  ASSERT(capacity > 0 && capacity <= (1u << 31), "Requested queue capacity is out of range");
+  capacity = round_up_pow2(capacity);
+
+  isize total_size = capacity * element_size + element_alignment + capacity * sizeof(u32);
+
+  MPSC_Queue queue = {
+      .arena = arena_make(total_size, ARENA_FLAG_DEFAULTS),
+      .element_size = element_size,
+      .capacity = capacity,
+      .mask = capacity - 1,
+  };
+  queue.slots = arena_alloc_nozero(&queue.arena, capacity * element_size, element_alignment);
+  queue.sequences = (_Atomic u32 *)arena_calloc_nozero(&queue.arena, capacity, u32);
+
+  // Slot i is free for whoever claims position i
+  for (u32 i = 0; i < capacity; i++) {
+    atomic_init(&queue.sequences[i], i);
+  }
+  atomic_init(&queue.tail, 0);
+
+  return queue;
+}
+
+void mpsc_queue_free(MPSC_Queue *queue) {
+  arena_free(&queue->arena);
+  ZERO_STRUCT(queue);
+}
+
+bool mpsc_queue_push(MPSC_Queue *queue, const void *elements, u32 count) {
+  ASSERT(count <= queue->capacity, "Pushing more elements at once than the queue can ever hold");
+  if (count == 0)
+    return true;
+
+  u32 position = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+  for (;;) {
+    // The consumer frees slots in order, so if the last one we need is free so are the rest
+    u32 last = position + count - 1;
+    u32 sequence =
+        atomic_load_explicit(&queue->sequences[last & queue->mask], memory_order_acquire);
+    i32 diff = (i32)(sequence - last);
+
+    if (diff == 0) {
+      if (atomic_compare_exchange_weak_explicit(&queue->tail, &position, position + count,
+                                                memory_order_relaxed, memory_order_relaxed)) {
+        break;
+      }
+    } else if (diff < 0) {
+      // Still holds something from the last lap around
+      return false;
+    } else {
+      // Another producer got there first
+      position = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    }
+  }
+
+  const u8 *source = elements;
+  for (u32 i = 0; i < count; i++) {
+    u32 slot = (position + i) & queue->mask;
+    memcpy(queue->slots + slot * queue->element_size, source + i * queue->element_size,
+           queue->element_size);
+    atomic_store_explicit(&queue->sequences[slot], position + i + 1, memory_order_release);
+  }
+
+  signal_notify(&queue->not_empty);
+
+  return true;
+}
+
+u32 mpsc_queue_pop(MPSC_Queue *queue, void *out, u32 max_count) {
+  u32 position = queue->head;
+  u8 *dest = out;
+
+  u32 count = 0;
+  while (count < max_count) {
+    u32 slot = position & queue->mask;
+    u32 sequence = atomic_load_explicit(&queue->sequences[slot], memory_order_acquire);
+
+    // Not written yet, or the producer that claimed it hasn't finished
+    if (sequence != position + 1)
+      break;
+
+    memcpy(dest + count * queue->element_size, queue->slots + slot * queue->element_size,
+           queue->element_size);
+    atomic_store_explicit(&queue->sequences[slot], position + queue->capacity,
+                          memory_order_release);
+
+    position++;
+    count++;
+  }
+
+  queue->head = position;
+
+  if (count > 0) {
+    signal_notify(&queue->not_full);
+  }
+
+  return count;
+}
+
+void mpsc_queue_push_wait(MPSC_Queue *queue, const void *elements, u32 count) {
+  for (u32 spins = 0;; spins++) {
+    if (mpsc_queue_push(queue, elements, count))
+      return;
+
+    if (spins < RING_QUEUE_SPIN_COUNT) {
+      OS_CPU_RELAX();
+      continue;
+    }
+
+    u32 epoch = signal_prepare(&queue->not_full);
+    bool pushed = mpsc_queue_push(queue, elements, count);
+    if (!pushed) {
+      signal_wait(&queue->not_full, epoch);
+    }
+    signal_done(&queue->not_full);
+
+    if (pushed)
+      return;
+  }
+}
+
+u32 mpsc_queue_pop_wait(MPSC_Queue *queue, void *out, u32 max_count) {
+  for (u32 spins = 0;; spins++) {
+    u32 popped = mpsc_queue_pop(queue, out, max_count);
+    if (popped > 0)
+      return popped;
+
+    if (spins < RING_QUEUE_SPIN_COUNT) {
+      OS_CPU_RELAX();
+      continue;
+    }
+
+    u32 epoch = signal_prepare(&queue->not_empty);
+    popped = mpsc_queue_pop(queue, out, max_count);
+    if (popped == 0) {
+      signal_wait(&queue->not_empty, epoch);
+    }
+    signal_done(&queue->not_empty);
+
+    if (popped > 0)
+      return popped;
+  }
+}
@@ -0,0 +1,94 @@
+#ifndef RING_QUEUE_H
+#define RING_QUEUE_H
+
+#include "core/arena.h"
+#include "core/common.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+
+// Bounded lock-free queues of fixed size elements for handing work between threads. Elements are
+// copied in and out. Push and pop take batches and return how many actually went through, the
+// _wait versions sleep on a futex instead of spinning when the queue is empty (or full)
+//
+// SPSC: exactly one producer thread and one consumer thread
+// MPSC: any number of producer threads, exactly one consumer thread
+
+enum Ring_Queue_Constants {
+  RING_QUEUE_CACHE_LINE = 64,
+  RING_QUEUE_SPIN_COUNT = 128, // Tries before a _wait call goes to sleep
+};
+
+// Lets one side sleep until the other makes progress, only costs the notifier a syscall when
+// someone is actually asleep
+typedef struct Ring_Queue_Signal Ring_Queue_Signal;
+struct Ring_Queue_Signal {
+  _Atomic u32 epoch;
+  _Atomic u32 waiters;
+};
+
+typedef struct SPSC_Queue SPSC_Queue;
+struct SPSC_Queue {
+  Arena arena;
+  u8 *slots;
+  isize element_size;
+  u32 capacity; // Power of 2
+  u32 mask;
+
+  // Consumer side, the cached tail saves touching the producer's line until we think it's empty
+  alignas(RING_QUEUE_CACHE_LINE) _Atomic u32 head;
+  u32 cached_tail;
+
+  // Producer side, same deal
+  alignas(RING_QUEUE_CACHE_LINE) _Atomic u32 tail;
+  u32 cached_head;
+
+  alignas(RING_QUEUE_CACHE_LINE) Ring_Queue_Signal not_empty;
+  Ring_Queue_Signal not_full;
+};
+
+SPSC_Queue spsc_queue_make(u32 capacity, isize element_size, isize element_alignment);
+void spsc_queue_free(SPSC_Queue *queue);
+
+u32 spsc_queue_push(SPSC_Queue *queue, const void *elements, u32 count);
+u32 spsc_queue_pop(SPSC_Queue *queue, void *out, u32 max_count);
+
+// Blocks until every element is pushed
+void spsc_queue_push_wait(SPSC_Queue *queue, const void *elements, u32 count);
+// Blocks until at least one element is popped
+u32 spsc_queue_pop_wait(SPSC_Queue *queue, void *out, u32 max_count);
+
+// Vyukov style, each slot has a sequence number saying whose turn it is so producers only contend
+// on the tail for as long as a single CAS
+typedef struct MPSC_Queue MPSC_Queue;
+struct MPSC_Queue {
+  Arena arena;
+  u8 *slots;
+  _Atomic u32 *sequences;
+  isize element_size;
+  u32 capacity; // Power of 2
+  u32 mask;
+
+  // Only the consumer touches this, producers go by the sequences
+  alignas(RING_QUEUE_CACHE_LINE) u32 head;
+
+  alignas(RING_QUEUE_CACHE_LINE) _Atomic u32 tail;
+
+  alignas(RING_QUEUE_CACHE_LINE) Ring_Queue_Signal not_empty;
+  Ring_Queue_Signal not_full;
+};
+
+MPSC_Queue mpsc_queue_make(u32 capacity, isize element_size, isize element_alignment);
+void mpsc_queue_free(MPSC_Queue *queue);
+
+// A batch either goes in contiguously or not at all, so the consumer sees it in order
+bool mpsc_queue_push(MPSC_Queue *queue, const void *elements, u32 count);
+u32 mpsc_queue_pop(MPSC_Queue *queue, void *out, u32 max_count);
+
+void mpsc_queue_push_wait(MPSC_Queue *queue, const void *elements, u32 count);
+u32 mpsc_queue_pop_wait(MPSC_Queue *queue, void *out, u32 max_count);
+
+#define spsc_queue_make_type(c, T) spsc_queue_make(c, sizeof(T), alignof(T))
+#define mpsc_queue_make_type(c, T) mpsc_queue_make(c, sizeof(T), alignof(T))
+
+#endif // RING_QUEUE_H
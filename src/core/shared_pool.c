@@ -0,0 +1,205 @@
+#include "core/shared_pool.h"
+
+#include "core/log.h"
+#include "core/thread_context.h"
+
+// Handing out ids to pools, and which are in use
+translation_local _Atomic u32 shared_pool_ids_used;
+
+// Epoch of the pool currently holding each id, 0 if none
+translation_local _Atomic u32 shared_pool_next_epoch = 1;
+translation_local _Atomic u32 shared_pool_live_epochs[SHARED_POOL_MAX_NUM];
+
+#define FREE_HEAD_INDEX(head) ((u32)((head) & 0xFFFFFFFF))
+#define FREE_HEAD_TAG(head) ((u32)((head) >> 32))
+#define FREE_HEAD_MAKE(tag, index) (((u64)(tag) << 32) | (u64)(index))
+
+Shared_Pool shared_pool_make(isize count, isize block_size, isize block_alignment) {
+  ASSERT(count > 0 && count < UINT32_MAX, "Requested shared pool block count is out of range");
+
+  block_size = ALIGN_ROUND_UP(block_size, block_alignment);
+
+  // Room to push the blocks up to block_alignment, the arena only starts out max_align_t aligned
+  isize total_size =
+      block_alignment + ALIGN_ROUND_UP(count * block_size, alignof(u32)) + count * sizeof(u32);
+
+  Shared_Pool pool = {
+      .arena = arena_make(total_size, ARENA_FLAG_DEFAULTS),
+      .block_size = block_size,
+      .capacity = count,
+      .id = SHARED_POOL_MAX_NUM,
+  };
+
+  pool.blocks = arena_alloc_nozero(&pool.arena, count * block_size, block_alignment);
+  pool.next_free = (_Atomic u32 *)arena_calloc(&pool.arena, count, u32);
+  atomic_init(&pool.free_head, 0);
+  atomic_init(&pool.block_high, 0);
+
+  // Grab the lowest free id
+  u32 used = atomic_load(&shared_pool_ids_used);
+  u32 id = 0;
+  do {
+    for (id = 0; id < SHARED_POOL_MAX_NUM; id++) {
+      if (!(used & (1u << id)))
+        break;
+    }
+
+    if (id == SHARED_POOL_MAX_NUM) {
+      LOG_FATAL("Too many shared pools, max of %u", EXT_POOL_SIZE, SHARED_POOL_MAX_NUM);
+    }
+  } while (!atomic_compare_exchange_weak(&shared_pool_ids_used, &used, used | (1u << id)));
+
+  pool.id = id;
+  pool.epoch = atomic_fetch_add(&shared_pool_next_epoch, 1);
+  atomic_store(&shared_pool_live_epochs[id], pool.epoch);
+
+  return pool;
+}
+
+void shared_pool_free(Shared_Pool *pool) {
+  // Nothing to flush back into, the blocks are going away with the pool
+  Thread_Context *tctx = thread_get_context();
+  if (tctx != NULL && tctx->pool_magazines[pool->id].owner_epoch == pool->epoch) {
+    ZERO_STRUCT(&tctx->pool_magazines[pool->id]);
+  }
+
+  // Before the id goes back, so a new pool's epoch is the only one live under it
+  atomic_store(&shared_pool_live_epochs[pool->id], 0);
+  atomic_fetch_and(&shared_pool_ids_used, ~(1u << pool->id));
+  arena_free(&pool->arena);
+  ZERO_STRUCT(pool);
+}
+
+void shared_pool_set_tag(Shared_Pool *pool, const char *tag) { arena_set_tag(&pool->arena, tag); }
+
+// Pushes an already linked chain of blocks, first -> ... -> last, in one go
+translation_local void free_list_push_chain(Shared_Pool *pool, u32 first, u32 last) {
+  u64 head = atomic_load_explicit(&pool->free_head, memory_order_relaxed);
+  u64 new_head = 0;
+  do {
+    atomic_store_explicit(&pool->next_free[last], FREE_HEAD_INDEX(head), memory_order_relaxed);
+    new_head = FREE_HEAD_MAKE(FREE_HEAD_TAG(head) + 1, first + 1);
+  } while (!atomic_compare_exchange_weak_explicit(&pool->free_head, &head, new_head,
+                                                  memory_order_release, memory_order_relaxed));
+}
+
+translation_local u32 free_list_pop(Shared_Pool *pool) {
+  u64 head = atomic_load_explicit(&pool->free_head, memory_order_acquire);
+  u64 new_head = 0;
+  do {
+    u32 first = FREE_HEAD_INDEX(head);
+    if (first == 0)
+      return SHARED_POOL_INVALID_INDEX;
+
+    // May read a stale link if someone else got here first, but then the tag won't match
+    u32 next = atomic_load_explicit(&pool->next_free[first - 1], memory_order_relaxed);
+    new_head = FREE_HEAD_MAKE(FREE_HEAD_TAG(head) + 1, next);
+  } while (!atomic_compare_exchange_weak_explicit(&pool->free_head, &head, new_head,
+                                                  memory_order_acquire, memory_order_acquire));
+
+  return FREE_HEAD_INDEX(head) - 1;
+}
+
+translation_local Shared_Pool_Magazine *get_magazine(Shared_Pool *pool) {
+  Thread_Context *tctx = thread_get_context();
+  ASSERT(tctx != NULL, "Shared pools need a thread context on the calling thread");
+
+  Shared_Pool_Magazine *magazine = &tctx->pool_magazines[pool->id];
+
+  // Pool ids get recycled, so make sure this isn't a leftover from an old pool
+  if (magazine->owner_epoch != pool->epoch) {
+    magazine->owner = pool;
+    magazine->owner_id = pool->id;
+    magazine->owner_epoch = pool->epoch;
+    magazine->count = 0;
+  }
+
+  return magazine;
+}
+
+translation_local void refill_magazine(Shared_Pool *pool, Shared_Pool_Magazine *magazine) {
+  // Only half so that a pop right after doesn't immediately have to flush
+  while (magazine->count < SHARED_POOL_MAGAZINE_SIZE / 2) {
+    u32 index = free_list_pop(pool);
+    if (index == SHARED_POOL_INVALID_INDEX)
+      break;
+
+    magazine->indices[magazine->count++] = index;
+  }
+
+  // Nothing recycled, take fresh blocks
+  if (magazine->count == 0) {
+    u32 want = SHARED_POOL_MAGAZINE_SIZE / 2;
+    u32 start = atomic_fetch_add_explicit(&pool->block_high, want, memory_order_relaxed);
+    if (start < pool->capacity) {
+      u32 end = MIN(start + want, pool->capacity);
+      for (u32 i = end; i > start; i--) {
+        magazine->indices[magazine->count++] = i - 1;
+      }
+    } else {
+      atomic_fetch_sub_explicit(&pool->block_high, want, memory_order_relaxed);
+    }
+  }
+}
+
+void *shared_pool_alloc(Shared_Pool *pool) {
+  Shared_Pool_Magazine *magazine = get_magazine(pool);
+
+  if (magazine->count == 0) {
+    refill_magazine(pool, magazine);
+
+    if (magazine->count == 0) {
+      LOG_FATAL("Shared pool is full, capacity of %u blocks", EXT_POOL_SIZE, pool->capacity);
+    }
+  }
+
+  u32 index = magazine->indices[--magazine->count];
+
+  void *ptr = pool->blocks + index * pool->block_size;
+  ZERO_SIZE(ptr, pool->block_size);
+
+  return ptr;
+}
+
+// Link count indices together and push them all with one swap
+translation_local void flush_indices(Shared_Pool *pool, u32 *indices, u32 count) {
+  if (count == 0)
+    return;
+
+  for (u32 i = 0; i + 1 < count; i++) {
+    atomic_store_explicit(&pool->next_free[indices[i]], indices[i + 1] + 1, memory_order_relaxed);
+  }
+
+  free_list_push_chain(pool, indices[0], indices[count - 1]);
+}
+
+void shared_pool_pop(Shared_Pool *pool, void *ptr) {
+  ASSERT((u8 *)ptr >= pool->blocks && (u8 *)ptr < pool->blocks + pool->capacity * pool->block_size,
+         "Tried to pop shared pool element outside of pool");
+
+  u32 index = ((u8 *)ptr - pool->blocks) / pool->block_size;
+
+  Shared_Pool_Magazine *magazine = get_magazine(pool);
+
+  // Full, send the older half back to everyone else
+  if (magazine->count == SHARED_POOL_MAGAZINE_SIZE) {
+    u32 half = SHARED_POOL_MAGAZINE_SIZE / 2;
+    flush_indices(pool, magazine->indices, half);
+
+    memmove(magazine->indices, magazine->indices + half,
+            (magazine->count - half) * sizeof(magazine->indices[0]));
+    magazine->count -= half;
+  }
+
+  magazine->indices[magazine->count++] = index;
+}
+
+void shared_pool_flush_magazine(Shared_Pool_Magazine *magazine) {
+  // Owner may have been freed since, in which case there's nothing to give the blocks back to
+  if (magazine->owner != NULL &&
+      atomic_load(&shared_pool_live_epochs[magazine->owner_id]) == magazine->owner_epoch) {
+    flush_indices(magazine->owner, magazine->indices, magazine->count);
+  }
+
+  ZERO_STRUCT(magazine);
+}
@@ -0,0 +1,71 @@
+#ifndef SHARED_POOL_H
+#define SHARED_POOL_H
+
+#include "core/arena.h"
+#include "core/common.h"
+
+#include <stdatomic.h>
+
+// Fixed size block allocator that any thread can alloc from and pop to. Each thread keeps a small
+// magazine of free block indices per pool in its Thread_Context so the common case never touches
+// shared state, only refilling or flushing a magazine goes to the global lock-free free list
+
+enum Shared_Pool_Constants {
+  SHARED_POOL_MAGAZINE_SIZE = 64,
+  SHARED_POOL_MAX_NUM = 8, // How many shared pools can exist at once, one magazine each per thread
+  SHARED_POOL_INVALID_INDEX = UINT32_MAX,
+};
+
+typedef struct Shared_Pool Shared_Pool;
+
+// Lives in the Thread_Context
+typedef struct Shared_Pool_Magazine Shared_Pool_Magazine;
+struct Shared_Pool_Magazine {
+  // Pointer alone can't tell a freed pool from a new one made in the same place, the epoch can.
+  // owner is only ever followed while its epoch is still live
+  Shared_Pool *owner;
+  u32 owner_id;
+  u32 owner_epoch;
+  u32 count;
+  u32 indices[SHARED_POOL_MAGAZINE_SIZE];
+};
+
+struct Shared_Pool {
+  Arena arena;
+  u8 *blocks;
+  _Atomic u32 *next_free; // Per block link for the global free list
+
+  // Low 32 bits are index + 1 of the first free block (0 means empty), high 32 bits are a tag that
+  // gets bumped every swap so a pop can't succeed on a head that was popped and pushed back (ABA)
+  _Atomic u64 free_head;
+
+  // Blocks that have never been handed out, just bump this
+  _Atomic u32 block_high;
+
+  isize block_size;
+  u32 capacity;
+  u32 id;    // Which magazine in the thread context belongs to this pool
+  u32 epoch; // Unique for every pool ever made, never 0
+};
+
+Shared_Pool shared_pool_make(isize block_count, isize block_size, isize block_alignment);
+
+// NOTE(ss): No other thread may be using the pool (or exiting and flushing into it) while it gets
+// freed. The calling thread's magazine is dropped here, every other thread's magazine for it is
+// just stale after and gets dropped when it's next used or flushed, without touching the pool
+void shared_pool_free(Shared_Pool *pool);
+
+// Name that shows up in memory tracking dumps, same rules as arena_set_tag
+void shared_pool_set_tag(Shared_Pool *pool, const char *tag);
+
+// Memory returned is zeroed, both are safe to call from any thread with a Thread_Context
+void *shared_pool_alloc(Shared_Pool *pool);
+void shared_pool_pop(Shared_Pool *pool, void *ptr);
+
+// Give all of this thread's cached blocks back to the global free list, thread_context_free() does
+// this for you
+void shared_pool_flush_magazine(Shared_Pool_Magazine *magazine);
+
+#define shared_pool_make_type(c, T) shared_pool_make(c, sizeof(T), alignof(T))
+
+#endif // SHARED_POOL_H
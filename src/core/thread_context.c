@@ -1,23 +1,143 @@
 #include "core/thread_context.h"
 
+#include "core/log.h"
+
+#include "os/os.h"
+
+#include <stdatomic.h>
+#include <stdio.h>
+
 thread_local Thread_Context *internal_tctx;
 
-void thread_context_init(Thread_Context *tc) {
-  // Does this work?
-  function_local u32 thread_id = 0;
+translation_local _Atomic u32 thread_next_id;
+
+// Every live context, only touched on thread start/exit and when someone lists them
+typedef struct Thread_Registry Thread_Registry;
+struct Thread_Registry {
+  atomic_flag lock;
+  Thread_Context *contexts[THREAD_MAX_CONTEXTS];
+  u32 count;
+};
+
+translation_local Thread_Registry thread_registry = {.lock = ATOMIC_FLAG_INIT};
+
+translation_local void registry_lock(void) {
+  while (atomic_flag_test_and_set_explicit(&thread_registry.lock, memory_order_acquire)) {
+    OS_CPU_RELAX();
+  }
+}
+
+translation_local void registry_unlock(void) {
+  atomic_flag_clear_explicit(&thread_registry.lock, memory_order_release);
+}
+
+void thread_context_init(Thread_Context *tc, const char *name) {
+  tc->id = atomic_fetch_add_explicit(&thread_next_id, 1, memory_order_relaxed);
+  tc->os_id = os_thread_id();
+  tc->core = THREAD_CORE_ANY;
+  snprintf(tc->name, sizeof(tc->name), "%s", name);
+  os_thread_set_name(tc->name);
 
-  tc->id = thread_id++;
-  tc->scratch_arena = arena_make(GB(1), ARENA_FLAG_DEFAULTS);
+  for (u32 i = 0; i < SHARED_POOL_MAX_NUM; i++) {
+    ZERO_STRUCT(&tc->pool_magazines[i]);
+  }
+  for (u32 i = 0; i < THREAD_SCRATCH_ARENA_COUNT; i++) {
+    tc->scratch_arenas[i] = arena_make(GB(1), ARENA_FLAG_RESIZABLE | ARENA_FLAG_CHAINABLE);
+    snprintf(tc->scratch_tags[i], sizeof(tc->scratch_tags[i]), "scratch %u", i);
+    arena_set_tag(&tc->scratch_arenas[i], tc->scratch_tags[i]);
+  }
   internal_tctx = tc;
+
+  registry_lock();
+  if (thread_registry.count == THREAD_MAX_CONTEXTS) {
+    registry_unlock();
+    LOG_FATAL("Too many live threads, max of %u", EXT_THREAD_COUNT, THREAD_MAX_CONTEXTS);
+  }
+  thread_registry.contexts[thread_registry.count++] = tc;
+  registry_unlock();
 }
 
 void thread_context_free(void) {
+  registry_lock();
+  for (u32 i = 0; i < thread_registry.count; i++) {
+    if (thread_registry.contexts[i] == internal_tctx) {
+      thread_registry.contexts[i] = thread_registry.contexts[--thread_registry.count];
+      break;
+    }
+  }
+  registry_unlock();
+
   internal_tctx->id = UINT32_MAX; // Just in case we ever need to check if a thread is valid...
-  arena_free(&internal_tctx->scratch_arena);
+
+  // Don't strand any blocks this thread was holding on to
+  for (u32 i = 0; i < SHARED_POOL_MAX_NUM; i++) {
+    shared_pool_flush_magazine(&internal_tctx->pool_magazines[i]);
+  }
+
+  for (u32 i = 0; i < THREAD_SCRATCH_ARENA_COUNT; i++) {
+    arena_free(&internal_tctx->scratch_arenas[i]);
+  }
+
+  internal_tctx = NULL;
+}
+
+Thread_Context *thread_get_context(void) { return internal_tctx; }
+
+bool thread_set_affinity(u32 core) {
+  if (!os_thread_set_affinity(core)) {
+    LOG_WARN("Failed to pin thread %s to core %u", internal_tctx ? internal_tctx->name : "?", core);
+    return false;
+  }
+
+  if (internal_tctx != NULL) {
+    internal_tctx->core = core;
+  }
+
+  return true;
+}
+
+u32 thread_list_live(Thread_Info *out, u32 max_count) {
+  registry_lock();
+
+  u32 count = MIN(thread_registry.count, max_count);
+  for (u32 i = 0; i < count; i++) {
+    Thread_Context *tc = thread_registry.contexts[i];
+    out[i] = (Thread_Info){.id = tc->id, .os_id = tc->os_id, .core = tc->core};
+    memcpy(out[i].name, tc->name, sizeof(out[i].name));
+  }
+
+  registry_unlock();
+
+  return count;
 }
 
-Scratch thread_get_scratch(void) { return scratch_begin(&internal_tctx->scratch_arena); }
+Scratch thread_get_scratch(void) { return thread_get_scratch_avoiding(NULL, 0); }
+
+Scratch thread_get_scratch_avoiding(Arena **conflicts, u32 conflict_count) {
+  Arena *result = NULL;
+
+  for (u32 i = 0; i < THREAD_SCRATCH_ARENA_COUNT && result == NULL; i++) {
+    Arena *candidate = &internal_tctx->scratch_arenas[i];
+
+    bool conflicting = false;
+    for (u32 j = 0; j < conflict_count; j++) {
+      if (conflicts[j] == candidate) {
+        conflicting = true;
+        break;
+      }
+    }
+
+    if (!conflicting) {
+      result = candidate;
+    }
+  }
+
+  ASSERT(result != NULL, "All %u scratch arenas conflict, need more per thread",
+         THREAD_SCRATCH_ARENA_COUNT);
+
+  return scratch_begin(result);
+}
 
 void thread_end_scratch(Scratch *scratch) { scratch_end(scratch); }
 
-Arena *thread_get_arena(void) { return &internal_tctx->scratch_arena; }
+Arena *thread_get_arena(void) { return &internal_tctx->scratch_arenas[0]; }
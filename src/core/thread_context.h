@@ -3,21 +3,67 @@
 
 #include "core/arena.h"
 #include "core/common.h"
+#include "core/shared_pool.h"
 
-// TODO(ss): actually implement this
+#include <stdbool.h>
+
+enum Thread_Context_Constants {
+  // Two is enough as long as every function that takes an arena to put results in uses the
+  // avoiding version below... the caller's scratch is the only one that can conflict
+  THREAD_SCRATCH_ARENA_COUNT = 2,
+  THREAD_NAME_MAX = 32,
+  THREAD_SCRATCH_TAG_MAX = 16,
+  THREAD_MAX_CONTEXTS = 128, // Live at once
+  THREAD_CORE_ANY = UINT32_MAX,
+};
+
+// Every thread that touches scratch memory or shared pools needs one of these, job system workers
+// make their own
 typedef struct Thread_Context Thread_Context;
 struct Thread_Context {
-    u32 id;
-    Arena scratch_arena;
+    u32 id; // Unique for the life of the process, never reused
+    u64 os_id;
+    u32 core; // THREAD_CORE_ANY unless pinned
+    char name[THREAD_NAME_MAX];
+
+    Arena scratch_arenas[THREAD_SCRATCH_ARENA_COUNT];
+    char scratch_tags[THREAD_SCRATCH_ARENA_COUNT][THREAD_SCRATCH_TAG_MAX]; // Outlive the arenas
+
+    // This thread's cache of free blocks for each Shared_Pool, indexed by the pool's id
+    Shared_Pool_Magazine pool_magazines[SHARED_POOL_MAX_NUM];
 };
 
-void thread_context_init(Thread_Context *thread_context);
+// Registers the context as live, the name is copied (and truncated to THREAD_NAME_MAX)
+void thread_context_init(Thread_Context *thread_context, const char *name);
 void thread_context_free(void);
 
+// NULL if this thread never called thread_context_init()
+Thread_Context *thread_get_context(void);
+
+// Pin the calling thread to a single core, false if the OS refused
+bool thread_set_affinity(u32 core);
+
+// Copy of a live context's identity, safe to hold on to after that thread exits
+typedef struct Thread_Info Thread_Info;
+struct Thread_Info {
+  u32 id;
+  u64 os_id;
+  u32 core;
+  char name[THREAD_NAME_MAX];
+};
+
+// Fills out with up to max_count of the currently live threads, returns how many were written
+u32 thread_list_live(Thread_Info *out, u32 max_count);
+
 // NOTE(ss): A linear allocator for any dynamic scratch work you might want to do...
 // Use if a function does not need any allocations that stick around, and remember
 // to call end_scratch after
 Scratch thread_get_scratch(void);
+
+// If a function takes in an arena to put its results in and also wants scratch memory, pass that
+// arena in here so the scratch returned is never the same one, otherwise popping the scratch would
+// also pop the results if the caller handed us its own scratch arena
+Scratch thread_get_scratch_avoiding(Arena **conflicts, u32 conflict_count);
 void thread_end_scratch(Scratch *scratch);
 
 // Really shouldn't need this I don't think, but just in case
@@ -1,136 +1,240 @@
 #include "game/entity.h"
 
-Entity_Pool entity_pool_make(u64 capacity) {
-  ASSERT(capacity <= ENTITY_MAX_NUM, "Entity pool created with capcity greater than max");
+#include "core/log.h"
+
+Entity_Pool entity_pool_make(void) {
   Entity_Pool pool = {
-      .pool = pool_make_type(capacity, Entity),
-      .next_entity_id = 1,
+      .world = ecs_world_make(),
+  };
+
+  pool.components = (Entity_Components){
+      .transform = ecs_component_register_type(&pool.world, Transform),
+      .matrices = ecs_component_register_type(&pool.world, Transform_Matrices),
+      .parent = ecs_component_register_type(&pool.world, Entity_Parent),
+      .children = ecs_component_register_type(&pool.world, Entity_Children),
+      .mesh = ecs_component_register_type(&pool.world, ASS_Handle),
   };
 
+  // Registered back to back so a depth is just shifted up into the mask
+  pool.components.depth = pool.world.component_count;
+  for (u32 bit = 0; bit < ENTITY_DEPTH_BITS; bit++) {
+    ecs_component_register(&pool.world, 0, 1, "Entity_Depth");
+  }
+
   return pool;
 }
 
 void entity_pool_free(Entity_Pool *pool) {
-  pool_free(&pool->pool);
+  ecs_world_free(&pool->world);
   ZERO_STRUCT(pool);
 }
 
-Entity *entity_make(Entity_Pool *ep, RND_Context *rc, ASS_Manager *am, Entity_Flags flags,
-                    vec3 position, vec3 rotation, vec3 scale, char *mesh_file) {
+Entity_Handle entity_make(Entity_Pool *ep, RND_Context *rc, ASS_Manager *am, vec3 position,
+                          quat rotation, vec3 scale, char *mesh_file) {
+  Entity_Components *c = &ep->components;
+  Entity_Handle entity =
+      ecs_spawn(&ep->world, ECS_BIT(c->transform) | ECS_BIT(c->matrices) | ECS_BIT(c->mesh));
 
-  Entity *entity = pool_alloc(&ep->pool);
+  *ecs_get_type(&ep->world, entity, c->transform, Transform) =
+      transform_make(position, rotation, scale);
+  *ecs_get_type(&ep->world, entity, c->mesh, ASS_Handle) = ass_load_mesh_obj(am, rc, mesh_file);
 
-  *entity = (Entity){
-      .id = ep->next_entity_id,
-      .flags = flags,
-      .position = position,
-      .rotation = rotation,
-      .scale = scale,
-      .mesh_asset = ass_load_mesh_obj(am, rc, mesh_file),
-  };
+  return entity;
+}
 
-  // and increment the id
-  ep->next_entity_id++;
+// Hierarchy -------------------------------------------------------------------
 
-  return entity;
+translation_local Entity_Parent *entity_parent(Entity_Pool *ep, Entity_Handle entity) {
+  return ecs_get_type(&ep->world, entity, ep->components.parent, Entity_Parent);
+}
+
+translation_local Entity_Handle entity_first_child(Entity_Pool *ep, Entity_Handle entity) {
+  Entity_Children *children =
+      ecs_get_type(&ep->world, entity, ep->components.children, Entity_Children);
+  return children != NULL ? children->first : POOL_HANDLE_NIL;
+}
+
+// Straight out of the archetype, roots have none of the depth tags
+translation_local u32 entity_depth(Entity_Pool *ep, Entity_Handle entity) {
+  return (u32)(ecs_mask_of(&ep->world, entity) >> ep->components.depth) & (ENTITY_MAX_DEPTH - 1);
+}
+
+// Levels below the entity, 0 if it has no children
+translation_local u32 entity_subtree_height(Entity_Pool *ep, Entity_Handle entity) {
+  u32 height = 0;
+  for (Entity_Handle child = entity_first_child(ep, entity); ecs_alive(&ep->world, child);
+       child = entity_parent(ep, child)->next_sibling) {
+    u32 below = entity_subtree_height(ep, child) + 1;
+    height = MAX(height, below);
+  }
+
+  return height;
 }
 
-Entity *entity_get(Entity_Pool *ep, Entity_ID id) {
-  Entity *entities = pool_as_array_type(&ep->pool, NULL, Entity);
-  return &entities[id + ENTITY_ID_OFFSET];
+// Moves the entity over to the archetypes for its new depth, and its children to the one below.
+// A child's depth is always its parent's plus one, so if this one didn't change nothing below did
+translation_local void entity_set_depth(Entity_Pool *ep, Entity_Handle entity, u32 depth) {
+  ECS_Mask parent = ECS_BIT(ep->components.parent);
+  ECS_Mask mask = ecs_mask_of(&ep->world, entity);
+  ECS_Mask moved = (mask & ~(entity_depth_mask(ep, ENTITY_MAX_DEPTH - 1) | parent)) |
+                   entity_depth_mask(ep, depth) | (depth > 0 ? parent : 0);
+  if (moved == mask)
+    return;
+
+  ecs_set_mask(&ep->world, entity, moved);
+  for (Entity_Handle child = entity_first_child(ep, entity); ecs_alive(&ep->world, child);
+       child = entity_parent(ep, child)->next_sibling) {
+    entity_set_depth(ep, child, depth + 1);
+  }
 }
 
-mat4 entity_model_mat4(const Entity *entity) {
-  // mat4 transform = mat4_mul(mat4_translation(entity->position),
-  //                           mat4_mul(mat4_rotation_y(entity->rotation.y),
-  //                                    mat4_mul(mat4_rotation_x(entity->rotation.x),
-  //                                             mat4_mul(mat4_rotation_z(entity->rotation.z),
-  //                                                      mat4_scale(entity->scale)))));
-
-  // Taken algebra from Brendan Galea, couldn't be bothered, tait bryan angles, Y, X, Z
-  f32 sinx = sinf(entity->rotation.x);
-  f32 cosx = cosf(entity->rotation.x);
-  f32 siny = sinf(entity->rotation.y);
-  f32 cosy = cosf(entity->rotation.y);
-  f32 sinz = sinf(entity->rotation.z);
-  f32 cosz = cosf(entity->rotation.z);
-
-  // We can algebraically simplify the above like so, throwing it into godbolt,
-  // it turned ~500 ASM instructions into ~100, simulating just his transform for 10,000
-  // entities this is faster on my computer by about 20 fps
-  mat4 transform = {.cols = {
-                        {
-                            .x = entity->scale.x * (cosy * cosz + siny * sinx * sinz),
-                            .y = entity->scale.x * (cosx * sinz),
-                            .z = entity->scale.x * (cosy * sinx * sinz - cosz * siny),
-                            .w = 0.0f,
-                        },
-                        {
-                            .x = entity->scale.y * (cosz * siny * sinx - cosy * sinz),
-                            .y = entity->scale.y * (cosx * cosz),
-                            .z = entity->scale.y * (cosy * cosz * sinx + siny * sinz),
-                            .w = 0.0f,
-                        },
-                        {
-                            .x = entity->scale.z * (cosx * siny),
-                            .y = entity->scale.z * (-sinx),
-                            .z = entity->scale.z * (cosy * cosx),
-                            .w = 0.0f,
-                        },
-                        {
-                            .xyz = entity->position,
-                            .w = 1.0f,
-                        },
-                    }};
-  return transform;
+// Takes the entity out of its parent's children, the Entity_Parent itself stays
+translation_local void entity_unlink(Entity_Pool *ep, Entity_Handle entity) {
+  Entity_Parent *link = entity_parent(ep, entity);
+  if (link == NULL)
+    return;
+
+  Entity_Parent old = *link;
+  link->prev_sibling = link->next_sibling = POOL_HANDLE_NIL;
+
+  if (ecs_alive(&ep->world, old.next_sibling)) {
+    entity_parent(ep, old.next_sibling)->prev_sibling = old.prev_sibling;
+  }
+
+  if (ecs_alive(&ep->world, old.prev_sibling)) {
+    entity_parent(ep, old.prev_sibling)->next_sibling = old.next_sibling;
+  } else if (ecs_alive(&ep->world, old.next_sibling)) {
+    ecs_get_type(&ep->world, old.entity, ep->components.children, Entity_Children)->first =
+        old.next_sibling;
+  } else {
+    // Last one out, the parent goes back to the archetypes without children
+    ecs_remove(&ep->world, old.entity, ep->components.children);
+  }
 }
 
-mat4 entity_normal_mat4(const Entity *entity) {
-  // Taken algebra from Brendan Galea, couldn't be bothered, tait bryan angles, Y, X, Z
-  f32 sinx = sinf(entity->rotation.x);
-  f32 cosx = cosf(entity->rotation.x);
-  f32 siny = sinf(entity->rotation.y);
-  f32 cosy = cosf(entity->rotation.y);
-  f32 sinz = sinf(entity->rotation.z);
-  f32 cosz = cosf(entity->rotation.z);
-
-  vec3 inv_scale = vec3_inv(entity->scale);
-
-  // Optimization... we don't need the translation, and the inverse transopse of a rotation is that
-  // same rotation since inverse of rotation mat is it's transopse, the transpose of a scale matrix
-  // is itself, and the inverse is easy, like the above
-  mat4 normal = {.cols = {
-                     {
-                         .x = inv_scale.x * (cosy * cosz + siny * sinx * sinz),
-                         .y = inv_scale.x * (cosx * sinz),
-                         .z = inv_scale.x * (cosy * sinx * sinz - cosz * siny),
-                         .w = 0.0f,
-                     },
-                     {
-                         .x = inv_scale.y * (cosz * siny * sinx - cosy * sinz),
-                         .y = inv_scale.y * (cosx * cosz),
-                         .z = inv_scale.y * (cosy * cosz * sinx + siny * sinz),
-                         .w = 0.0f,
-                     },
-                     {
-                         .x = inv_scale.z * (cosx * siny),
-                         .y = inv_scale.z * (-sinx),
-                         .z = inv_scale.z * (cosy * cosx),
-                         .w = 0.0f,
-                     },
-                     {
-                         .elements = {0.0f},
-                     },
-                 }};
-  return normal;
+// Pushes the entity on the front of the parent's children, it already has its Entity_Parent
+translation_local void entity_link(Entity_Pool *ep, Entity_Handle entity, Entity_Handle parent) {
+  Entity_Children *children =
+      ecs_add_type(&ep->world, parent, ep->components.children, Entity_Children);
+  Entity_Handle next = children->first;
+  children->first = entity;
+
+  if (ecs_alive(&ep->world, next)) {
+    entity_parent(ep, next)->prev_sibling = entity;
+  }
+  *entity_parent(ep, entity) = (Entity_Parent){
+      .entity = parent,
+      .next_sibling = next,
+  };
 }
 
-void entity_free(Entity_Pool *entity_pool, RND_Context *render_context, ASS_Manager *asset_manager,
-                 Entity *entity) {
-  LOG_DEBUG("Entity %u has been called to free", entity->id);
-  ass_free_entry(asset_manager, render_context, entity->mesh_asset);
+void entity_free(Entity_Pool *ep, RND_Context *rc, ASS_Manager *am, Entity_Handle entity) {
+  LOG_DEBUG("Entity %u has been called to free", entity.index);
+
+  ASS_Handle *mesh = ecs_get_type(&ep->world, entity, ep->components.mesh, ASS_Handle);
+  if (mesh != NULL) {
+    ass_free_entry(am, rc, *mesh);
+  }
+
+  // Children become roots, and their world just changed under them. Their own children come up a
+  // level with them
+  Entity_Handle child = entity_first_child(ep, entity);
+  while (ecs_alive(&ep->world, child)) {
+    Entity_Handle next = entity_parent(ep, child)->next_sibling;
+    entity_transform(ep, child)->flags |= TRANSFORM_FLAG_DIRTY;
+    entity_set_depth(ep, child, 0);
+    child = next;
+  }
+
+  entity_unlink(ep, entity);
+  ecs_despawn(&ep->world, entity);
+}
 
-  pool_pop(&entity_pool->pool, entity);
+Transform *entity_transform(Entity_Pool *ep, Entity_Handle entity) {
+  return ecs_get_type(&ep->world, entity, ep->components.transform, Transform);
+}
+
+bool entity_set_parent(Entity_Pool *ep, Entity_Handle entity, Entity_Handle parent) {
+  Transform *transform = entity_transform(ep, entity);
+  if (transform == NULL) {
+    LOG_ERROR("Can't parent dead entity %u", entity.index);
+    return false;
+  }
+
+  // Walk up from the new parent, if we run into ourselves this would make a cycle
+  Entity_Handle ancestor = parent;
+  while (ecs_alive(&ep->world, ancestor)) {
+    if (ancestor.index == entity.index && ancestor.generation == entity.generation) {
+      LOG_ERROR("Can't parent entity %u under its own descendant", entity.index);
+      return false;
+    }
+
+    Entity_Parent *link = entity_parent(ep, ancestor);
+    ancestor = link != NULL ? link->entity : POOL_HANDLE_NIL;
+  }
+
+  bool has_parent = ecs_alive(&ep->world, parent);
+  u32 depth = has_parent ? entity_depth(ep, parent) + 1 : 0;
+  if (depth + entity_subtree_height(ep, entity) >= ENTITY_MAX_DEPTH) {
+    LOG_ERROR("Can't parent entity %u, hierarchy would be deeper than %u levels", entity.index,
+              ENTITY_MAX_DEPTH);
+    return false;
+  }
+
+  // Moves below invalidate the transform pointer, get this in first
+  transform->flags |= TRANSFORM_FLAG_DIRTY;
+
+  entity_unlink(ep, entity);
+  entity_set_depth(ep, entity, depth);
+  if (has_parent) {
+    entity_link(ep, entity, parent);
+  }
+
+  return true;
+}
+
+u32 entity_pool_level_count(Entity_Pool *ep) {
+  u32 level_count = 1;
+  for (u32 i = 0; i < ep->world.archetype_count; i++) {
+    ECS_Archetype *archetype = &ep->world.archetypes[i];
+    if (archetype->entity_count > 0) {
+      u32 depth = (u32)(archetype->mask >> ep->components.depth) & (ENTITY_MAX_DEPTH - 1);
+      level_count = MAX(level_count, depth + 1);
+    }
+  }
+
+  return level_count;
+}
 
-  entity->flags = ENTITY_FLAG_INVALID; // This feels icky to do this
+u32 entity_update_transforms(Entity_Pool *ep, ECS_Chunk *chunk) {
+  Transform *transforms = ecs_chunk_column_type(chunk, ep->components.transform, Transform);
+  Transform_Matrices *matrices =
+      ecs_chunk_column_type(chunk, ep->components.matrices, Transform_Matrices);
+
+  // Worlds first, then the normals of whatever moved in one batch. Every entity here has a
+  // Transform_Matrices, so a chunk can't hold more than this
+  u32 moved_rows[ECS_CHUNK_SIZE / sizeof(Transform_Matrices)];
+  u32 moved = 0;
+  if (!ecs_chunk_has(chunk, ep->components.parent)) {
+    for (u32 i = 0; i < chunk->count; i++) {
+      if (transform_update_world(&transforms[i], &matrices[i], NULL, NULL)) {
+        moved_rows[moved++] = i;
+      }
+    }
+  } else {
+    // NOTE(ss): Parents are looked up through the world every time rather than cached, anything
+    // spawned or freed anywhere can move them. They're a level up so nothing's writing to them
+    Entity_Parent *parents = ecs_chunk_column_type(chunk, ep->components.parent, Entity_Parent);
+    for (u32 i = 0; i < chunk->count; i++) {
+      Entity_Handle parent = parents[i].entity;
+      if (transform_update_world(
+              &transforms[i], &matrices[i], entity_transform(ep, parent),
+              ecs_get_type(&ep->world, parent, ep->components.matrices, Transform_Matrices))) {
+        moved_rows[moved++] = i;
+      }
+    }
+  }
+
+  transform_normal_batch(matrices, moved_rows, moved);
+  return moved;
 }
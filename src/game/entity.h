@@ -3,89 +3,102 @@
 
 #include "asset/asset_manager.h"
 #include "core/common.h"
+#include "core/ecs.h"
 #include "core/linear_algebra.h"
-#include "core/pool.h"
+
+#include "game/transform.h"
 
 #include "render/render_mesh.h"
 
-typedef u64 Entity_ID;
+// Stays valid until the entity is freed, after that it doesn't resolve to anything
+typedef ECS_Entity Entity_Handle;
 
 enum Entity_Constants {
-  ENTITY_MAX_NUM = 1000,
-  ENTITY_ID_OFFSET = -1,
-};
+  ENTITY_JOB_GRAIN_CHUNKS = 1, // Chunks per parallel for range, a chunk is already ~60 entities
+  ENTITY_DEPTH_BITS = 5,       // Depth tags, a child's depth in binary
 
-typedef struct Entity_Pool Entity_Pool;
-struct Entity_Pool {
-  Pool pool;
-  Entity_ID next_entity_id;
+  ENTITY_MAX_DEPTH = 1 << ENTITY_DEPTH_BITS, // Levels of parenting, roots are depth 0
 };
 
-// In future we might want 64 bits for flags
-typedef enum Entity_Flags {
-  ENTITY_FLAG_INVALID = -1,
-  ENTITY_FLAG_DEFAULT = 0,
-} Entity_Flags;
-
-typedef struct Entity Entity;
-struct Entity {
-  Entity_ID id; // As stated below this acts as padding as well for when a pointer is held here
-                // instead, hope that 128 bit doesn't come any time soon
+// Components ------------------------------------------------------------------
 
-  // HACK(ss): Storing this down here because pool allocator just stores the free list directly in
-  // the buffer meaning that this needs to not be overwritten by the node pointer, this might be
-  // terrible(genius) design, but it works
-  Entity_Flags flags;
+// Only children have one, so roots and children are different archetypes and the roots (most
+// things) get updated without ever looking at a parent. Children also carry their depth as tags,
+// so each level is its own archetypes and updating a level never goes near the others
+typedef struct Entity_Parent Entity_Parent;
+struct Entity_Parent {
+  Entity_Handle entity;
 
-  // Transforms
-  vec3 scale;
-  vec3 position;
-  vec3 rotation;
-
-  ASS_Entry *mesh_asset;
+  // The parent's other children, first one is in its Entity_Children
+  Entity_Handle prev_sibling;
+  Entity_Handle next_sibling;
 };
 
-#if 0
-typedef enum Entity_Slot_Type {
-  ENTITY_SLOT_FREED = 0,
-  ENTITY_SLOT_OCCUPIED = 1,
-} Entity_Slot_Type;
-
-typedef struct Entity_Free Entity_Free;
-struct Entity_Free {
-  Entity_Free *next;
+// Only on entities with children, so reparenting or freeing only has to walk what hangs below
+typedef struct Entity_Children Entity_Children;
+struct Entity_Children {
+  Entity_Handle first;
 };
 
-// Easy little union to determine if this spot is occupied or not
-typedef struct Entity_Slot Entity_Slot;
-struct Entity_Slot {
-  Entity_Slot_Type type;
-  union {
-    Entity_Free *free;
-    Entity entity;
-  };
+typedef struct Entity_Components Entity_Components;
+struct Entity_Components {
+  ECS_Component transform;
+  ECS_Component matrices;
+  ECS_Component parent;
+  ECS_Component children;
+  ECS_Component depth; // First of ENTITY_DEPTH_BITS tags in a row, bit 0 first
+  ECS_Component mesh;  // ASS_Handle, resolved a chunk at a time when drawing
 };
 
+// All the game's entities, as components in an ECS_World. Systems query for just the components
+// they read and write, see main.c, and the hierarchy is kept in depth levels so world transforms
+// can go out one level at a time, each level in parallel
 typedef struct Entity_Pool Entity_Pool;
 struct Entity_Pool {
-  Pool pool;
-  Entity_ID next_entity_id;
-	Entity_Free *free;
+  ECS_World world;
+  Entity_Components components;
 };
-#endif
 
-Entity_Pool entity_pool_make(u64 capacity);
+Entity_Pool entity_pool_make(void);
 void entity_pool_free(Entity_Pool *pool);
 
-Entity *entity_make(Entity_Pool *ep, RND_Context *rc, ASS_Manager *am, Entity_Flags flags,
-                    vec3 position, vec3 rotation, vec3 scale, char *mesh_file);
-void entity_free(Entity_Pool *entity_pool, RND_Context *render_context, ASS_Manager *asset_manager,
-                 Entity *entity);
-
-Entity *entity_get(Entity_Pool *ep, Entity_ID id);
-
-mat4 entity_model_mat4(const Entity *entity);
-// Inverse transpose of the model transform
-mat4 entity_normal_mat4(const Entity *entity);
+// Every entity gets a transform and a mesh
+Entity_Handle entity_make(Entity_Pool *ep, RND_Context *rc, ASS_Manager *am, vec3 position,
+                          quat rotation, vec3 scale, char *mesh_file);
+// Not ecs_despawn() straight on the world, the entity's parent and children need unhooking
+void entity_free(Entity_Pool *ep, RND_Context *rc, ASS_Manager *am, Entity_Handle entity);
+
+// NOTE(ss): Only good until the next entity_make(), entity_free() or entity_set_parent(), since
+// those can move entities between chunks
+Transform *entity_transform(Entity_Pool *ep, Entity_Handle entity);
+
+// Nil parent makes it a root again. Refuses (and returns false) if the parent is the entity itself
+// or one of its children, or if it would take the hierarchy past ENTITY_MAX_DEPTH. Freeing a
+// parent turns its children into roots, their transforms are then relative to the world instead.
+// Only the entity and what hangs below it change depth
+bool entity_set_parent(Entity_Pool *ep, Entity_Handle entity, Entity_Handle parent);
+
+// Deepest level with anything in it plus one, at least 1. Goes over the archetypes not the entities
+u32 entity_pool_level_count(Entity_Pool *ep);
+
+static inline ECS_Mask entity_depth_mask(Entity_Pool *ep, u32 depth) {
+  return (ECS_Mask)depth << ep->components.depth;
+}
+
+// Roots are depth 0 and have no parent, children match their depth tags exactly, so these are what
+// to run each level over
+static inline ECS_Query entity_query_level(Entity_Pool *ep, u32 depth) {
+  ECS_Mask transforms = ECS_BIT(ep->components.transform) | ECS_BIT(ep->components.matrices);
+  ECS_Mask parent = ECS_BIT(ep->components.parent);
+  ECS_Mask depth_tags = entity_depth_mask(ep, ENTITY_MAX_DEPTH - 1);
+
+  return depth == 0 ? (ECS_Query){.all = transforms, .none = parent}
+                    : (ECS_Query){.all = transforms | parent | entity_depth_mask(ep, depth),
+                                  .none = depth_tags & ~entity_depth_mask(ep, depth)};
+}
+
+// Updates the transforms in a chunk from entity_query_level(), returns how many worlds changed.
+// Every level above has to have been updated already
+u32 entity_update_transforms(Entity_Pool *ep, ECS_Chunk *chunk);
 
 #endif // ENTITY_H
@@ -12,10 +12,16 @@ void game_init(Game *game, u32 argc, char **argv) {
   rnd_context_init(&game->render_context, &game->window);
 
   // Create our persistent arena (Long term state, probably for the whole lifetime of the game)
-  game->persistent_arena = arena_make(1024 * 256, ARENA_FLAG_DEFAULTS);
-  game->frame_arena = arena_make(1024 * 256, ARENA_FLAG_DEFAULTS);
+  // These start small and chain on more blocks as the scene grows
+  game->persistent_arena = arena_make(KB(64), ARENA_FLAG_CHAINABLE);
+  arena_set_tag(&game->persistent_arena, "persistent_arena");
 
-  game->entity_pool = entity_pool_make(ENTITY_MAX_NUM);
+  for (u32 i = 0; i < RND_CONTEXT_MAX_FRAMES_IN_FLIGHT; i++) {
+    game->frame_arenas[i] = arena_make(KB(64), ARENA_FLAG_CHAINABLE);
+    arena_set_tag(&game->frame_arenas[i], "frame_arena");
+  }
+
+  game->entity_pool = entity_pool_make();
 
   // Initialize the game's asset manager
   ass_manager_init(&game->persistent_arena, &game->asset_manager);
@@ -35,9 +41,24 @@ void game_init(Game *game, u32 argc, char **argv) {
 void game_free(Game *game) {
   ass_manager_free(&game->asset_manager, &game->render_context);
   entity_pool_free(&game->entity_pool);
-  arena_free(&game->frame_arena);
+  for (u32 i = 0; i < RND_CONTEXT_MAX_FRAMES_IN_FLIGHT; i++) {
+    arena_free(&game->frame_arenas[i]);
+  }
   arena_free(&game->persistent_arena);
   rnd_context_free(&game->render_context);
   window_free(&game->window);
   ZERO_STRUCT(game);
 }
+
+Arena *game_begin_frame_arena(Game *game) {
+  rnd_wait_frame(&game->render_context);
+
+  Arena *arena = game_frame_arena(game);
+  arena_clear(arena);
+
+  return arena;
+}
+
+Arena *game_frame_arena(Game *game) {
+  return &game->frame_arenas[rnd_get_current_frame_idx(&game->render_context)];
+}
@@ -13,6 +13,7 @@
 
 enum Game_Constants {
   GAME_DEFAULT_MAX_TICK = 240,
+  GAME_DEMO_ENTITY_COUNT = 1000, // Testing purposes
 };
 
 typedef struct Game Game;
@@ -22,7 +23,10 @@ struct Game {
   ASS_Manager asset_manager;
 
   Arena persistent_arena;
-  Arena frame_arena;
+  // One per frame in flight, indexed by the render context's current frame. Only reset once that
+  // frame's fence has signaled, so anything allocated here may be read by the GPU (or anything else
+  // running behind the game loop) until the same frame slot comes back around
+  Arena frame_arenas[RND_CONTEXT_MAX_FRAMES_IN_FLIGHT];
 
   Entity_Pool entity_pool;
 
@@ -37,4 +41,10 @@ struct Game {
 void game_init(Game *game, u32 argc, char **argv);
 void game_free(Game *game);
 
+// Call once at the top of the frame, waits for the current frame in flight to be done on the GPU
+// and then resets its arena
+Arena *game_begin_frame_arena(Game *game);
+// The current frame's arena, valid between game_begin_frame_arena and rnd_end_frame
+Arena *game_frame_arena(Game *game);
+
 #endif // GAME_H
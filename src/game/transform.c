@@ -0,0 +1,170 @@
+#include "game/transform.h"
+
+Transform transform_make(vec3 position, quat rotation, vec3 scale) {
+  Transform transform = {
+      .position = position,
+      .rotation = rotation,
+      .scale = scale,
+      .flags = TRANSFORM_FLAG_DIRTY,
+  };
+
+  return transform;
+}
+
+void transform_set_position(Transform *transform, vec3 position) {
+  transform->position = position;
+  transform->flags |= TRANSFORM_FLAG_DIRTY;
+}
+
+void transform_set_rotation(Transform *transform, quat rotation) {
+  transform->rotation = rotation;
+  transform->flags |= TRANSFORM_FLAG_DIRTY;
+}
+
+void transform_set_scale(Transform *transform, vec3 scale) {
+  transform->scale = scale;
+  transform->flags |= TRANSFORM_FLAG_DIRTY;
+}
+
+void transform_rotate(Transform *transform, quat delta) {
+  // Renormalize as we go, otherwise spinning something every frame drifts off unit length
+  transform->rotation = quat_norm(quat_mul(delta, transform->rotation));
+  transform->flags |= TRANSFORM_FLAG_DIRTY;
+}
+
+bool transform_update_world(Transform *transform, Transform_Matrices *matrices,
+                            const Transform *parent, const Transform_Matrices *parent_matrices) {
+  bool local_changed = transform->flags & TRANSFORM_FLAG_DIRTY;
+  bool parent_moved = parent != NULL && (parent->flags & TRANSFORM_FLAG_MOVED);
+
+  transform->flags &= ~(TRANSFORM_FLAG_DIRTY | TRANSFORM_FLAG_MOVED);
+  if (!local_changed && !parent_moved)
+    return false;
+
+  if (local_changed) {
+    mat3 rotation = quat_to_mat3(transform->rotation);
+    mat4 local = {0};
+    for (u32 col = 0; col < 3; col++) {
+      local.cols[col].xyz = vec3_mul(rotation.cols[col], transform->scale.elements[col]);
+    }
+    local.cols[3] = vec3_to_vec4(transform->position);
+
+    matrices->local = local;
+  }
+
+  if (parent != NULL) {
+    matrices->world = mat4_mul(parent_matrices->world, matrices->local);
+  } else {
+    matrices->world = matrices->local;
+  }
+  transform->flags |= TRANSFORM_FLAG_MOVED;
+
+  return true;
+}
+
+bool transform_update(Transform *transform, Transform_Matrices *matrices, const Transform *parent,
+                      const Transform_Matrices *parent_matrices) {
+  if (!transform_update_world(transform, matrices, parent, parent_matrices))
+    return false;
+
+  // Straight off the world matrix, good for whatever ends up in there, shear from a non uniformly
+  // scaled parent included. Already padded the way the shader wants it
+  matrices->normal = mat3_to_mat3x4(mat4_normal_mat3(matrices->world));
+  return true;
+}
+
+void transform_normal_batch(Transform_Matrices *matrices, const u32 *rows, u32 count) {
+  enum { LANES = TRANSFORM_BATCH_LANES };
+
+  for (u32 base = 0; base < count; base += LANES) {
+    u32 live = MIN(LANES, count - base);
+
+    // Short batches repeat the last row, the extra lanes are thrown away
+    f32 a[3][LANES], b[3][LANES], c[3][LANES];
+    for (u32 l = 0; l < LANES; l++) {
+      const mat4 *world = &matrices[rows[base + MIN(l, live - 1)]].world;
+      for (u32 row = 0; row < 3; row++) {
+        a[row][l] = world->cols[0].elements[row];
+        b[row][l] = world->cols[1].elements[row];
+        c[row][l] = world->cols[2].elements[row];
+      }
+    }
+
+    // Same cross products and order as mat4_inverse_rows3(), the rows of the inverse are the
+    // columns of the inverse transpose
+    f32 normal[3][3][LANES];
+    for (u32 l = 0; l < LANES; l++) {
+      f32 bc[3] = {
+          b[1][l] * c[2][l] - b[2][l] * c[1][l],
+          b[2][l] * c[0][l] - b[0][l] * c[2][l],
+          b[0][l] * c[1][l] - b[1][l] * c[0][l],
+      };
+      f32 inv_det = 1.0f / (a[0][l] * bc[0] + a[1][l] * bc[1] + a[2][l] * bc[2]);
+
+      normal[0][0][l] = bc[0] * inv_det;
+      normal[0][1][l] = bc[1] * inv_det;
+      normal[0][2][l] = bc[2] * inv_det;
+      normal[1][0][l] = (c[1][l] * a[2][l] - c[2][l] * a[1][l]) * inv_det;
+      normal[1][1][l] = (c[2][l] * a[0][l] - c[0][l] * a[2][l]) * inv_det;
+      normal[1][2][l] = (c[0][l] * a[1][l] - c[1][l] * a[0][l]) * inv_det;
+      normal[2][0][l] = (a[1][l] * b[2][l] - a[2][l] * b[1][l]) * inv_det;
+      normal[2][1][l] = (a[2][l] * b[0][l] - a[0][l] * b[2][l]) * inv_det;
+      normal[2][2][l] = (a[0][l] * b[1][l] - a[1][l] * b[0][l]) * inv_det;
+    }
+
+    for (u32 l = 0; l < live; l++) {
+      mat3x4 *out = &matrices[rows[base + l]].normal;
+      for (u32 col = 0; col < 3; col++) {
+        out->cols[col] = vec4_make(normal[col][0][l], normal[col][1][l], normal[col][2][l], 0.0f);
+      }
+    }
+  }
+}
+
+void transform_clip_batch(const Transform_Matrices *matrices, u32 count, mat4 proj_view,
+                          mat4 *clip_out) {
+  enum { LANES = TRANSFORM_BATCH_LANES };
+
+  for (u32 base = 0; base < count; base += LANES) {
+    u32 live = MIN(LANES, count - base);
+
+    f32 world[4][3][LANES];
+    for (u32 l = 0; l < LANES; l++) {
+      const mat4 *w = &matrices[base + MIN(l, live - 1)].world;
+      for (u32 col = 0; col < 4; col++) {
+        for (u32 row = 0; row < 3; row++) {
+          world[col][row][l] = w->cols[col].elements[row];
+        }
+      }
+    }
+
+    // World's bottom row is (0, 0, 0, 1), so three multiplies per element and the translation
+    // column picks up proj_view's last column. Summed in the same order as mat4_mul()
+    f32 clip[4][4][LANES];
+    for (u32 row = 0; row < 4; row++) {
+      f32 pv0 = proj_view.cols[0].elements[row];
+      f32 pv1 = proj_view.cols[1].elements[row];
+      f32 pv2 = proj_view.cols[2].elements[row];
+      f32 pv3 = proj_view.cols[3].elements[row];
+
+      for (u32 col = 0; col < 3; col++) {
+        for (u32 l = 0; l < LANES; l++) {
+          clip[col][row][l] =
+              pv0 * world[col][0][l] + pv1 * world[col][1][l] + pv2 * world[col][2][l];
+        }
+      }
+      for (u32 l = 0; l < LANES; l++) {
+        clip[3][row][l] =
+            pv0 * world[3][0][l] + pv1 * world[3][1][l] + pv2 * world[3][2][l] + pv3;
+      }
+    }
+
+    for (u32 l = 0; l < live; l++) {
+      mat4 *out = &clip_out[base + l];
+      for (u32 col = 0; col < 4; col++) {
+        out->cols[col] = vec4_make(clip[col][0][l], clip[col][1][l], clip[col][2][l],
+                                   clip[col][3][l]);
+      }
+    }
+  }
+}
@@ -0,0 +1,75 @@
+#ifndef TRANSFORM_H
+#define TRANSFORM_H
+
+#include "core/common.h"
+#include "core/linear_algebra.h"
+
+#include <stdbool.h>
+
+enum Transform_Constants {
+  TRANSFORM_BATCH_LANES = 8, // Entities per iteration of the batch kernels, one AVX register of f32
+};
+
+typedef enum Transform_Flags {
+  TRANSFORM_FLAG_NONE = 0,
+  TRANSFORM_FLAG_DIRTY = 1 << 0, // Position, rotation or scale changed since the last rebuild
+  TRANSFORM_FLAG_MOVED = 1 << 1, // World changed in the last update, children rebuild off of it
+} Transform_Flags;
+
+// Position, rotation and scale, relative to the parent if there is one. Kept apart from the
+// matrices built from them so things that only touch these (which is most of gameplay) stream
+// 48 bytes an entity instead of a couple hundred
+typedef struct Transform Transform;
+struct Transform {
+  vec3 position;
+  quat rotation;
+  vec3 scale;
+  Transform_Flags flags;
+};
+
+// Only rebuilt when something went through the setters (or the parent moved), so things that
+// don't move cost nothing to keep around. Only good after transform_update() clears the dirty flag
+typedef struct Transform_Matrices Transform_Matrices;
+struct Transform_Matrices {
+  mat4 local;
+  mat4 world;    // Parent's world * local
+  mat3x4 normal; // Inverse transpose of world's upper 3x3, padded for the push constants
+};
+
+Transform transform_make(vec3 position, quat rotation, vec3 scale);
+
+// NOTE(ss): Write through these rather than the fields, otherwise nothing knows to rebuild
+void transform_set_position(Transform *transform, vec3 position);
+void transform_set_rotation(Transform *transform, quat rotation);
+void transform_set_scale(Transform *transform, vec3 scale);
+// Applies delta on top of the current rotation, in the parent's space
+void transform_rotate(Transform *transform, quat delta);
+
+static inline bool transform_is_dirty(const Transform *transform) {
+  return transform->flags & TRANSFORM_FLAG_DIRTY;
+}
+
+// Rebuilds local if dirty, and world if that or the parent's world changed, returns whether world
+// changed. Parents are NULL for roots and have to have been updated already this frame
+bool transform_update(Transform *transform, Transform_Matrices *matrices, const Transform *parent,
+                      const Transform_Matrices *parent_matrices);
+
+// Same as transform_update() but leaves the normal matrix stale, for callers that collect what
+// moved and rebuild those in one go with transform_normal_batch()
+bool transform_update_world(Transform *transform, Transform_Matrices *matrices,
+                            const Transform *parent, const Transform_Matrices *parent_matrices);
+
+// Batch Kernels ---------------------------------------------------------------
+
+// NOTE(ss): These go TRANSFORM_BATCH_LANES entities at a time, transposed into [col][row][lane]
+// locals so every lane loop is straight down one array and the compiler turns it into vectors.
+// Both lean on world being affine (bottom row 0, 0, 0, 1), which anything built from a Transform is
+
+// Rebuilds the normal matrix of matrices[rows[i]] for each of the count rows
+void transform_normal_batch(Transform_Matrices *matrices, const u32 *rows, u32 count);
+
+// clip_out[i] = proj_view * matrices[i].world
+void transform_clip_batch(const Transform_Matrices *matrices, u32 count, mat4 proj_view,
+                          mat4 *clip_out);
+
+#endif // TRANSFORM_H
@@ -1,6 +1,8 @@
 #include "core/common.h"
+#include "core/ecs.h"
+#include "core/job.h"
 #include "core/linear_algebra.h"
-#include "core/pool.h"
+#include "core/memory_track.h"
 #include "core/thread_context.h"
 #include "core/window.h"
 
@@ -69,10 +71,68 @@ void process_input(Window *window, Camera *camera, f64 dt) {
   camera->position = vec3_add(camera->position, camera_velocity);
 }
 
+// Per chunk work handed out with job_parallel_for, each range only touches its own chunks
+typedef struct Entity_Update_Job Entity_Update_Job;
+struct Entity_Update_Job {
+  Entity_Pool *entity_pool;
+  ECS_Chunk **chunks;
+  quat rotation_delta;
+};
+
+void update_entities_range(void *data, u32 start, u32 end) {
+  Entity_Update_Job *job = data;
+  for (u32 c = start; c < end; c++) {
+    ECS_Chunk *chunk = job->chunks[c];
+    Transform *transforms =
+        ecs_chunk_column_type(chunk, job->entity_pool->components.transform, Transform);
+    for (u32 i = 0; i < chunk->count; i++) {
+      transform_rotate(&transforms[i], job->rotation_delta);
+    }
+  }
+}
+
+typedef struct Entity_Transform_Job Entity_Transform_Job;
+struct Entity_Transform_Job {
+  Entity_Pool *entity_pool;
+  ECS_Chunk **chunks;
+};
+
+void transform_entities_range(void *data, u32 start, u32 end) {
+  Entity_Transform_Job *job = data;
+  // Only what moved gets rebuilt
+  for (u32 c = start; c < end; c++) {
+    entity_update_transforms(job->entity_pool, job->chunks[c]);
+  }
+}
+
+typedef struct Entity_Clip_Job Entity_Clip_Job;
+struct Entity_Clip_Job {
+  Entity_Pool *entity_pool;
+  ECS_Chunk **chunks;
+  u32 *first_draws; // Per chunk, where its entities start in clip_transforms
+  mat4 proj_view;
+  mat4 *clip_transforms; // One per entity drawn
+};
+
+void clip_entities_range(void *data, u32 start, u32 end) {
+  Entity_Clip_Job *job = data;
+  // The camera moves though, so clip is every frame regardless
+  for (u32 c = start; c < end; c++) {
+    ECS_Chunk *chunk = job->chunks[c];
+    Transform_Matrices *matrices =
+        ecs_chunk_column_type(chunk, job->entity_pool->components.matrices, Transform_Matrices);
+    transform_clip_batch(matrices, chunk->count, job->proj_view,
+                         &job->clip_transforms[job->first_draws[c]]);
+  }
+}
+
 // MAIN!!!
 int main(int argc, char **argv) {
   Thread_Context main_tctx;
-  thread_context_init(&main_tctx);
+  thread_context_init(&main_tctx, "main");
+
+  // Main thread is worker 0
+  job_system_init(0, false);
 
   Game game = {0};
   game_init(&game, argc, argv);
@@ -81,55 +141,63 @@ int main(int argc, char **argv) {
       &game.render_context, sizeof(RND_Global_UBO), game.render_context.swap.frames_in_flight);
 
   {
-    for (u32 i = 0; i < ENTITY_MAX_NUM; i++) {
-      Entity *entity = NULL;
+    Entity_Pool *ep = &game.entity_pool;
+    for (u32 i = 0; i < GAME_DEMO_ENTITY_COUNT; i++) {
+      Entity_Handle entity = POOL_HANDLE_NIL;
       if (i % 3 == 0) {
-        entity = entity_make(&game.entity_pool, &game.render_context, &game.asset_manager,
-                             ENTITY_FLAG_DEFAULT, vec3(0.f, 0.f, -2.f), vec3(0.f, 0.f, 0.f),
-                             vec3(1.f, 1.f, 1.f), NULL);
-        entity->position = vec3_add(entity->position, vec3(2.f * i, -2.f * i, -1.f * i));
+        entity = entity_make(ep, &game.render_context, &game.asset_manager, vec3(0.f, 0.f, -2.f),
+                             quat_identity(), vec3(1.f, 1.f, 1.f), NULL);
+        Transform *transform = entity_transform(ep, entity);
+        transform_set_position(transform,
+                               vec3_add(transform->position, vec3(2.f * i, -2.f * i, -1.f * i)));
       } else if (i % 3 == 1) {
-        entity = entity_make(&game.entity_pool, &game.render_context, &game.asset_manager,
-                             ENTITY_FLAG_DEFAULT, vec3(0.f, 0.f, -2.f), vec3(0.f, 0.f, 0.f),
-                             vec3(1.f, 1.f, 1.f), "assets/smooth_vase.obj");
-        entity->position = vec3_add(entity->position, vec3(-2.f * i, 2.f * i, -1.f * i));
-        entity->scale = vec3(5.f, 5.f, 5.f);
+        entity = entity_make(ep, &game.render_context, &game.asset_manager, vec3(0.f, 0.f, -2.f),
+                             quat_identity(), vec3(1.f, 1.f, 1.f), "assets/smooth_vase.obj");
+        Transform *transform = entity_transform(ep, entity);
+        transform_set_position(transform,
+                               vec3_add(transform->position, vec3(-2.f * i, 2.f * i, -1.f * i)));
+        transform_set_scale(transform, vec3(5.f, 5.f, 5.f));
       } else if (i % 3 == 2) {
-        entity = entity_make(&game.entity_pool, &game.render_context, &game.asset_manager,
-                             ENTITY_FLAG_DEFAULT, vec3(0.f, 0.f, -2.f), vec3(0.f, 0.f, 0.f),
-                             vec3(1.f, 1.f, 1.f), "assets/flat_vase.obj");
-        entity->position = vec3_add(entity->position, vec3(0.f, 2.f * i, -1.f * i));
-        entity->scale = vec3(5.f, 5.f, 5.f);
+        entity = entity_make(ep, &game.render_context, &game.asset_manager, vec3(0.f, 0.f, -2.f),
+                             quat_identity(), vec3(1.f, 1.f, 1.f), "assets/flat_vase.obj");
+        Transform *transform = entity_transform(ep, entity);
+        transform_set_position(transform,
+                               vec3_add(transform->position, vec3(0.f, 2.f * i, -1.f * i)));
+        transform_set_scale(transform, vec3(5.f, 5.f, 5.f));
       }
 
       // Testing purposes
       if ((i <= 5) || (i >= 10 && i <= 15)) {
-        entity_free(&game.entity_pool, &game.render_context, &game.asset_manager, entity);
+        entity_free(ep, &game.render_context, &game.asset_manager, entity);
       }
     }
 
     // Testing purposes
-    entity_make(&game.entity_pool, &game.render_context, &game.asset_manager, ENTITY_FLAG_DEFAULT,
-                vec3(0.f, 4.f, -2.f), vec3(0.f, 0.f, 0.f), vec3(1.f, 1.f, 1.f), "assets/f22.obj");
-    entity_make(&game.entity_pool, &game.render_context, &game.asset_manager, ENTITY_FLAG_DEFAULT,
-                vec3(0.f, 0.f, -2.f), vec3(0.f, 0.f, 0.f), vec3(1.f, 1.f, 1.f),
-                "assets/sphere.obj");
-    entity_make(&game.entity_pool, &game.render_context, &game.asset_manager, ENTITY_FLAG_DEFAULT,
-                vec3(0.f, -4.f, -2.f), vec3(0.f, 0.f, 0.f), vec3(1.f, 1.f, 1.f), "assets/crab.obj");
-    entity_make(&game.entity_pool, &game.render_context, &game.asset_manager, ENTITY_FLAG_DEFAULT,
-                vec3(4.f, -4.f, -5.f), vec3(0.f, 0.f, 0.f), vec3(1.f, 1.f, 1.f),
-                "assets/colored_cube.obj");
-    entity_make(&game.entity_pool, &game.render_context, &game.asset_manager, ENTITY_FLAG_DEFAULT,
-                vec3(4.f, -4.f, -5.f), vec3(0.f, 0.f, 0.f), vec3(1.f, 1.f, 1.f),
-                "assets/colored_cube.obj");
+    Entity_Handle f22 = entity_make(ep, &game.render_context, &game.asset_manager,
+                                    vec3(0.f, 4.f, -2.f), quat_identity(), vec3(1.f, 1.f, 1.f),
+                                    "assets/f22.obj");
+    Entity_Handle sphere = entity_make(ep, &game.render_context, &game.asset_manager,
+                                       vec3(0.f, 0.f, -2.f), quat_identity(), vec3(1.f, 1.f, 1.f),
+                                       "assets/sphere.obj");
+    // Testing purposes, orbits along with the f22 on top of its own spin
+    entity_set_parent(ep, sphere, f22);
+    entity_make(ep, &game.render_context, &game.asset_manager, vec3(0.f, -4.f, -2.f),
+                quat_identity(), vec3(1.f, 1.f, 1.f), "assets/crab.obj");
+    entity_make(ep, &game.render_context, &game.asset_manager, vec3(4.f, -4.f, -5.f),
+                quat_identity(), vec3(1.f, 1.f, 1.f), "assets/colored_cube.obj");
+    entity_make(ep, &game.render_context, &game.asset_manager, vec3(4.f, -4.f, -5.f),
+                quat_identity(), vec3(1.f, 1.f, 1.f), "assets/colored_cube.obj");
 
     // TODO(ss): make sure we will reuse the asset spot freed
-    Entity *to_free = entity_make(&game.entity_pool, &game.render_context, &game.asset_manager,
-                                  ENTITY_FLAG_DEFAULT, vec3(4.f, -4.f, -5.f), vec3(0.f, 0.f, 0.f),
-                                  vec3(1.f, 1.f, 1.f), "assets/f117.obj");
-    entity_free(&game.entity_pool, &game.render_context, &game.asset_manager, to_free);
+    Entity_Handle to_free = entity_make(ep, &game.render_context, &game.asset_manager,
+                                        vec3(4.f, -4.f, -5.f), quat_identity(),
+                                        vec3(1.f, 1.f, 1.f), "assets/f117.obj");
+    entity_free(ep, &game.render_context, &game.asset_manager, to_free);
   }
 
+  // What allocated in a frame and from where, every so often. Only with -DMEMORY_TRACKING
+  mem_track_set_frame_dump(stderr, MEM_TRACK_FRAME_DUMP_INTERVAL);
+
   // First frame time
   u64 last_frame_time = get_time_ns();
   while (!window_should_close(&game.window)) {
@@ -153,21 +221,24 @@ int main(int argc, char **argv) {
       last_frame_time = get_time_ns();
     }
 
+    // Safe to build up anything the GPU will read this frame from here on out
+    game_begin_frame_arena(&game);
+
     process_input(&game.window, &game.camera, game.dt_s);
 
     // Update Logic
     {
-      u32 entities_end = 0;
-      Entity *entities = (Entity *)pool_as_array(&game.entity_pool.pool, &entities_end);
-      for (u32 i = 0; i < entities_end; i++) {
-        if (entities[i].flags == ENTITY_FLAG_INVALID) {
-          continue;
-        }
+      f32 angle = 0.10f * PI * game.dt_s;
+      Entity_Update_Job update = {
+          .entity_pool = &game.entity_pool,
+          .rotation_delta = quat_from_euler(vec3(angle, angle, angle)),
+      };
+      ECS_Query query = {.all = ECS_BIT(game.entity_pool.components.transform)};
 
-        entities[i].rotation.x += 0.10f * PI * game.dt_s;
-        entities[i].rotation.y += 0.10f * PI * game.dt_s;
-        entities[i].rotation.z += 0.10f * PI * game.dt_s;
-      }
+      u32 chunk_count = 0;
+      update.chunks = ecs_query_chunks(&game.entity_pool.world, query, game_frame_arena(&game),
+                                       &chunk_count);
+      job_parallel_for(chunk_count, ENTITY_JOB_GRAIN_CHUNKS, update_entities_range, &update);
     }
 
     rnd_begin_frame(&game.render_context, &game.window);
@@ -186,39 +257,88 @@ int main(int argc, char **argv) {
 
       rnd_pipeline_bind(&game.render_context, &game.render_context.pipelines[RND_PIPELINE_MESH]);
 
-      u32 entities_end = 0;
-      Entity *entities = (Entity *)pool_as_array(&game.entity_pool.pool, &entities_end);
-      for (u32 i = 0; i < entities_end; i++) {
-        if (entities[i].flags == ENTITY_FLAG_INVALID) {
-          continue;
-        }
+      Entity_Pool *ep = &game.entity_pool;
+      Arena *frame_arena = game_frame_arena(&game);
 
-        mat4 model_transform = entity_model_mat4(&entities[i]);
-        mat4 clip_transform = mat4_mul(proj_view, model_transform);
-
-        RND_Push_Constants push = {
-            .clip_transform = clip_transform,
-            .normal_matrix = entity_normal_mat4(&entities[i]),
+      // Matrices across all the workers first, then record serially. Each level only needs the one
+      // above it done, so it's one parallel for per level
+      u32 level_count = entity_pool_level_count(ep);
+      for (u32 depth = 0; depth < level_count; depth++) {
+        Entity_Transform_Job transform = {
+            .entity_pool = ep,
         };
+        u32 chunk_count = 0;
+        transform.chunks = ecs_query_chunks(&ep->world, entity_query_level(ep, depth),
+                                            frame_arena, &chunk_count);
+        job_parallel_for(chunk_count, ENTITY_JOB_GRAIN_CHUNKS, transform_entities_range,
+                         &transform);
+      }
 
-        rnd_pipeline_push_constants(&game.render_context,
-                                    &game.render_context.pipelines[RND_PIPELINE_MESH], push);
+      ECS_Query drawable = {
+          .all = ECS_BIT(ep->components.matrices) | ECS_BIT(ep->components.mesh),
+      };
+      u32 chunk_count = 0;
+      u32 draw_count = ecs_query_count(&ep->world, drawable);
+      Entity_Clip_Job clip = {
+          .entity_pool = ep,
+          .chunks = ecs_query_chunks(&ep->world, drawable, frame_arena, &chunk_count),
+          .proj_view = proj_view,
+          .clip_transforms = arena_calloc_nozero(frame_arena, draw_count, mat4),
+      };
+      clip.first_draws = arena_calloc_nozero(frame_arena, chunk_count, u32);
+      for (u32 c = 0, draws = 0; c < chunk_count; c++) {
+        clip.first_draws[c] = draws;
+        draws += clip.chunks[c]->count;
+      }
+      job_parallel_for(chunk_count, ENTITY_JOB_GRAIN_CHUNKS, clip_entities_range, &clip);
+
+      // Handles to meshes for everything being drawn, resolved up front rather than per draw
+      RND_Mesh **draw_meshes = arena_calloc_nozero(frame_arena, draw_count, RND_Mesh *);
+      for (u32 c = 0; c < chunk_count; c++) {
+        ECS_Chunk *chunk = clip.chunks[c];
+        ASS_Handle *handles = ecs_chunk_column_type(chunk, ep->components.mesh, ASS_Handle);
+        ass_resolve_meshes(&game.asset_manager, handles, chunk->count,
+                           &draw_meshes[clip.first_draws[c]]);
+      }
 
-        rnd_mesh_bind(&game.render_context, entities[i].mesh_asset->mesh_data);
-        rnd_mesh_draw(&game.render_context, entities[i].mesh_asset->mesh_data);
+      for (u32 c = 0; c < chunk_count; c++) {
+        ECS_Chunk *chunk = clip.chunks[c];
+        Transform_Matrices *matrices =
+            ecs_chunk_column_type(chunk, ep->components.matrices, Transform_Matrices);
+
+        for (u32 i = 0; i < chunk->count; i++) {
+          u32 draw = clip.first_draws[c] + i;
+          // Asset was freed out from under it
+          if (draw_meshes[draw] == NULL)
+            continue;
+
+          RND_Push_Constants push = {
+              .clip_transform = clip.clip_transforms[draw],
+              .normal_matrix = matrices[i].normal,
+          };
+          rnd_pipeline_push_constants(&game.render_context,
+                                      &game.render_context.pipelines[RND_PIPELINE_MESH], push);
+
+          rnd_mesh_bind(&game.render_context, draw_meshes[draw]);
+          rnd_mesh_draw(&game.render_context, draw_meshes[draw]);
+        }
       }
     }
     rnd_end_frame(&game.render_context);
 
-    arena_clear(&game.frame_arena);
+    mem_track_frame_end();
   }
 
   vkDeviceWaitIdle(game.render_context.logical);
 
   rnd_buffer_free(&game.render_context, &global_uniform_buffer);
 
+  mem_track_dump(stderr);
+
   game_free(&game);
 
+  job_system_free();
+
   thread_context_free();
 
   return EXT_SUCCESS;
@@ -1,8 +1,20 @@
+#ifdef OS_LINUX
+#define _GNU_SOURCE // sched_getaffinity, pthread_setname_np and friends
+#endif
+
 #include "os/os.h"
 
 #ifdef OS_WINDOWS
 #include <windows.h>
 #elif OS_LINUX
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
 #include <unistd.h>
 #endif
 
@@ -21,3 +33,247 @@ void os_sleep_ns(u64 nanoseconds) {
   usleep(nanoseconds / 1e3);
 #endif
 }
+
+void *os_reserve(isize size) {
+#ifdef OS_WINDOWS
+  return VirtualAlloc(NULL, size, MEM_RESERVE, PAGE_NOACCESS);
+#elif OS_LINUX
+  // NORESERVE so that the kernel doesn't count the whole range against overcommit
+  void *ptr = mmap(NULL, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  return ptr == MAP_FAILED ? NULL : ptr;
+#endif
+}
+
+bool os_commit(void *ptr, isize size) {
+#ifdef OS_WINDOWS
+  return VirtualAlloc(ptr, size, MEM_COMMIT, PAGE_READWRITE) != NULL;
+#elif OS_LINUX
+  return mprotect(ptr, size, PROT_READ | PROT_WRITE) == 0;
+#endif
+}
+
+void os_decommit(void *ptr, isize size) {
+#ifdef OS_WINDOWS
+  VirtualFree(ptr, size, MEM_DECOMMIT);
+#elif OS_LINUX
+  // Drop the physical pages first, then make sure any stray access faults
+  madvise(ptr, size, MADV_DONTNEED);
+  mprotect(ptr, size, PROT_NONE);
+#endif
+}
+
+void os_release(void *ptr, isize size) {
+#ifdef OS_WINDOWS
+  (void)size;
+  VirtualFree(ptr, 0, MEM_RELEASE);
+#elif OS_LINUX
+  munmap(ptr, size);
+#endif
+}
+
+isize os_page_size(void) {
+#ifdef OS_WINDOWS
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return info.dwPageSize;
+#elif OS_LINUX
+  return sysconf(_SC_PAGESIZE);
+#endif
+}
+
+bool os_file_map(const char *path, OS_File_Map *out_map) {
+  *out_map = (OS_File_Map){0};
+
+#ifdef OS_WINDOWS
+  HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                            FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+  if (file == INVALID_HANDLE_VALUE)
+    return false;
+
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size)) {
+    CloseHandle(file);
+    return false;
+  }
+
+  out_map->size = size.QuadPart;
+  if (out_map->size > 0) {
+    // The mapping keeps the file alive on its own
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (mapping == NULL)
+      return false;
+
+    out_map->data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (out_map->data == NULL) {
+      CloseHandle(mapping);
+      return false;
+    }
+    out_map->handle = (u64)mapping;
+  } else {
+    CloseHandle(file);
+  }
+#elif OS_LINUX
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  struct stat info;
+  if (fstat(fd, &info) != 0) {
+    close(fd);
+    return false;
+  }
+
+  // Can't map zero bytes, an empty file is just no data. The mapping outlives the descriptor
+  out_map->size = info.st_size;
+  if (out_map->size > 0) {
+    void *data = mmap(NULL, out_map->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+      return false;
+
+    // Read front to back, lets the kernel read ahead more aggressively
+    madvise(data, out_map->size, MADV_SEQUENTIAL);
+    out_map->data = data;
+  } else {
+    close(fd);
+  }
+#endif
+
+  return true;
+}
+
+void os_file_unmap(OS_File_Map *map) {
+  if (map->data != NULL) {
+#ifdef OS_WINDOWS
+    UnmapViewOfFile(map->data);
+    CloseHandle((HANDLE)map->handle);
+#elif OS_LINUX
+    munmap((void *)map->data, map->size);
+#endif
+  }
+
+  *map = (OS_File_Map){0};
+}
+
+// Both platforms want their own signature for the thread entry, so bounce through this
+typedef struct OS_Thread_Start OS_Thread_Start;
+struct OS_Thread_Start {
+  OS_Thread_Proc *proc;
+  void *arg;
+};
+
+#ifdef OS_WINDOWS
+translation_local DWORD WINAPI os_thread_entry(LPVOID param) {
+#elif OS_LINUX
+translation_local void *os_thread_entry(void *param) {
+#endif
+  OS_Thread_Start start = *(OS_Thread_Start *)param;
+  free(param);
+
+  start.proc(start.arg);
+
+  return 0;
+}
+
+OS_Thread os_thread_make(OS_Thread_Proc *proc, void *arg) {
+  OS_Thread_Start *start = malloc(sizeof(*start));
+  *start = (OS_Thread_Start){.proc = proc, .arg = arg};
+
+  OS_Thread thread = {0};
+#ifdef OS_WINDOWS
+  thread.handle = (u64)CreateThread(NULL, 0, os_thread_entry, start, 0, NULL);
+#elif OS_LINUX
+  pthread_t handle;
+  if (pthread_create(&handle, NULL, os_thread_entry, start) == 0) {
+    thread.handle = (u64)handle;
+  } else {
+    free(start);
+  }
+#endif
+
+  return thread;
+}
+
+void os_thread_join(OS_Thread thread) {
+#ifdef OS_WINDOWS
+  WaitForSingleObject((HANDLE)thread.handle, INFINITE);
+  CloseHandle((HANDLE)thread.handle);
+#elif OS_LINUX
+  pthread_join((pthread_t)thread.handle, NULL);
+#endif
+}
+
+u64 os_thread_id(void) {
+#ifdef OS_WINDOWS
+  return GetCurrentThreadId();
+#elif OS_LINUX
+  return gettid();
+#endif
+}
+
+void os_thread_set_name(const char *name) {
+#ifdef OS_WINDOWS
+  wchar_t wide[64] = {0};
+  MultiByteToWideChar(CP_UTF8, 0, name, -1, wide, STATIC_ARRAY_COUNT(wide) - 1);
+  SetThreadDescription(GetCurrentThread(), wide);
+#elif OS_LINUX
+  char truncated[16] = {0};
+  strncpy(truncated, name, sizeof(truncated) - 1);
+  pthread_setname_np(pthread_self(), truncated);
+#endif
+}
+
+bool os_thread_set_affinity(u32 core) {
+#ifdef OS_WINDOWS
+  return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << core) != 0;
+#elif OS_LINUX
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(core, &set);
+  return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#endif
+}
+
+void os_thread_yield(void) {
+#ifdef OS_WINDOWS
+  SwitchToThread();
+#elif OS_LINUX
+  sched_yield();
+#endif
+}
+
+u32 os_core_count(void) {
+#ifdef OS_WINDOWS
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return info.dwNumberOfProcessors;
+#elif OS_LINUX
+  // Respects taskset/cgroup affinity unlike _SC_NPROCESSORS_ONLN
+  cpu_set_t set;
+  if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+    return CPU_COUNT(&set);
+  }
+  return sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+}
+
+void os_futex_wait(_Atomic u32 *address, u32 expected) {
+#ifdef OS_WINDOWS
+  WaitOnAddress((volatile VOID *)address, &expected, sizeof(expected), INFINITE);
+#elif OS_LINUX
+  syscall(SYS_futex, address, FUTEX_WAIT_PRIVATE, expected, NULL, NULL, 0);
+#endif
+}
+
+void os_futex_wake(_Atomic u32 *address, u32 count) {
+#ifdef OS_WINDOWS
+  if (count == 1) {
+    WakeByAddressSingle((PVOID)address);
+  } else {
+    WakeByAddressAll((PVOID)address);
+  }
+#elif OS_LINUX
+  syscall(SYS_futex, address, FUTEX_WAKE_PRIVATE, MIN(count, (u32)INT32_MAX), NULL, NULL, 0);
+#endif
+}
@@ -3,6 +3,16 @@
 
 #include "core/common.h"
 
+#include <stdbool.h>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+// Tell the core we're in a spin loop, cheaper on the sibling hyperthread than spinning flat out
+#define OS_CPU_RELAX() _mm_pause()
+#else
+#define OS_CPU_RELAX() VOID_PROC
+#endif
+
 /* NOTE(ss): Since so far this is the only thing we need specific to each platform,
  * I thought to keep it simple and just do definition based implementations, if we go further and
  * need to separate these into specific translations units and do the whole conditionally compiling
@@ -11,4 +21,57 @@
 void os_sleep_ms(u64 milliseconds);
 void os_sleep_ns(u64 nanoseconds);
 
+// Virtual Memory ---------------------------------------------------------------
+
+// Reserve just grabs address space, touching it before a commit will fault. Commit makes the pages
+// readable and writable (and zeroed the first time they are touched), decommit hands the physical
+// pages back to the OS but keeps the address range reserved
+void *os_reserve(isize size);
+bool os_commit(void *ptr, isize size);
+void os_decommit(void *ptr, isize size);
+void os_release(void *ptr, isize size);
+
+isize os_page_size(void);
+
+// Files ------------------------------------------------------------------------
+
+// Read only view of a whole file, pages come in as they get touched
+typedef struct OS_File_Map OS_File_Map;
+struct OS_File_Map {
+  const u8 *data; // NULL for empty files
+  isize size;
+  u64 handle; // Mapping object on Windows, unused on Linux
+};
+
+// False if the file couldn't be opened or mapped, errno (or GetLastError) says why
+bool os_file_map(const char *path, OS_File_Map *out_map);
+void os_file_unmap(OS_File_Map *map);
+
+// Threads ----------------------------------------------------------------------
+
+typedef void OS_Thread_Proc(void *arg);
+
+typedef struct OS_Thread OS_Thread;
+struct OS_Thread {
+  u64 handle;
+};
+
+OS_Thread os_thread_make(OS_Thread_Proc *proc, void *arg);
+void os_thread_join(OS_Thread thread);
+void os_thread_yield(void);
+
+// All of these act on the calling thread
+u64 os_thread_id(void);
+// Shows up in debuggers and profilers, Linux truncates to 15 characters
+void os_thread_set_name(const char *name);
+bool os_thread_set_affinity(u32 core);
+
+// Logical cores available to this process
+u32 os_core_count(void);
+
+// Sleep until *address no longer holds expected or someone wakes it, may return spuriously so
+// always recheck in a loop. Wake count of UINT32_MAX wakes everyone
+void os_futex_wait(_Atomic u32 *address, u32 expected);
+void os_futex_wake(_Atomic u32 *address, u32 count);
+
 #endif // OS_H
@@ -114,6 +114,14 @@ void rnd_context_free(RND_Context *rc) {
 // right field in rc->swap
 translation_local VkResult acquire_next_image(RND_Context *rc);
 
+void rnd_wait_frame(RND_Context *rc) {
+  u32 current_frame = rc->swap.current_frame_idx;
+
+  VK_CHECK_ERROR(vkWaitForFences(rc->logical, 1, &rnd_get_current_frame_info(rc)->in_flight_fence,
+                                 VK_TRUE, UINT64_MAX),
+                 "Failed to wait on in flight fence %u", current_frame);
+}
+
 void rnd_begin_frame(RND_Context *rc, Window *window) {
   u32 current_frame = rc->swap.current_frame_idx;
 
@@ -252,11 +260,8 @@ VkCommandBuffer rnd_get_current_draw_cmd(const RND_Context *rc) {
 }
 
 translation_local VkResult acquire_next_image(RND_Context *rc) {
-  u32 current_frame = rc->swap.current_frame_idx;
-
-  VK_CHECK_ERROR(vkWaitForFences(rc->logical, 1, &rnd_get_current_frame_info(rc)->in_flight_fence,
-                                 VK_TRUE, UINT64_MAX),
-                 "Failed to wait on in flight fence %u", current_frame);
+  // Already signaled if rnd_wait_frame was called this frame, so this is cheap
+  rnd_wait_frame(rc);
 
   // Which IMAGE... ie the actual framebuffer is ready to be drawn into
   // This is seperate than per frame resources we keep track of
@@ -310,14 +315,16 @@ translation_local const char **get_glfw_required_extensions(Arena *arena, u32 *n
   return extensions;
 }
 
-translation_local bool check_val_layer_support(Arena *arena, const char *const *layers,
-                                               u32 num_layers) {
+// Only needs temporary memory, so grabs its own scratch instead of leaking into the caller's
+translation_local bool check_val_layer_support(const char *const *layers, u32 num_layers) {
+  Scratch scratch = thread_get_scratch();
+
   u32 num_supported_layers;
   VK_CHECK_ERROR(vkEnumerateInstanceLayerProperties(&num_supported_layers, NULL),
                  "Failed to enumerate instance layer properties");
 
   VkLayerProperties *supported_layers =
-      arena_calloc(arena, num_supported_layers, VkLayerProperties);
+      arena_calloc(scratch.arena, num_supported_layers, VkLayerProperties);
   VK_CHECK_ERROR(vkEnumerateInstanceLayerProperties(&num_supported_layers, supported_layers),
                  "Failed to enumerate instance layer properties");
 
@@ -332,10 +339,12 @@ translation_local bool check_val_layer_support(Arena *arena, const char *const *
     }
 
     if (!found) {
+      thread_end_scratch(&scratch);
       return false;
     }
   }
 
+  thread_end_scratch(&scratch);
   return true;
 }
 
@@ -376,7 +385,7 @@ translation_local void create_instance(RND_Context *rc) {
 
   VkDebugUtilsMessengerCreateInfoEXT debug_info = {0};
   if (enable_val_layers) {
-    if (!check_val_layer_support(scratch.arena, enabled_validation_layers,
+    if (!check_val_layer_support(enabled_validation_layers,
                                  STATIC_ARRAY_COUNT(enabled_validation_layers))) {
       LOG_FATAL("Failed to find specified Validation Layers", EXT_VK_LAYERS);
     }
@@ -414,16 +423,19 @@ translation_local void create_instance(RND_Context *rc) {
   thread_end_scratch(&scratch);
 }
 
-translation_local bool check_device_extension_support(Arena *arena, VkPhysicalDevice device,
+// Same as above, called once per device so this keeps each check from piling up in the caller's
+translation_local bool check_device_extension_support(VkPhysicalDevice device,
                                                       const char *const *extensions,
                                                       u32 num_extensions) {
+  Scratch scratch = thread_get_scratch();
+
   u32 extension_count = 0;
 
   VK_CHECK_ERROR(vkEnumerateDeviceExtensionProperties(device, NULL, &extension_count, NULL),
                  "Failed to enumerate device extension properties");
 
   VkExtensionProperties *available_extensions =
-      arena_calloc(arena, extension_count, VkExtensionProperties);
+      arena_calloc(scratch.arena, extension_count, VkExtensionProperties);
   VK_CHECK_ERROR(
       vkEnumerateDeviceExtensionProperties(device, NULL, &extension_count, available_extensions),
       "Failed to enumerate device extension properties");
@@ -439,10 +451,12 @@ translation_local bool check_device_extension_support(Arena *arena, VkPhysicalDe
     }
 
     if (!found) {
+      thread_end_scratch(&scratch);
       return false;
     }
   }
 
+  thread_end_scratch(&scratch);
   return true;
 }
 
@@ -476,7 +490,7 @@ translation_local void choose_physical_device(RND_Context *rc) {
     VkPhysicalDeviceFeatures dev_feats;
     vkGetPhysicalDeviceFeatures(phys_devs[i], &dev_feats);
 
-    if (check_device_extension_support(scratch.arena, phys_devs[i], required_device_extensions,
+    if (check_device_extension_support(phys_devs[i], required_device_extensions,
                                        STATIC_ARRAY_COUNT(required_device_extensions))) {
       if (dev_props.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU) {
         device_ranking[0] = phys_devs[i];
@@ -99,6 +99,9 @@ struct RND_Context {
 void rnd_context_init(RND_Context *render_context, Window *window);
 void rnd_context_free(RND_Context *render_context);
 
+// Blocks until the GPU is finished with the current frame in flight's resources, safe to call
+// before rnd_begin_frame (which waits as well) to know when per-frame CPU data can be reused
+void rnd_wait_frame(RND_Context *render_context);
 void rnd_begin_frame(RND_Context *render_context, Window *window);
 void rnd_end_frame(RND_Context *render_context);
 
@@ -231,8 +231,8 @@ translation_local Shader_Code read_shader_file(Arena *arena, const char *file_pa
   shader_data.size = byte_count;
   rewind(shader_file);
 
-  // aligned with u32, since that is what vulkan is expecting
-  shader_data.data = arena_calloc(arena, byte_count, u8);
+  // aligned with u32, since that is what vulkan is expecting, and fread fills the whole thing
+  shader_data.data = arena_alloc_nozero(arena, byte_count, alignof(u32));
 
   i64 bytes_read = fread(shader_data.data, 1, byte_count, shader_file);
   if (bytes_read != byte_count) {
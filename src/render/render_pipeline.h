@@ -37,7 +37,9 @@ struct Pipeline_Config {
 typedef struct RND_Push_Constants RND_Push_Constants;
 struct RND_Push_Constants {
   mat4 clip_transform;
-  mat4 normal_matrix; // For some reason only works when its a mat4?!
+  // NOTE(ss): GLSL pads each mat3 column to a vec4 under std430 too, hence the mat3x4, a plain
+  // packed mat3 here is what made it look like only a mat4 would work
+  mat3x4 normal_matrix;
 };
 
 typedef struct RND_Context RND_Context;
@@ -6,7 +6,7 @@ layout(location = 0) out vec4 out_color;
 
 layout(push_constant) uniform Push {
     mat4 clip_transform;
-    mat4 normal_matrix;
+    mat3 normal_matrix;
 } push;
 
 void main() {
@@ -9,7 +9,7 @@ layout(location = 0) out vec3 out_color;
 
 layout(push_constant) uniform Push {
     mat4 clip_transform;
-    mat4 normal_matrix;
+    mat3 normal_matrix;
 } push;
 
 const vec3 DIRECTION_TO_LIGHT = normalize(vec3(1.0, 1.0, 1.0));
@@ -22,7 +22,7 @@ void main() {
     // therefore transform the normal vertex to world space
     // As well we only need the 3x3 matrix, normals are directions
     // not positions, not affected by translations
-    vec3 normal_world_space = normalize(mat3(push.normal_matrix) * in_normal);
+    vec3 normal_world_space = normalize(push.normal_matrix * in_normal);
 
     // We don't really care if the light is facing away, clamp negatives to 0
     float light_intensity = AMBIENT + max(dot(normal_world_space, DIRECTION_TO_LIGHT), 0);
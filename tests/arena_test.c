@@ -0,0 +1,214 @@
+// Checks arena allocation, zeroing and unwinding across the plain, resizable and chained flavours,
+// then times arena_alloc against arena_alloc_nozero for the fill-right-away case it exists for
+
+#include "core/arena.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+enum Test_Constants {
+  TEST_ARENA_SIZE = MB(1),
+  TEST_CHAIN_BLOCK_SIZE = KB(512),
+  TEST_CHAIN_ALLOCATIONS = 4096,
+  TEST_BENCH_SIZE = MB(64), // Well past the caches, so this is mostly about memory bandwidth
+  TEST_BENCH_SMALL_COUNT = 100000,
+  TEST_BENCH_RUNS = 7, // Best of, this is usually on a noisy machine
+};
+
+translation_local u32 rng_state = 12345;
+
+// xorshift32, same sequence every run
+translation_local u32 random_u32(void) {
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 17;
+  rng_state ^= rng_state << 5;
+  return rng_state;
+}
+
+translation_local bool all_zero(const u8 *bytes, isize size) {
+  for (isize i = 0; i < size; i++) {
+    if (bytes[i] != 0)
+      return false;
+  }
+
+  return true;
+}
+
+translation_local bool report(const char *name, bool passed) {
+  printf("  %-26s %s\n", name, passed ? "ok" : "FAILED");
+  return passed;
+}
+
+// Dirty some memory, pop it, and make sure arena_alloc hands it back zeroed
+translation_local bool check_zeroing(Arena_Flags flags) {
+  Arena arena = arena_make(TEST_ARENA_SIZE, flags);
+  bool passed = true;
+
+  isize save = arena_position(&arena);
+  u8 *dirty = arena_alloc_nozero(&arena, KB(4), 16);
+  memset(dirty, 0xAB, KB(4));
+  arena_pop_to(&arena, save);
+
+  u8 *clean = arena_alloc(&arena, KB(4), 16);
+  passed &= clean == dirty;
+  passed &= all_zero(clean, KB(4));
+
+  // The non-zeroing path really does leave the old contents alone
+  arena_pop_to(&arena, save);
+  memset(clean, 0xCD, KB(4));
+  u8 *stale = arena_alloc_nozero(&arena, KB(4), 16);
+  passed &= stale == clean && stale[0] == 0xCD && stale[KB(4) - 1] == 0xCD;
+
+  arena_free(&arena);
+  return passed;
+}
+
+// Every allocation lands on its alignment and past the end of the one before it. Past 16 is more
+// than calloc promises, so those have to line up the address and not just the offset
+translation_local bool check_alignment(Arena_Flags flags) {
+  Arena arena = arena_make(TEST_ARENA_SIZE, flags);
+  bool passed = true;
+
+  uintptr_t previous_end = 0;
+  for (u32 i = 0; i < 1000; i++) {
+    isize alignment = (isize)1 << (random_u32() % 8);
+    isize size = 1 + random_u32() % 100;
+
+    u8 *ptr = arena_alloc_nozero(&arena, size, alignment);
+    passed &= ((uintptr_t)ptr & (alignment - 1)) == 0;
+    passed &= (uintptr_t)ptr >= previous_end;
+    previous_end = (uintptr_t)ptr + size;
+  }
+
+  u8 *page = arena_alloc_nozero(&arena, 1, KB(4));
+  passed &= ((uintptr_t)page & (KB(4) - 1)) == 0;
+
+  arena_free(&arena);
+  return passed;
+}
+
+// Fill a chain of blocks with a pattern, then pop back through them checking nothing got stomped
+translation_local bool check_chaining(void) {
+  Arena arena = arena_make(TEST_CHAIN_BLOCK_SIZE, ARENA_FLAG_CHAINABLE);
+  bool passed = true;
+
+  u32 *allocations[TEST_CHAIN_ALLOCATIONS];
+  isize positions[TEST_CHAIN_ALLOCATIONS];
+  u32 counts[TEST_CHAIN_ALLOCATIONS];
+
+  for (u32 i = 0; i < TEST_CHAIN_ALLOCATIONS; i++) {
+    positions[i] = arena_position(&arena);
+    counts[i] = 1 + random_u32() % 256;
+    allocations[i] = arena_calloc_nozero(&arena, counts[i], u32);
+    for (u32 j = 0; j < counts[i]; j++) {
+      allocations[i][j] = i;
+    }
+  }
+
+  passed &= arena.prev_block != NULL;
+
+  for (u32 i = TEST_CHAIN_ALLOCATIONS; i-- > 0;) {
+    for (u32 j = 0; j < counts[i]; j++) {
+      passed &= allocations[i][j] == i;
+    }
+    arena_pop_to(&arena, positions[i]);
+    passed &= arena_position(&arena) == positions[i];
+  }
+
+  passed &= arena.prev_block == NULL && arena_position(&arena) == 0;
+
+  // Second time around should come off the free list, same addresses
+  u32 *again = arena_calloc_nozero(&arena, counts[0], u32);
+  passed &= again == allocations[0];
+
+  arena_free(&arena);
+  return passed;
+}
+
+// Resizable arenas only commit what has been asked for, in ARENA_COMMIT_SIZE steps
+translation_local bool check_resizable(void) {
+  Arena arena = arena_make(GB(1), ARENA_FLAG_RESIZABLE);
+  bool passed = arena.committed == 0;
+
+  u8 *bytes = arena_alloc(&arena, MB(5), 64);
+  passed &= arena.committed == ALIGN_ROUND_UP(MB(5), ARENA_COMMIT_SIZE);
+  passed &= all_zero(bytes, MB(5));
+
+  arena_clear(&arena);
+  passed &= arena_position(&arena) == 0;
+
+  arena_free(&arena);
+  return passed;
+}
+
+// Benchmark -------------------------------------------------------------------
+
+// Allocate and fill the whole thing, the pattern every nozero caller follows. Returns ms
+translation_local f64 bench_fill(Arena *arena, bool zero) {
+  f64 best = 1e9;
+  for (u32 run = 0; run < TEST_BENCH_RUNS; run++) {
+    u64 start = get_time_ns();
+    u8 *bytes = zero ? arena_alloc(arena, TEST_BENCH_SIZE, 64)
+                     : arena_alloc_nozero(arena, TEST_BENCH_SIZE, 64);
+    memset(bytes, (int)run, TEST_BENCH_SIZE);
+    __asm__ volatile("" : : "g"(bytes) : "memory");
+    best = MIN(best, (f64)(get_time_ns() - start) / 1e6);
+
+    arena_clear(arena);
+  }
+
+  return best;
+}
+
+// Lots of small mixed size allocations, the per call overhead. Returns ns per allocation
+translation_local f64 bench_small(Arena *arena, bool zero) {
+  f64 best = 1e9;
+  for (u32 run = 0; run < TEST_BENCH_RUNS; run++) {
+    u64 start = get_time_ns();
+    for (u32 i = 0; i < TEST_BENCH_SMALL_COUNT; i++) {
+      isize size = 16 + (i & 0xF) * 16;
+      void *ptr = zero ? arena_alloc(arena, size, 16) : arena_alloc_nozero(arena, size, 16);
+      __asm__ volatile("" : : "g"(ptr) : "memory");
+    }
+    best = MIN(best, (f64)(get_time_ns() - start) / TEST_BENCH_SMALL_COUNT);
+
+    arena_clear(arena);
+  }
+
+  return best;
+}
+
+translation_local void bench(void) {
+  Arena arena = arena_make(TEST_BENCH_SIZE + KB(4), ARENA_FLAG_DEFAULTS);
+
+  // Touch it all once so the first run isn't paying for page faults the others don't
+  memset(arena_alloc_nozero(&arena, TEST_BENCH_SIZE, 64), 0, TEST_BENCH_SIZE);
+  arena_clear(&arena);
+
+  printf("  %-26s %6.2f ms\n", "64 MB arena_alloc", bench_fill(&arena, true));
+  printf("  %-26s %6.2f ms\n", "64 MB arena_alloc_nozero", bench_fill(&arena, false));
+  printf("  %-26s %6.2f ns\n", "small arena_alloc", bench_small(&arena, true));
+  printf("  %-26s %6.2f ns\n", "small arena_alloc_nozero", bench_small(&arena, false));
+
+  arena_free(&arena);
+}
+
+int main(int argc, char **argv) {
+  printf("arena_test\n");
+
+  bool passed = report("zeroing", check_zeroing(ARENA_FLAG_DEFAULTS));
+  passed &= report("zeroing resizable", check_zeroing(ARENA_FLAG_RESIZABLE));
+  passed &= report("alignment", check_alignment(ARENA_FLAG_DEFAULTS));
+  passed &= report("alignment resizable", check_alignment(ARENA_FLAG_RESIZABLE));
+  passed &= report("chaining", check_chaining());
+  passed &= report("resizable commit", check_resizable());
+
+  // Timing is slow and noisy, only when asked
+  if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+    bench();
+  }
+
+  printf("%s\n", passed ? "PASSED" : "FAILED");
+  return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
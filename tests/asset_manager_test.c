@@ -0,0 +1,278 @@
+// Checks asset handles through references, frees and reloads, then runs the name index through
+// random inserts, frees and reinserts against a model, since backward shift deletion is easy to
+// break in ways that only show up once clusters wrap or overlap. With --bench, times lookups in
+// the index against the linear scan over the entries it replaced, at 1k and 12k assets
+
+#include "asset/asset_manager.c"
+#include "asset/asset_obj.c"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+enum Test_Constants {
+  TEST_HANDLE_ASSETS = 64,
+  TEST_MODEL_NAMES = 12000, // Index ends up around a third full, long enough clusters to matter
+  TEST_MODEL_STEPS = 300000,
+  TEST_MODEL_CHECK_EVERY = 10000,
+  TEST_NAME_SIZE = 32,
+  TEST_BENCH_LOOKUPS = 100000,
+  TEST_BENCH_RUNS = 9, // Best of
+};
+
+// Nothing here draws, meshes only have to be somewhere to point at
+void rnd_mesh_init(RND_Context *rc, RND_Mesh *mesh, RND_Vertex *vertices, u32 vert_count,
+                   u32 *indices, u32 index_count) {
+  (void)rc, (void)mesh, (void)vertices, (void)vert_count, (void)indices, (void)index_count;
+}
+
+void rnd_mesh_free(RND_Context *rc, RND_Mesh *mesh) { (void)rc, (void)mesh; }
+void rnd_mesh_default_cube(RND_Context *rc, RND_Mesh *mesh) { (void)rc, (void)mesh; }
+
+translation_local u32 rng_state = 12345;
+
+// xorshift32, same sequence every run
+translation_local u32 random_u32(void) {
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 17;
+  rng_state ^= rng_state << 5;
+  return rng_state;
+}
+
+translation_local bool report(const char *name, bool passed) {
+  printf("  %-24s %s\n", name, passed ? "ok" : "FAILED");
+  return passed;
+}
+
+translation_local bool same_handle(ASS_Handle a, ASS_Handle b) {
+  return a.index == b.index && a.generation == b.generation;
+}
+
+translation_local void make_name(char *out, u32 i) {
+  snprintf(out, TEST_NAME_SIZE, "assets/prop_%05u.obj", i);
+}
+
+// Handles ---------------------------------------------------------------------
+
+// Second references keep an asset alive through a free, the last free drops it and moves other
+// entries around, and a reload gets a new handle while the old one stays stale
+translation_local bool check_handles(void) {
+  Arena arena = arena_make(MB(1), ARENA_FLAG_DEFAULTS);
+  ASS_Manager ass = {0};
+  ass_manager_init(&arena, &ass);
+  bool passed = true;
+
+  char names[TEST_HANDLE_ASSETS][TEST_NAME_SIZE];
+  ASS_Handle handles[TEST_HANDLE_ASSETS];
+  RND_Mesh *meshes[TEST_HANDLE_ASSETS];
+  for (u32 i = 0; i < TEST_HANDLE_ASSETS; i++) {
+    make_name(names[i], i);
+    meshes[i] = shared_pool_alloc(&ass.mesh_pool);
+    handles[i] = ass_entry_make_mesh(&ass, names[i], meshes[i]);
+  }
+
+  for (u32 i = 0; i < TEST_HANDLE_ASSETS; i += 2) {
+    passed &= same_handle(ass_entry_reuse(&ass, ass_find_existing(&ass, names[i])), handles[i]);
+  }
+  for (u32 i = 0; i < TEST_HANDLE_ASSETS; i++) {
+    ass_free_entry(&ass, NULL, handles[i]);
+  }
+
+  RND_Mesh *resolved[TEST_HANDLE_ASSETS];
+  ass_resolve_meshes(&ass, handles, TEST_HANDLE_ASSETS, resolved);
+  for (u32 i = 0; i < TEST_HANDLE_ASSETS; i++) {
+    bool kept = i % 2 == 0;
+    passed &= resolved[i] == (kept ? meshes[i] : NULL);
+    passed &= same_handle(ass_find_existing(&ass, names[i]), kept ? handles[i] : POOL_HANDLE_NIL);
+  }
+
+  RND_Mesh *mesh = shared_pool_alloc(&ass.mesh_pool);
+  ASS_Handle fresh = ass_entry_make_mesh(&ass, names[1], mesh);
+  passed &= ass_get(&ass, handles[1]) == NULL && ass_get(&ass, fresh)->mesh_data == mesh;
+  passed &= same_handle(ass_find_existing(&ass, names[1]), fresh);
+
+  // Stale, logs and leaves the reloaded one alone
+  ass_free_entry(&ass, NULL, handles[1]);
+  passed &= ass_get(&ass, fresh) != NULL;
+
+  ass_manager_free(&ass, NULL);
+  arena_free(&arena);
+  return passed;
+}
+
+// Index Model -----------------------------------------------------------------
+
+// Every occupied slot points at a live entry with the same hash and can be reached from its home
+// slot without crossing an empty one, and there are exactly as many as there are entries. A shift
+// that leaves a gap, or pulls something back past its home, breaks one of these
+translation_local bool index_consistent(ASS_Manager *ass) {
+  u32 mask = ASS_INDEX_CAPACITY - 1;
+  u32 occupied = 0;
+  bool passed = true;
+
+  for (u32 slot = 0; slot < ASS_INDEX_CAPACITY; slot++) {
+    ASS_Index_Slot *at = &ass->index[slot];
+    if (at->hash == 0)
+      continue;
+
+    occupied++;
+    ASS_Entry *entry = ass_get(ass, at->entry);
+    passed &= entry != NULL && entry->name_hash == at->hash;
+    for (u32 probe = at->hash & mask; probe != slot; probe = (probe + 1) & mask) {
+      passed &= ass->index[probe].hash != 0;
+    }
+  }
+
+  u32 entry_count = 0;
+  packed_array_as_array(&ass->entries, &entry_count);
+  return passed && occupied == entry_count;
+}
+
+// Names come and go at random, some freed and loaded again straight away, and the index has to
+// keep finding exactly the live ones under their latest handle
+translation_local bool check_index_model(void) {
+  Arena arena = arena_make(MB(1), ARENA_FLAG_DEFAULTS);
+  ASS_Manager ass = {0};
+  ass_manager_init(&arena, &ass);
+  bool passed = true;
+
+  char(*names)[TEST_NAME_SIZE] = malloc(TEST_MODEL_NAMES * TEST_NAME_SIZE);
+  ASS_Handle *handles = calloc(TEST_MODEL_NAMES, sizeof(ASS_Handle));
+  ASS_Handle *stale = calloc(TEST_MODEL_NAMES, sizeof(ASS_Handle));
+  for (u32 i = 0; i < TEST_MODEL_NAMES; i++) {
+    make_name(names[i], i);
+  }
+
+  for (u32 step = 0; step < TEST_MODEL_STEPS; step++) {
+    u32 i = random_u32() % TEST_MODEL_NAMES;
+
+    // Skewed towards loading so the index fills up most of the way before settling
+    if (handles[i].generation == 0) {
+      handles[i] = ass_entry_make_mesh(&ass, names[i], NULL);
+    } else if (random_u32() % 4 != 0) {
+      stale[i] = handles[i];
+      ass_entry_remove(&ass, handles[i]);
+      handles[i] = random_u32() % 2 ? ass_entry_make_mesh(&ass, names[i], NULL) : POOL_HANDLE_NIL;
+    }
+
+    if ((step + 1) % TEST_MODEL_CHECK_EVERY == 0) {
+      passed &= index_consistent(&ass);
+      for (u32 k = 0; k < TEST_MODEL_NAMES; k++) {
+        passed &= same_handle(ass_find_existing(&ass, names[k]), handles[k]);
+        passed &= stale[k].generation == 0 || ass_get(&ass, stale[k]) == NULL;
+      }
+    }
+  }
+
+  passed &= same_handle(ass_find_existing(&ass, "assets/not_loaded.obj"), POOL_HANDLE_NIL);
+
+  free(names);
+  free(handles);
+  free(stale);
+  packed_array_free(&ass.entries);
+  shared_pool_free(&ass.mesh_pool);
+  arena_free(&arena);
+  return passed;
+}
+
+// Benchmark -------------------------------------------------------------------
+
+// What ass_find_existing() did before the index, every entry's name until one matches
+translation_local ASS_Handle linear_find(ASS_Manager *ass, ASS_Handle *handles, u32 count,
+                                         const char *name) {
+  for (u32 i = 0; i < count; i++) {
+    if (strcmp(ass_get(ass, handles[i])->name, name) == 0)
+      return handles[i];
+  }
+
+  return POOL_HANDLE_NIL;
+}
+
+translation_local void bench(void) {
+  u32 counts[] = {1000, TEST_MODEL_NAMES};
+  char(*names)[TEST_NAME_SIZE] = malloc(TEST_MODEL_NAMES * TEST_NAME_SIZE);
+  ASS_Handle *handles = malloc(TEST_MODEL_NAMES * sizeof(ASS_Handle));
+  u32 *lookups = malloc(TEST_BENCH_LOOKUPS * sizeof(u32));
+  for (u32 i = 0; i < TEST_MODEL_NAMES; i++) {
+    make_name(names[i], i);
+  }
+
+  for (u32 c = 0; c < STATIC_ARRAY_COUNT(counts); c++) {
+    u32 count = counts[c];
+    Arena arena = arena_make(MB(1), ARENA_FLAG_DEFAULTS);
+    ASS_Manager ass = {0};
+    ass_manager_init(&arena, &ass);
+    for (u32 i = 0; i < count; i++) {
+      handles[i] = ass_entry_make_mesh(&ass, names[i], NULL);
+    }
+    for (u32 i = 0; i < TEST_BENCH_LOOKUPS; i++) {
+      lookups[i] = random_u32() % count;
+    }
+
+    u64 best[4] = {UINT64_MAX, UINT64_MAX, UINT64_MAX, UINT64_MAX};
+    u32 linear_lookups = TEST_BENCH_LOOKUPS / (count / 100); // It's that slow
+    u32 found = 0;
+    for (u32 run = 0; run < TEST_BENCH_RUNS; run++) {
+      u64 start = get_time_ns();
+      for (u32 i = 0; i < TEST_BENCH_LOOKUPS; i++) {
+        found += ass_find_existing(&ass, names[lookups[i]]).generation != 0;
+      }
+      best[0] = MIN(best[0], get_time_ns() - start);
+
+      // Names that were never loaded, the probe runs to the end of the cluster
+      start = get_time_ns();
+      for (u32 i = 0; i < TEST_BENCH_LOOKUPS; i++) {
+        found += ass_find_existing(&ass, names[lookups[i]] + 1).generation != 0;
+      }
+      best[1] = MIN(best[1], get_time_ns() - start);
+
+      // Free and load again, a remove with its shifts then an insert
+      start = get_time_ns();
+      for (u32 i = 0; i < TEST_BENCH_LOOKUPS; i++) {
+        u32 k = lookups[i];
+        ass_entry_remove(&ass, handles[k]);
+        handles[k] = ass_entry_make_mesh(&ass, names[k], NULL);
+      }
+      best[2] = MIN(best[2], get_time_ns() - start);
+
+      start = get_time_ns();
+      for (u32 i = 0; i < linear_lookups; i++) {
+        found += linear_find(&ass, handles, count, names[lookups[i]]).generation != 0;
+      }
+      best[3] = MIN(best[3], get_time_ns() - start);
+    }
+    __asm__ volatile("" : : "g"(found) : "memory");
+
+    printf("  %5u assets: index hit %5.1f ns, miss %5.1f ns, free + reload %5.1f ns, "
+           "linear scan hit %7.1f ns\n",
+           count, (f64)best[0] / TEST_BENCH_LOOKUPS, (f64)best[1] / TEST_BENCH_LOOKUPS,
+           (f64)best[2] / TEST_BENCH_LOOKUPS, (f64)best[3] / linear_lookups);
+
+    packed_array_free(&ass.entries);
+    shared_pool_free(&ass.mesh_pool);
+    arena_free(&arena);
+  }
+
+  free(names);
+  free(handles);
+  free(lookups);
+}
+
+int main(int argc, char **argv) {
+  Thread_Context tctx;
+  thread_context_init(&tctx, "main");
+  printf("asset_manager_test\n");
+
+  bool passed = report("handles", check_handles());
+  passed &= report("index model check", check_index_model());
+
+  // Timing is slow and noisy, only when asked
+  if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+    bench();
+  }
+
+  thread_context_free();
+
+  printf("%s\n", passed ? "PASSED" : "FAILED");
+  return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
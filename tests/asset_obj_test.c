@@ -0,0 +1,484 @@
+// Checks the .obj parser on small files written out by hand: numbers in every form exporters (and
+// people) write them, CRLF line endings, which corners share a vertex, every face form and
+// malformed lines, always from a buffer with nothing after the last byte. With --bench, parses a
+// generated grid and compares against reading it a line at a time through sscanf like the loader
+// used to
+
+#include "asset/asset_obj.c"
+#include "os/os.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+enum Test_Constants {
+  TEST_LINE_SIZE = 512,
+  TEST_BENCH_GRID = 600, // Quads a side, ~75 MB of text
+  TEST_BENCH_RUNS = 3,   // Best of
+};
+
+translation_local u32 rng_state = 12345;
+
+// xorshift32, same sequence every run
+translation_local u32 random_u32(void) {
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 17;
+  rng_state ^= rng_state << 5;
+  return rng_state;
+}
+
+translation_local bool report(const char *name, bool passed) {
+  printf("  %-24s %s\n", name, passed ? "ok" : "FAILED");
+  return passed;
+}
+
+// Copied out to exactly its length, so reading past the end is something ASan will catch
+translation_local ASS_OBJ_Mesh parse(Arena *arena, const char *text) {
+  isize size = strlen(text);
+  u8 *data = malloc(MAX(size, 1));
+  memcpy(data, text, size);
+
+  ASS_OBJ_Mesh mesh = ass_obj_parse(arena, data, size, "test.obj");
+  free(data);
+  return mesh;
+}
+
+translation_local bool same_f32(f32 a, f32 b) {
+  return (isnan(a) && isnan(b)) || memcmp(&a, &b, sizeof(f32)) == 0;
+}
+
+translation_local bool same_vec3(vec3 a, vec3 b) {
+  return same_f32(a.x, b.x) && same_f32(a.y, b.y) && same_f32(a.z, b.z);
+}
+
+// Numbers ---------------------------------------------------------------------
+
+// Has to round to the same float strtod does, whichever path the scanner takes
+translation_local bool check_numbers(Arena *arena) {
+  const char *numbers[] = {
+      "0", "-0", "1", "-2.5", "+3", ".5", "-.5", "5.", "0.1", "1e3", "1E-3", "2.5e+2", "-7e-0",
+      "0.30000000000000004",
+      "3.14159265358979323846264338327950288", // More digits than a u64 holds
+      "123456789012345678901234567890",
+      "0.000000000000000000000000000001234",
+      "12345678901234567890123e-10",
+      "340282346638528859811704183484516925440", // FLT_MAX
+      "3.4028235e38", "1e-30", "1e30", "1e39", "1e-50", "1.4e-45", "1e-10000", "1e10000",
+      "inf", "-inf", "+INF", "infinity", "nan", "-nan", "NaN",
+  };
+
+  bool passed = true;
+  for (u32 i = 0; i < STATIC_ARRAY_COUNT(numbers); i++) {
+    char text[TEST_LINE_SIZE];
+    snprintf(text, sizeof(text), "v %s 1 2\nv 0 0 0\nv 1 0 0\nf 1 2 3\n", numbers[i]);
+    ASS_OBJ_Mesh mesh = parse(arena, text);
+
+    f32 expected = (f32)strtod(numbers[i], NULL);
+    bool ok = mesh.error_count == 0 && mesh.vertex_count == 3 &&
+              same_vec3(mesh.vertices[0].position, vec3(expected, 1, 2));
+    if (!ok) {
+      printf("  %s parsed as %g, expected %g\n", numbers[i],
+             mesh.vertex_count > 0 ? mesh.vertices[0].position.x : 0.0f, expected);
+    }
+    passed &= ok;
+  }
+
+  // Every one of these gets the line skipped, so the face after picks up the next position
+  const char *malformed[] = {
+      "", "-", "+", ".", "-.", "e5", "1e", "1e+", "1.2.3", "1x", "--1", "1,5", "0x10", "1.5f",
+      "1e5e5", "nanx", "in",
+  };
+  for (u32 i = 0; i < STATIC_ARRAY_COUNT(malformed); i++) {
+    char text[TEST_LINE_SIZE];
+    snprintf(text, sizeof(text), "v 1 %s 2\nv 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3\n", malformed[i]);
+    ASS_OBJ_Mesh mesh = parse(arena, text);
+
+    bool ok = mesh.error_count == 1 && mesh.vertex_count == 3 &&
+              same_vec3(mesh.vertices[0].position, vec3(0, 0, 0));
+    if (!ok) {
+      printf("  \"%s\" wasn't rejected\n", malformed[i]);
+    }
+    passed &= ok;
+  }
+
+  return passed;
+}
+
+// Files -----------------------------------------------------------------------
+
+// One triangle, every corner pointing somewhere different, with whatever line ending is asked for
+// and no newline after the last line
+translation_local bool check_triangle(Arena *arena, const char *newline) {
+  const char *lines[] = {
+      "v 0 0 0", "v 1 0 0", "v 0 1 0", "vt 0 0", "vt 1 0", "vt 0 1",
+      "vn 0 0 1", "vn 0 1 0", "vn 1 0 0", "f 1/1/1 2/2/2 3/3/3",
+  };
+
+  char text[TEST_LINE_SIZE] = {0};
+  for (u32 i = 0; i < STATIC_ARRAY_COUNT(lines); i++) {
+    strcat(text, lines[i]);
+    if (i + 1 < STATIC_ARRAY_COUNT(lines)) {
+      strcat(text, newline);
+    }
+  }
+  ASS_OBJ_Mesh mesh = parse(arena, text);
+
+  bool passed = mesh.error_count == 0 && mesh.vertex_count == 3 && mesh.index_count == 3;
+  vec3 positions[] = {vec3(0, 0, 0), vec3(1, 0, 0), vec3(0, 1, 0)};
+  vec2 uvs[] = {vec2(0, 0), vec2(1, 0), vec2(0, 1)};
+  vec3 normals[] = {vec3(0, 0, 1), vec3(0, 1, 0), vec3(1, 0, 0)};
+  for (u32 i = 0; passed && i < 3; i++) {
+    RND_Vertex *vertex = &mesh.vertices[mesh.indices[i]];
+    passed &= same_vec3(vertex->position, positions[i]) && same_vec3(vertex->normal, normals[i]);
+    passed &= same_f32(vertex->uv.x, uvs[i].x) && same_f32(vertex->uv.y, uvs[i].y);
+  }
+
+  return passed;
+}
+
+// Blank lines, odd spacing, lines we don't read and nothing at all
+translation_local bool check_layout(Arena *arena) {
+  ASS_OBJ_Mesh mesh = parse(arena, "# exported\n\n  o thing\n\tv  1\t2   3  \ng all\nv 4 5 6\n"
+                                   "mtllib a.mtl\nusemtl red\ns off\nv 7 8 9\n\n\nf 1 2 3\n\n");
+  bool passed = mesh.error_count == 0 && mesh.vertex_count == 3 && mesh.index_count == 3;
+  passed &= passed && same_vec3(mesh.vertices[0].position, vec3(1, 2, 3));
+
+  // Keywords only count with a blank after them
+  mesh = parse(arena, "v 0 0 0\nv 1 0 0\nv 0 1 0\nvx 1 2 3\nfo 1 2 3\nv1 2 3\nf 1 2 3\n");
+  passed &= mesh.error_count == 0 && mesh.vertex_count == 3 && mesh.index_count == 3;
+
+  // Out of range indices drop the face, the rest still loads
+  mesh = parse(arena, "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 4\nf 1 2 3\nf 3/1/1 2/1/1 1/1/1\n");
+  passed &= mesh.error_count == 2 && mesh.index_count == 3;
+
+  mesh = parse(arena, "");
+  passed &= mesh.error_count == 0 && mesh.vertex_count == 0 && mesh.index_count == 0;
+
+  mesh = parse(arena, "v 1 2");
+  passed &= mesh.error_count == 1 && mesh.vertex_count == 0;
+
+  return passed;
+}
+
+// Vertices --------------------------------------------------------------------
+
+// A corner is its position, uv and normal together, sharing only the position isn't enough
+translation_local bool check_shared_corners(Arena *arena) {
+  // Two triangles on one edge, smooth, with a hard edge, with a uv seam, then the same one twice
+  const char *positions = "v 0 0 0\nv 1 0 0\nv 0 1 0\nv 1 1 0\nvt 0 0\nvt 1 1\n"
+                          "vn 0 0 1\nvn 0 1 0\n";
+  struct {
+    const char *faces;
+    u32 vertex_count;
+  } cases[] = {
+      {"f 1/1/1 2/1/1 3/1/1\nf 2/1/1 4/1/1 3/1/1\n", 4},
+      {"f 1/1/1 2/1/1 3/1/1\nf 2/1/2 4/1/2 3/1/2\n", 6},
+      {"f 1/1/1 2/1/1 3/1/1\nf 2/2/1 4/2/1 3/1/1\n", 5},
+      {"f 1/1/1 2/1/1 3/1/1\nf 1/1/1 2/1/1 3/1/1\n", 3},
+  };
+
+  bool passed = true;
+  for (u32 i = 0; i < STATIC_ARRAY_COUNT(cases); i++) {
+    char text[TEST_LINE_SIZE];
+    snprintf(text, sizeof(text), "%s%s", positions, cases[i].faces);
+    ASS_OBJ_Mesh mesh = parse(arena, text);
+    passed &= mesh.error_count == 0 && mesh.index_count == 6;
+    passed &= mesh.vertex_count == cases[i].vertex_count;
+  }
+
+  // Positions no face uses don't become vertices
+  ASS_OBJ_Mesh mesh = parse(arena, "v 9 9 9\nv 0 0 0\nv 1 0 0\nv 0 1 0\nv 8 8 8\nvt 0 0\n"
+                                   "vn 0 0 1\nf 2/1/1 3/1/1 4/1/1\n");
+  passed &= mesh.vertex_count == 3 && same_vec3(mesh.vertices[0].position, vec3(0, 0, 0));
+
+  return passed;
+}
+
+// Random faces over a few positions, uvs and normals, enough distinct corners that the table has
+// to grow a few times. Every value is unique so a vertex's contents say which corner it was made
+// for, then each corner has to land on a vertex made for it and no corner gets two
+translation_local bool check_corner_table(Arena *arena) {
+  enum { POSITIONS = 60, UVS = 20, NORMALS = 20, FACES = 6000 };
+  isize capacity = (POSITIONS + UVS + NORMALS + FACES) * 64;
+  char *text = malloc(capacity);
+  isize size = 0;
+
+  for (u32 i = 0; i < POSITIONS; i++) {
+    size += snprintf(text + size, capacity - size, "v %u 0.5 -%u\n", i, i);
+  }
+  for (u32 i = 0; i < UVS; i++) {
+    size += snprintf(text + size, capacity - size, "vt 0.25 %u\n", 100 + i);
+  }
+  for (u32 i = 0; i < NORMALS; i++) {
+    size += snprintf(text + size, capacity - size, "vn 0 %u 1\n", 1000 + i);
+  }
+
+  u8 *seen = calloc(POSITIONS * UVS * NORMALS, 1);
+  u32 *corners = malloc(FACES * 3 * sizeof(u32));
+  u32 distinct = 0;
+  for (u32 f = 0; f < FACES; f++) {
+    size += snprintf(text + size, capacity - size, "f");
+    for (u32 c = 0; c < 3; c++) {
+      u32 v = random_u32() % POSITIONS, vt = random_u32() % UVS, vn = random_u32() % NORMALS;
+      u32 corner = (v * UVS + vt) * NORMALS + vn;
+      distinct += !seen[corner];
+      seen[corner] = 1;
+      corners[f * 3 + c] = corner;
+      size += snprintf(text + size, capacity - size, " %u/%u/%u", v + 1, vt + 1, vn + 1);
+    }
+    size += snprintf(text + size, capacity - size, "\n");
+  }
+
+  ASS_OBJ_Mesh mesh = ass_obj_parse(arena, (const u8 *)text, size, "table.obj");
+  bool passed = mesh.error_count == 0 && mesh.index_count == FACES * 3;
+  passed &= mesh.vertex_count == distinct;
+
+  for (u32 i = 0; passed && i < mesh.index_count; i++) {
+    u32 corner = corners[i];
+    u32 v = corner / (UVS * NORMALS), vt = corner / NORMALS % UVS, vn = corner % NORMALS;
+    RND_Vertex *vertex = &mesh.vertices[mesh.indices[i]];
+    passed &= same_vec3(vertex->position, vec3((f32)v, 0.5f, -(f32)v));
+    passed &= same_f32(vertex->uv.x, 0.25f) && same_f32(vertex->uv.y, (f32)(100 + vt));
+    passed &= same_vec3(vertex->normal, vec3(0, (f32)(1000 + vn), 1));
+  }
+
+  free(text);
+  free(seen);
+  free(corners);
+  return passed;
+}
+
+// Faces -----------------------------------------------------------------------
+
+translation_local bool same_mesh(ASS_OBJ_Mesh a, ASS_OBJ_Mesh b) {
+  return a.error_count == 0 && b.error_count == 0 && a.vertex_count == b.vertex_count &&
+         a.index_count == b.index_count &&
+         memcmp(a.vertices, b.vertices, a.vertex_count * sizeof(RND_Vertex)) == 0 &&
+         memcmp(a.indices, b.indices, a.index_count * sizeof(u32)) == 0;
+}
+
+// Every generated normal should face the way the winding does, +z for these
+translation_local bool normals_face_z(ASS_OBJ_Mesh mesh) {
+  bool passed = mesh.vertex_count > 0;
+  for (u32 i = 0; i < mesh.vertex_count; i++) {
+    vec3 normal = mesh.vertices[i].normal;
+    passed &= normal.x == 0.0f && normal.y == 0.0f && normal.z > 0.0f;
+  }
+
+  return passed;
+}
+
+// n-gons fan out from their first corner, and any corner form or index direction gives the same
+// mesh as writing it out in full
+translation_local bool check_faces(Arena *arena) {
+  const char *pentagon = "v 0 0 0\nv 1 0 0\nv 2 1 0\nv 1 2 0\nv 0 1 0\nvt 0 0\nvt 1 1\n";
+
+  ASS_OBJ_Mesh mesh = parse(arena, "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nf 1 2 3 4\n");
+  u32 quad[] = {0, 1, 2, 0, 2, 3};
+  bool passed = mesh.error_count == 0 && mesh.vertex_count == 4 && mesh.index_count == 6;
+  passed &= passed && memcmp(mesh.indices, quad, sizeof(quad)) == 0 && normals_face_z(mesh);
+
+  char text[TEST_LINE_SIZE];
+  snprintf(text, sizeof(text), "%sf 1/1 2/2 3/1 4/2 5/1\n", pentagon);
+  ASS_OBJ_Mesh expected = parse(arena, text);
+  passed &= expected.index_count == 9 && normals_face_z(expected);
+  passed &= same_f32(expected.vertices[1].uv.x, 1.0f) && same_f32(expected.vertices[1].uv.y, 1.0f);
+
+  snprintf(text, sizeof(text), "%sf -5/-2 -4/-1 -3/-2 -2/-1 -1/-2\n", pentagon);
+  passed &= same_mesh(expected, parse(arena, text));
+
+  // Negative indices count back from wherever the face is, not the end of the file
+  mesh = parse(arena, "v 0 0 0\nv 1 0 0\nv 0 1 0\nf -3 -2 -1\nv 5 0 0\nv 6 0 0\nv 5 1 0\n"
+                      "f -3 -2 -1\n");
+  passed &= mesh.error_count == 0 && mesh.vertex_count == 6;
+  passed &= passed && same_vec3(mesh.vertices[3].position, vec3(5, 0, 0));
+
+  // Normals from the file are used as they are, uvs left out are zero
+  mesh = parse(arena, "v 0 0 0\nv 1 0 0\nv 0 1 0\nvn 0 1 0\nf 1//1 2//1 3//1\n");
+  passed &= mesh.error_count == 0 && mesh.vertex_count == 3;
+  for (u32 i = 0; passed && i < 3; i++) {
+    passed &= same_vec3(mesh.vertices[i].normal, vec3(0, 1, 0));
+    passed &= same_f32(mesh.vertices[i].uv.x, 0.0f) && same_f32(mesh.vertices[i].uv.y, 0.0f);
+  }
+
+  // Forms can change from corner to corner
+  mesh = parse(arena, "v 0 0 0\nv 1 0 0\nv 0 1 0\nvt 0 0\nvn 0 0 1\nf 1 2/1 3//1\nf 1/1/1 2 3\n");
+  passed &= mesh.error_count == 0 && mesh.index_count == 6;
+
+  return passed;
+}
+
+// Each of these is skipped on its own without leaving part of the face behind, then the one good
+// face still loads
+translation_local bool check_malformed_faces(Arena *arena) {
+  const char *faces[] = {
+      "f", "f 1", "f 1 2", "f 1 2 0", "f 1 2 5", "f 1 -5 2", "f 1 2 -0", "f 1/ 2 3", "f 1/1 2 3",
+      "f 1//x 2 3", "f 1//1 2 3", "f 1///1 2 3", "f 1 2 3x", "f 1 2 3/", "f 1 2 3 4 x",
+      "f 1 2 3 99999999999999999999", "f 1 2 3 -99999999999999999999", "f +1 2 3", "f 1.0 2 3",
+      "f # 1 2 3", "f 1 2 # 3",
+  };
+
+  char text[TEST_LINE_SIZE * 2] = "v 0 0 0\nv 1 0 0\nv 0 1 0\nv 1 1 0\n";
+  for (u32 i = 0; i < STATIC_ARRAY_COUNT(faces); i++) {
+    strcat(text, faces[i]);
+    strcat(text, "\n");
+  }
+  strcat(text, "f 1 2 3\n");
+
+  ASS_OBJ_Mesh mesh = parse(arena, text);
+  return mesh.error_count == STATIC_ARRAY_COUNT(faces) && mesh.vertex_count == 3 &&
+         mesh.index_count == 3;
+}
+
+// A '#' ends a line wherever it starts, attached to the last token or not
+translation_local bool check_comments(Arena *arena) {
+  ASS_OBJ_Mesh mesh = parse(arena, "# header\nv 0 0 0 # a\nv 1 0 0#b\nv 0 1 0\t# c\nvt 0 0#\n"
+                                   "vn 0 0 1 # n\nf 1 2 3 # c\nf 1//1 2//1 3//1# d\nf 1 2 3#\n"
+                                   "#f 1 2 3\n  # indented\n");
+  bool passed = mesh.error_count == 0 && mesh.index_count == 9;
+
+  // Nothing but comments is an empty mesh, not an error, the loader swaps in the default cube
+  mesh = parse(arena, "# just\n# comments\n#");
+  passed &= mesh.error_count == 0 && mesh.vertex_count == 0 && mesh.index_count == 0;
+
+  return passed;
+}
+
+// Benchmark -------------------------------------------------------------------
+
+// Smooth grid, every corner's position, uv and normal share an index like most exporters write
+translation_local char *make_grid(u32 quads, isize *out_size) {
+  u32 side = quads + 1;
+  isize capacity = (isize)side * side * 120 + (isize)quads * quads * 120;
+  char *text = malloc(capacity);
+  isize size = 0;
+
+  for (u32 y = 0; y < side; y++) {
+    for (u32 x = 0; x < side; x++) {
+      f32 height = sinf(x * 0.1f) * cosf(y * 0.1f);
+      size += snprintf(text + size, capacity - size, "v %f %f %f\nvt %f %f\nvn %f %f %f\n",
+                       x * 0.5f, height, y * 0.5f, (f32)x / quads, (f32)y / quads, 0.0f, 1.0f,
+                       0.0f);
+    }
+  }
+
+  for (u32 y = 0; y < quads; y++) {
+    for (u32 x = 0; x < quads; x++) {
+      u32 a = y * side + x + 1, b = a + 1, c = a + side, d = c + 1;
+      size += snprintf(text + size, capacity - size,
+                       "f %u/%u/%u %u/%u/%u %u/%u/%u\nf %u/%u/%u %u/%u/%u %u/%u/%u\n", a, a, a, c,
+                       c, c, b, b, b, b, b, b, c, c, c, d, d, d);
+    }
+  }
+
+  *out_size = size;
+  return text;
+}
+
+// Roughly what the loader did before, a line at a time into a buffer then sscanf on it
+translation_local u32 sscanf_parse(const char *text, isize size) {
+  u32 line_count = 0;
+  for (const char *at = text; (at = memchr(at, '\n', text + size - at)) != NULL; at++) {
+    line_count++;
+  }
+
+  vec3 *positions = malloc(line_count * sizeof(vec3));
+  vec2 *uvs = malloc(line_count * sizeof(vec2));
+  vec3 *normals = malloc(line_count * sizeof(vec3));
+  u32 *indices = malloc(line_count * 3 * sizeof(u32));
+  u32 position_count = 0, uv_count = 0, normal_count = 0, index_count = 0;
+
+  char line[TEST_LINE_SIZE];
+  for (const char *at = text, *end = text + size; at < end;) {
+    const char *newline = memchr(at, '\n', end - at);
+    isize length = MIN((newline != NULL ? newline : end) - at, TEST_LINE_SIZE - 1);
+    memcpy(line, at, length);
+    line[length] = '\0';
+    at = newline != NULL ? newline + 1 : end;
+
+    if (line[0] == 'v' && line[1] == ' ') {
+      vec3 *p = &positions[position_count++];
+      sscanf(line, "v %f %f %f", &p->x, &p->y, &p->z);
+    } else if (line[0] == 'v' && line[1] == 't') {
+      vec2 *uv = &uvs[uv_count++];
+      sscanf(line, "vt %f %f", &uv->x, &uv->y);
+    } else if (line[0] == 'v' && line[1] == 'n') {
+      vec3 *n = &normals[normal_count++];
+      sscanf(line, "vn %f %f %f", &n->x, &n->y, &n->z);
+    } else if (line[0] == 'f' && line[1] == ' ') {
+      u32 v[3], vt[3], vn[3];
+      sscanf(line, "f %u/%u/%u %u/%u/%u %u/%u/%u", &v[0], &vt[0], &vn[0], &v[1], &vt[1], &vn[1],
+             &v[2], &vt[2], &vn[2]);
+      for (u32 i = 0; i < 3; i++) {
+        indices[index_count++] = v[i] - 1;
+      }
+    }
+  }
+  __asm__ volatile("" : : "g"(positions), "g"(uvs), "g"(normals) : "memory");
+
+  free(positions);
+  free(uvs);
+  free(normals);
+  free(indices);
+  return index_count;
+}
+
+translation_local void bench(void) {
+  isize size = 0;
+  char *text = make_grid(TEST_BENCH_GRID, &size);
+  f64 megabytes = (f64)size / 1e6;
+
+  u64 best[2] = {UINT64_MAX, UINT64_MAX};
+  u32 index_counts[2] = {0};
+  for (u32 run = 0; run < TEST_BENCH_RUNS; run++) {
+    u64 start = get_time_ns();
+    index_counts[0] = sscanf_parse(text, size);
+    best[0] = MIN(best[0], get_time_ns() - start);
+
+    Arena arena = arena_make(GB(1), ARENA_FLAG_RESIZABLE | ARENA_FLAG_CHAINABLE);
+    start = get_time_ns();
+    index_counts[1] = ass_obj_parse(&arena, (const u8 *)text, size, "grid.obj").index_count;
+    best[1] = MIN(best[1], get_time_ns() - start);
+    arena_free(&arena);
+  }
+
+  printf("  %.1f MB grid, %u triangles\n", megabytes, index_counts[1] / 3);
+  printf("  %-16s %7.1f ms %7.1f MB/s\n", "sscanf per line", best[0] / 1e6,
+         megabytes / (best[0] / 1e9));
+  printf("  %-16s %7.1f ms %7.1f MB/s (%.2fx)\n", "ass_obj_parse", best[1] / 1e6,
+         megabytes / (best[1] / 1e9), (f64)best[0] / best[1]);
+  if (index_counts[0] != index_counts[1]) {
+    printf("  triangle counts differ, %u against %u\n", index_counts[0] / 3, index_counts[1] / 3);
+  }
+
+  free(text);
+}
+
+int main(int argc, char **argv) {
+  Thread_Context tctx;
+  thread_context_init(&tctx, "main");
+  printf("asset_obj_test\n");
+
+  Arena arena = arena_make(MB(64), ARENA_FLAG_RESIZABLE | ARENA_FLAG_CHAINABLE);
+  bool passed = report("numbers", check_numbers(&arena));
+  passed &= report("triangle, LF", check_triangle(&arena, "\n"));
+  passed &= report("triangle, CRLF", check_triangle(&arena, "\r\n"));
+  passed &= report("layout", check_layout(&arena));
+  passed &= report("shared corners", check_shared_corners(&arena));
+  passed &= report("corner table", check_corner_table(&arena));
+  passed &= report("faces", check_faces(&arena));
+  passed &= report("malformed faces", check_malformed_faces(&arena));
+  passed &= report("comments", check_comments(&arena));
+  arena_free(&arena);
+
+  // Timing is slow and noisy, only when asked
+  if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+    bench();
+  }
+
+  thread_context_free();
+
+  printf("%s\n", passed ? "PASSED" : "FAILED");
+  return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,620 @@
+// Runs the ECS against a plain array model through spawns, despawns, adds and removes, direct and
+// through command buffers, checking every component came along through moves and swap removes.
+// Then the entity hierarchy, a fixed chain and random reparenting and freeing against a model of
+// the parents. With --bench, times the structural operations and a levelled transform update
+
+#include "core/ecs.h"
+#include "core/thread_context.h"
+#include "game/entity.c"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+enum Test_Constants {
+  TEST_MODEL_ENTITIES = 20000,
+  TEST_MODEL_STEPS = 400000,
+  TEST_MODEL_CHECK_EVERY = 20000,
+  TEST_HIERARCHY_ENTITIES = 512,
+  TEST_HIERARCHY_STEPS = 8000,
+  TEST_HIERARCHY_CHECK_EVERY = 100,
+  TEST_BENCH_ENTITIES = 100000,
+  TEST_BENCH_CHILDREN = 10000, // Of the above, spread over a few levels
+  TEST_BENCH_RUNS = 15,        // Best of
+};
+
+// entity.c loads meshes through the asset manager, nothing here draws so there's nothing to load
+ASS_Handle ass_load_mesh_obj(ASS_Manager *asset_manager, RND_Context *render_context,
+                             char *file_name) {
+  (void)asset_manager, (void)render_context, (void)file_name;
+  return POOL_HANDLE_NIL;
+}
+
+void ass_free_entry(ASS_Manager *manager, RND_Context *render_context, ASS_Handle handle) {
+  (void)manager, (void)render_context, (void)handle;
+}
+
+translation_local u32 rng_state = 12345;
+
+// xorshift32, same sequence every run
+translation_local u32 random_u32(void) {
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 17;
+  rng_state ^= rng_state << 5;
+  return rng_state;
+}
+
+translation_local bool report(const char *name, bool passed) {
+  printf("  %-24s %s\n", name, passed ? "ok" : "FAILED");
+  return passed;
+}
+
+translation_local bool same_entity(ECS_Entity a, ECS_Entity b) {
+  return a.index == b.index && a.generation == b.generation;
+}
+
+// Model Check -----------------------------------------------------------------
+
+// Different sizes so the archetypes have different chunk capacities, the big one only fits a few
+// dozen to a chunk so moves and swap removes cross chunks all the time. Each holds its entity's tag
+typedef struct Test_Small Test_Small;
+struct Test_Small {
+  u32 tag;
+};
+
+typedef struct Test_Medium Test_Medium;
+struct Test_Medium {
+  f32 padding[5];
+  u64 tag;
+};
+
+typedef struct Test_Large Test_Large;
+struct Test_Large {
+  alignas(64) u64 tag;
+  u8 padding[440];
+};
+
+enum { TEST_COMPONENT_COUNT = 3 };
+
+typedef struct Test_Model Test_Model;
+struct Test_Model {
+  ECS_World world;
+  ECS_Commands commands;
+  ECS_Component components[TEST_COMPONENT_COUNT];
+
+  // Mask bits here are 1 << i for components[i], not the world's
+  ECS_Entity entities[TEST_MODEL_ENTITIES];
+  u32 masks[TEST_MODEL_ENTITIES];
+  u32 tags[TEST_MODEL_ENTITIES];
+  bool alive[TEST_MODEL_ENTITIES];
+};
+
+translation_local ECS_Mask model_world_mask(Test_Model *model, u32 mask) {
+  ECS_Mask world_mask = 0;
+  for (u32 c = 0; c < TEST_COMPONENT_COUNT; c++) {
+    if (mask & (1u << c)) {
+      world_mask |= ECS_BIT(model->components[c]);
+    }
+  }
+
+  return world_mask;
+}
+
+translation_local u64 component_tag(u32 c, void *component) {
+  switch (c) {
+  case 0:
+    return ((Test_Small *)component)->tag;
+  case 1:
+    return ((Test_Medium *)component)->tag;
+  default:
+    return ((Test_Large *)component)->tag;
+  }
+}
+
+// Big enough for any of them, tag in the right spot for component c
+translation_local void component_make(u32 c, u32 tag, Test_Large *out) {
+  memset(out, 0, sizeof(*out));
+  switch (c) {
+  case 0:
+    ((Test_Small *)out)->tag = tag;
+    break;
+  case 1:
+    ((Test_Medium *)out)->tag = tag;
+    break;
+  default:
+    out->tag = tag;
+    break;
+  }
+}
+
+translation_local void model_spawn(Test_Model *model, u32 i) {
+  model->masks[i] = random_u32() % (1u << TEST_COMPONENT_COUNT);
+  model->tags[i] = random_u32();
+  model->alive[i] = true;
+  model->entities[i] = ecs_spawn(&model->world, model_world_mask(model, model->masks[i]));
+
+  for (u32 c = 0; c < TEST_COMPONENT_COUNT; c++) {
+    if (model->masks[i] & (1u << c)) {
+      Test_Large data;
+      component_make(c, model->tags[i], &data);
+      memcpy(ecs_get(&model->world, model->entities[i], model->components[c]), &data,
+             model->world.components[model->components[c]].size);
+    }
+  }
+}
+
+// One random operation on an entity that's alive, half of them through the command buffer
+translation_local bool model_step(Test_Model *model, u32 i) {
+  ECS_World *world = &model->world;
+  ECS_Entity entity = model->entities[i];
+  bool deferred = random_u32() % 2;
+  u32 c = random_u32() % TEST_COMPONENT_COUNT;
+  ECS_Component component = model->components[c];
+
+  switch (random_u32() % 3) {
+  case 0: {
+    if (deferred) {
+      ecs_commands_despawn(&model->commands, entity);
+      ecs_commands_flush(&model->commands, world);
+    } else {
+      ecs_despawn(world, entity);
+    }
+    model->alive[i] = false;
+
+    // Stale handles don't resolve, even once the index gets handed out again
+    return !ecs_alive(world, entity) && ecs_get(world, entity, component) == NULL;
+  }
+  case 1: {
+    bool had = model->masks[i] & (1u << c);
+    if (deferred) {
+      Test_Large data;
+      component_make(c, model->tags[i], &data);
+      ecs_commands_add(&model->commands, entity, component, &data,
+                       world->components[component].size);
+      ecs_commands_flush(&model->commands, world);
+    } else {
+      // New ones come zeroed, ones already there are left alone
+      void *added = ecs_add(world, entity, component);
+      if (component_tag(c, added) != (had ? model->tags[i] : 0))
+        return false;
+
+      Test_Large data;
+      component_make(c, model->tags[i], &data);
+      memcpy(added, &data, world->components[component].size);
+    }
+    model->masks[i] |= 1u << c;
+  } break;
+  case 2: {
+    if (deferred) {
+      ecs_commands_remove(&model->commands, entity, component);
+      ecs_commands_flush(&model->commands, world);
+    } else {
+      ecs_remove(world, entity, component);
+    }
+    model->masks[i] &= ~(1u << c);
+  } break;
+  }
+
+  return true;
+}
+
+// What the query finds adds up, and every row found is where the records say its entity is, so a
+// swap that forgot to fix up the moved entity's record gets caught
+translation_local bool query_matches(ECS_World *world, Test_Model *model, ECS_Query query,
+                                     u32 expected) {
+  bool passed = true;
+  u32 seen = 0;
+  ECS_Iter it = ecs_query_iter(world, query);
+  while (ecs_iter_next(&it)) {
+    ECS_Entity *entities = ecs_chunk_entities(it.chunk);
+    passed &= it.chunk->count > 0 && it.chunk->count <= it.chunk->archetype->chunk_capacity;
+    for (u32 row = 0; row < it.chunk->count; row++) {
+      for (u32 c = 0; c < TEST_COMPONENT_COUNT; c++) {
+        if (ecs_chunk_has(it.chunk, model->components[c])) {
+          u8 *column = ecs_chunk_column(it.chunk, model->components[c]);
+          passed &= ecs_get(world, entities[row], model->components[c]) ==
+                    column + row * world->components[model->components[c]].size;
+        }
+      }
+    }
+    seen += it.chunk->count;
+  }
+
+  return passed && seen == expected && ecs_query_count(world, query) == expected;
+}
+
+// Every entity's mask and tags, then every query against the model
+translation_local bool model_matches(Test_Model *model) {
+  ECS_World *world = &model->world;
+  bool passed = true;
+
+  u32 alive_count = 0;
+  for (u32 i = 0; i < TEST_MODEL_ENTITIES; i++) {
+    if (!model->alive[i])
+      continue;
+
+    alive_count++;
+    passed &= ecs_mask_of(world, model->entities[i]) == model_world_mask(model, model->masks[i]);
+    for (u32 c = 0; c < TEST_COMPONENT_COUNT; c++) {
+      void *component = ecs_get(world, model->entities[i], model->components[c]);
+      if (model->masks[i] & (1u << c)) {
+        passed &= component != NULL && component_tag(c, component) == model->tags[i];
+      } else {
+        passed &= component == NULL;
+      }
+    }
+  }
+
+  // Every query there is over these components, what it finds is exactly what the model says
+  u32 full = (1u << TEST_COMPONENT_COUNT) - 1;
+  for (u32 all = 0; all <= full; all++) {
+    for (u32 none = 0; none <= full; none++) {
+      if (all & none)
+        continue;
+
+      ECS_Query query = {
+          .all = model_world_mask(model, all),
+          .none = model_world_mask(model, none),
+      };
+
+      u32 expected = 0;
+      for (u32 i = 0; i < TEST_MODEL_ENTITIES; i++) {
+        expected += model->alive[i] && (model->masks[i] & all) == all && !(model->masks[i] & none);
+      }
+      passed &= query_matches(world, model, query, expected);
+    }
+  }
+
+
+  passed &= ecs_query_count(world, (ECS_Query){0}) == alive_count;
+  return passed;
+}
+
+translation_local bool check_model(void) {
+  Test_Model *model = calloc(1, sizeof(Test_Model));
+  model->world = ecs_world_make();
+  model->commands = ecs_commands_make();
+  model->components[0] = ecs_component_register_type(&model->world, Test_Small);
+  model->components[1] = ecs_component_register_type(&model->world, Test_Medium);
+  model->components[2] = ecs_component_register_type(&model->world, Test_Large);
+
+  bool passed = true;
+  for (u32 step = 0; step < TEST_MODEL_STEPS; step++) {
+    u32 i = random_u32() % TEST_MODEL_ENTITIES;
+    if (model->alive[i]) {
+      passed &= model_step(model, i);
+    } else {
+      model_spawn(model, i);
+    }
+
+    if ((step + 1) % TEST_MODEL_CHECK_EVERY == 0) {
+      passed &= model_matches(model);
+    }
+  }
+
+  // Everything gone means every chunk went back to the pool
+  for (u32 i = 0; i < TEST_MODEL_ENTITIES; i++) {
+    if (model->alive[i]) {
+      ecs_despawn(&model->world, model->entities[i]);
+    }
+  }
+  passed &= model->world.chunks.live_count == 0;
+
+  ecs_commands_free(&model->commands);
+  ecs_world_free(&model->world);
+  free(model);
+  return passed;
+}
+
+// Hierarchy -------------------------------------------------------------------
+
+translation_local void update_levels(Entity_Pool *ep, Arena *arena) {
+  u32 level_count = entity_pool_level_count(ep);
+  for (u32 depth = 0; depth < level_count; depth++) {
+    u32 chunk_count = 0;
+    ECS_Chunk **chunks =
+        ecs_query_chunks(&ep->world, entity_query_level(ep, depth), arena, &chunk_count);
+    for (u32 c = 0; c < chunk_count; c++) {
+      entity_update_transforms(ep, chunks[c]);
+    }
+  }
+
+  arena_clear(arena);
+}
+
+translation_local Transform_Matrices *matrices_of(Entity_Pool *ep, Entity_Handle entity) {
+  return ecs_get_type(&ep->world, entity, ep->components.matrices, Transform_Matrices);
+}
+
+// a (scaled by 2) <- b <- c, each a unit step along a different axis
+translation_local bool check_chain(void) {
+  Entity_Pool ep = entity_pool_make();
+  Arena arena = arena_make(MB(1), ARENA_FLAG_DEFAULTS);
+
+  Entity_Handle a =
+      entity_make(&ep, NULL, NULL, vec3(1, 0, 0), quat_identity(), vec3(2, 2, 2), NULL);
+  Entity_Handle b =
+      entity_make(&ep, NULL, NULL, vec3(0, 1, 0), quat_identity(), vec3(1, 1, 1), NULL);
+  Entity_Handle c =
+      entity_make(&ep, NULL, NULL, vec3(0, 0, 1), quat_identity(), vec3(1, 1, 1), NULL);
+
+  bool passed = entity_set_parent(&ep, c, b) && entity_set_parent(&ep, b, a);
+  passed &= !entity_set_parent(&ep, a, c) && !entity_set_parent(&ep, a, a);
+  passed &= entity_pool_level_count(&ep) == 3;
+  passed &= entity_depth(&ep, a) == 0 && entity_depth(&ep, b) == 1 && entity_depth(&ep, c) == 2;
+
+  update_levels(&ep, &arena);
+  mat4 world = matrices_of(&ep, c)->world;
+  passed &= world.cols[3].x == 1 && world.cols[3].y == 2 && world.cols[3].z == 2;
+  passed &= matrices_of(&ep, c)->normal.cols[0].x == 0.5f;
+
+  // b and c come up a level, b's transform is relative to the world now
+  entity_free(&ep, NULL, NULL, a);
+  passed &= entity_pool_level_count(&ep) == 2;
+  passed &= entity_parent(&ep, b) == NULL && entity_depth(&ep, c) == 1;
+
+  update_levels(&ep, &arena);
+  world = matrices_of(&ep, c)->world;
+  passed &= world.cols[3].x == 0 && world.cols[3].y == 1 && world.cols[3].z == 1;
+
+  // One past the deepest allowed gets refused, and leaves things as they were
+  Entity_Handle chain[ENTITY_MAX_DEPTH + 1];
+  for (u32 i = 0; i <= ENTITY_MAX_DEPTH; i++) {
+    chain[i] = entity_make(&ep, NULL, NULL, vec3(1, 0, 0), quat_identity(), vec3(1, 1, 1), NULL);
+    if (i > 0 && i < ENTITY_MAX_DEPTH) {
+      passed &= entity_set_parent(&ep, chain[i], chain[i - 1]);
+    }
+  }
+  passed &= !entity_set_parent(&ep, chain[ENTITY_MAX_DEPTH], chain[ENTITY_MAX_DEPTH - 1]);
+  passed &= entity_pool_level_count(&ep) == ENTITY_MAX_DEPTH;
+
+  update_levels(&ep, &arena);
+  passed &= matrices_of(&ep, chain[ENTITY_MAX_DEPTH - 1])->world.cols[3].x == ENTITY_MAX_DEPTH;
+
+  arena_free(&arena);
+  entity_pool_free(&ep);
+  return passed;
+}
+
+// Parents as indices into the test's entities, -1 for roots. Everything sits one unit along x from
+// its parent so a world position is just the number of ancestors, exact in f32
+typedef struct Hierarchy_Model Hierarchy_Model;
+struct Hierarchy_Model {
+  Entity_Pool ep;
+  Entity_Handle entities[TEST_HIERARCHY_ENTITIES];
+  i32 parents[TEST_HIERARCHY_ENTITIES];
+};
+
+translation_local u32 hierarchy_model_depth(Hierarchy_Model *model, i32 i) {
+  u32 depth = 0;
+  for (i32 at = model->parents[i]; at >= 0; at = model->parents[at]) {
+    depth++;
+  }
+
+  return depth;
+}
+
+// Would parenting i under parent work, no cycle and nothing below i ending up too deep
+translation_local bool hierarchy_model_allows(Hierarchy_Model *model, i32 i, i32 parent) {
+  u32 depth = 0;
+  if (parent >= 0) {
+    for (i32 at = parent; at >= 0; at = model->parents[at]) {
+      if (at == i)
+        return false;
+    }
+    depth = hierarchy_model_depth(model, parent) + 1;
+  }
+
+  u32 height = 0;
+  for (i32 k = 0; k < TEST_HIERARCHY_ENTITIES; k++) {
+    u32 below = 0;
+    for (i32 at = k; at >= 0; at = model->parents[at], below++) {
+      if (at == i) {
+        height = MAX(height, below);
+        break;
+      }
+    }
+  }
+
+  return depth + height < ENTITY_MAX_DEPTH;
+}
+
+translation_local bool hierarchy_model_matches(Hierarchy_Model *model) {
+  Entity_Pool *ep = &model->ep;
+  bool passed = true;
+
+  u32 level_sizes[ENTITY_MAX_DEPTH] = {0};
+  u32 max_depth = 0;
+  for (i32 i = 0; i < TEST_HIERARCHY_ENTITIES; i++) {
+    u32 depth = hierarchy_model_depth(model, i);
+    level_sizes[depth]++;
+    max_depth = MAX(max_depth, depth);
+    passed &= entity_depth(ep, model->entities[i]) == depth;
+
+    Entity_Parent *link = entity_parent(ep, model->entities[i]);
+    if (model->parents[i] < 0) {
+      passed &= link == NULL;
+    } else {
+      passed &= link != NULL && same_entity(link->entity, model->entities[model->parents[i]]);
+    }
+
+    // Children list holds exactly the ones the model has, linked both ways
+    u32 child_count = 0;
+    Entity_Handle prev = POOL_HANDLE_NIL;
+    for (Entity_Handle child = entity_first_child(ep, model->entities[i]);
+         ecs_alive(&ep->world, child); child = entity_parent(ep, child)->next_sibling) {
+      Entity_Parent *child_link = entity_parent(ep, child);
+      passed &= same_entity(child_link->entity, model->entities[i]);
+      passed &= same_entity(child_link->prev_sibling, prev);
+      prev = child;
+      child_count++;
+    }
+    for (i32 k = 0; k < TEST_HIERARCHY_ENTITIES; k++) {
+      child_count -= model->parents[k] == i;
+    }
+    passed &= child_count == 0;
+  }
+
+  passed &= entity_pool_level_count(ep) == max_depth + 1;
+  for (u32 depth = 0; depth <= max_depth; depth++) {
+    passed &= ecs_query_count(&ep->world, entity_query_level(ep, depth)) == level_sizes[depth];
+  }
+
+  return passed;
+}
+
+// Random reparents and the odd free, checking depths, links, levels and worlds as it goes
+translation_local bool check_hierarchy_model(void) {
+  Hierarchy_Model *model = calloc(1, sizeof(Hierarchy_Model));
+  model->ep = entity_pool_make();
+  Entity_Pool *ep = &model->ep;
+  Arena arena = arena_make(MB(1), ARENA_FLAG_DEFAULTS);
+
+  for (i32 i = 0; i < TEST_HIERARCHY_ENTITIES; i++) {
+    model->entities[i] =
+        entity_make(ep, NULL, NULL, vec3(1, 0, 0), quat_identity(), vec3(1, 1, 1), NULL);
+    model->parents[i] = -1;
+  }
+
+  bool passed = true;
+  for (u32 step = 0; step < TEST_HIERARCHY_STEPS; step++) {
+    i32 i = (i32)(random_u32() % TEST_HIERARCHY_ENTITIES);
+    u32 op = random_u32() % 64;
+
+    if (op == 0) {
+      // Its children become roots, and a fresh root takes its place in the model
+      entity_free(ep, NULL, NULL, model->entities[i]);
+      for (i32 k = 0; k < TEST_HIERARCHY_ENTITIES; k++) {
+        model->parents[k] = model->parents[k] == i ? -1 : model->parents[k];
+      }
+      model->entities[i] =
+          entity_make(ep, NULL, NULL, vec3(1, 0, 0), quat_identity(), vec3(1, 1, 1), NULL);
+      model->parents[i] = -1;
+    } else {
+      i32 parent = op == 1 ? -1 : (i32)(random_u32() % TEST_HIERARCHY_ENTITIES);
+      Entity_Handle parent_entity = parent >= 0 ? model->entities[parent] : POOL_HANDLE_NIL;
+
+      // Refusals are in check_chain(), they'd only fill the log here
+      if (hierarchy_model_allows(model, i, parent)) {
+        passed &= entity_set_parent(ep, model->entities[i], parent_entity);
+        model->parents[i] = parent;
+      }
+    }
+
+    if ((step + 1) % TEST_HIERARCHY_CHECK_EVERY == 0) {
+      passed &= hierarchy_model_matches(model);
+
+      // Only what moved gets rebuilt, so this also catches a reparent that forgot to dirty
+      update_levels(ep, &arena);
+      for (i32 k = 0; k < TEST_HIERARCHY_ENTITIES; k++) {
+        f32 x = matrices_of(ep, model->entities[k])->world.cols[3].x;
+        passed &= x == (f32)(hierarchy_model_depth(model, k) + 1);
+      }
+    }
+  }
+
+  arena_free(&arena);
+  entity_pool_free(ep);
+  free(model);
+  return passed;
+}
+
+// Benchmark -------------------------------------------------------------------
+
+translation_local void bench_structural(void) {
+  ECS_World world = ecs_world_make();
+  ECS_Component small = ecs_component_register_type(&world, Test_Small);
+  ECS_Component medium = ecs_component_register_type(&world, Test_Medium);
+  ECS_Entity *entities = malloc(TEST_BENCH_ENTITIES * sizeof(ECS_Entity));
+
+  u64 start = get_time_ns();
+  for (u32 i = 0; i < TEST_BENCH_ENTITIES; i++) {
+    entities[i] = ecs_spawn(&world, ECS_BIT(small));
+  }
+  u64 spawned = get_time_ns();
+  for (u32 i = 0; i < TEST_BENCH_ENTITIES; i++) {
+    ecs_add(&world, entities[i], medium);
+  }
+  u64 added = get_time_ns();
+  for (u32 i = 0; i < TEST_BENCH_ENTITIES; i++) {
+    ecs_despawn(&world, entities[i]);
+  }
+  u64 despawned = get_time_ns();
+
+  printf("  %-28s %6.1f ns\n", "spawn", (f64)(spawned - start) / TEST_BENCH_ENTITIES);
+  printf("  %-28s %6.1f ns\n", "add component", (f64)(added - spawned) / TEST_BENCH_ENTITIES);
+  printf("  %-28s %6.1f ns\n", "despawn", (f64)(despawned - added) / TEST_BENCH_ENTITIES);
+
+  free(entities);
+  ecs_world_free(&world);
+}
+
+// Mostly roots with a few levels of children hanging off them, everything spinning so everything
+// rebuilds. Then what moving a child over to another parent costs
+translation_local void bench_hierarchy(void) {
+  Entity_Pool ep = entity_pool_make();
+  Arena arena = arena_make(MB(8), ARENA_FLAG_DEFAULTS);
+  Entity_Handle *entities = malloc(TEST_BENCH_ENTITIES * sizeof(Entity_Handle));
+
+  for (u32 i = 0; i < TEST_BENCH_ENTITIES; i++) {
+    entities[i] =
+        entity_make(&ep, NULL, NULL, vec3((f32)i, 0, 0), quat_identity(), vec3(1, 1, 1), NULL);
+  }
+  // Ten children each, the first ten under the last root, so a few levels deep
+  u32 first_child = TEST_BENCH_ENTITIES - TEST_BENCH_CHILDREN;
+  for (u32 i = first_child; i < TEST_BENCH_ENTITIES; i++) {
+    entity_set_parent(&ep, entities[i], entities[first_child + (i - first_child) / 10 - 1]);
+  }
+
+  quat spin = quat_from_axis_angle(vec3(0, 1, 0), 0.01f);
+  u64 best = UINT64_MAX;
+  for (u32 run = 0; run < TEST_BENCH_RUNS; run++) {
+    ECS_Query transforms = {.all = ECS_BIT(ep.components.transform)};
+    ECS_Iter it = ecs_query_iter(&ep.world, transforms);
+    while (ecs_iter_next(&it)) {
+      Transform *column = ecs_chunk_column_type(it.chunk, ep.components.transform, Transform);
+      for (u32 i = 0; i < it.chunk->count; i++) {
+        transform_rotate(&column[i], spin);
+      }
+    }
+
+    u64 start = get_time_ns();
+    update_levels(&ep, &arena);
+    best = MIN(best, get_time_ns() - start);
+  }
+  printf("  %-28s %6.1f ns, %u levels\n", "levelled update per entity",
+         (f64)best / TEST_BENCH_ENTITIES, entity_pool_level_count(&ep));
+
+  // Leaves swapping between two roots, only their own depth gets touched
+  u64 start = get_time_ns();
+  for (u32 i = TEST_BENCH_ENTITIES - TEST_BENCH_CHILDREN / 2; i < TEST_BENCH_ENTITIES; i++) {
+    entity_set_parent(&ep, entities[i], entities[i % 2]);
+  }
+  printf("  %-28s %6.1f ns\n", "reparent a leaf",
+         (f64)(get_time_ns() - start) / (TEST_BENCH_CHILDREN / 2));
+
+  free(entities);
+  arena_free(&arena);
+  entity_pool_free(&ep);
+}
+
+int main(int argc, char **argv) {
+  Thread_Context tctx;
+  thread_context_init(&tctx, "main");
+  printf("ecs_test\n");
+
+  bool passed = report("model check", check_model());
+  passed &= report("hierarchy chain", check_chain());
+  passed &= report("hierarchy model check", check_hierarchy_model());
+
+  // Timing is slow and noisy, only when asked
+  if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+    bench_structural();
+    bench_hierarchy();
+  }
+
+  thread_context_free();
+
+  printf("%s\n", passed ? "PASSED" : "FAILED");
+  return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
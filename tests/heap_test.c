@@ -0,0 +1,190 @@
+// Checks the heap at both edges of every size class, on the large mapped path, through realloc
+// across classes, and that the per tag stats add up
+
+#include "core/heap.h"
+#include "os/os.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+enum Test_Constants {
+  TEST_HEADER_SIZE = 16, // Heap_Header rounded up to HEAP_ALIGNMENT
+  TEST_LARGE_SIZE = MB(3) + 123,
+};
+
+translation_local bool report(const char *name, bool passed) {
+  printf("  %-24s %s\n", name, passed ? "ok" : "FAILED");
+  return passed;
+}
+
+// Same steps heap.c uses, block sizes with the header included. 16 byte steps up to 128, then 4
+// steps per power of 2 up to HEAP_SMALL_MAX
+translation_local u32 class_sizes(usize *out) {
+  u32 count = 0;
+  for (usize size = 16; size <= 128; size += 16) {
+    out[count++] = size;
+  }
+  for (usize base = 128; base < HEAP_SMALL_MAX; base *= 2) {
+    for (u32 step = 1; step <= 4; step++) {
+      out[count++] = base + step * (base / 4);
+    }
+  }
+
+  return count;
+}
+
+translation_local void fill(u8 *bytes, usize size, u8 seed) {
+  for (usize i = 0; i < size; i++) {
+    bytes[i] = (u8)(seed + i * 31);
+  }
+}
+
+translation_local bool filled(const u8 *bytes, usize size, u8 seed) {
+  for (usize i = 0; i < size; i++) {
+    if (bytes[i] != (u8)(seed + i * 31))
+      return false;
+  }
+
+  return true;
+}
+
+// Biggest and smallest request for every class, all alive at once and completely written. A class
+// that is a byte short would stomp its neighbour
+translation_local bool check_size_classes(void) {
+  usize sizes[HEAP_SIZE_CLASS_COUNT];
+  u32 count = class_sizes(sizes);
+  bool passed = count == HEAP_SIZE_CLASS_COUNT && sizes[count - 1] == HEAP_SMALL_MAX;
+
+  u8 *blocks[HEAP_SIZE_CLASS_COUNT][2];
+  usize requests[HEAP_SIZE_CLASS_COUNT][2];
+  for (u32 i = 0; i < count; i++) {
+    requests[i][0] = i == 0 ? 1 : sizes[i - 1] - TEST_HEADER_SIZE + 1;
+    requests[i][1] = sizes[i] - TEST_HEADER_SIZE;
+
+    for (u32 edge = 0; edge < 2; edge++) {
+      blocks[i][edge] = heap_alloc(requests[i][edge]);
+      passed &= ((uintptr_t)blocks[i][edge] & (HEAP_ALIGNMENT - 1)) == 0;
+      fill(blocks[i][edge], requests[i][edge], (u8)(i * 2 + edge));
+    }
+  }
+
+  for (u32 i = 0; i < count; i++) {
+    for (u32 edge = 0; edge < 2; edge++) {
+      passed &= filled(blocks[i][edge], requests[i][edge], (u8)(i * 2 + edge));
+    }
+  }
+
+  // Freed blocks go back on their own class's list, so the same class gets them straight back
+  for (u32 i = 0; i < count; i++) {
+    heap_free(blocks[i][1]);
+    passed &= heap_alloc(requests[i][0]) == blocks[i][1];
+    heap_free(blocks[i][0]);
+    heap_free(blocks[i][1]);
+  }
+
+  return passed;
+}
+
+// Just past the biggest small class gets its own mapping, header at the start of the page
+translation_local bool check_large(void) {
+  bool passed = true;
+
+  usize sizes[] = {HEAP_SMALL_MAX - TEST_HEADER_SIZE + 1, TEST_LARGE_SIZE};
+  for (u32 i = 0; i < STATIC_ARRAY_COUNT(sizes); i++) {
+    u8 *bytes = heap_alloc(sizes[i]);
+    passed &= (uintptr_t)bytes % os_page_size() == TEST_HEADER_SIZE;
+    fill(bytes, sizes[i], (u8)i);
+    passed &= filled(bytes, sizes[i], (u8)i);
+    heap_free(bytes);
+  }
+
+  return passed;
+}
+
+// Grow a block by half again at a time from 1 byte through the classes and into the large path,
+// then back down, contents have to come along every time it moves
+translation_local bool check_realloc(void) {
+  bool passed = true;
+
+  usize size = 1;
+  u8 *bytes = heap_realloc(NULL, size);
+  fill(bytes, size, 7);
+
+  while (size < TEST_LARGE_SIZE) {
+    usize new_size = MIN(size * 3 / 2 + 1, TEST_LARGE_SIZE);
+    bytes = heap_realloc(bytes, new_size);
+    passed &= filled(bytes, size, 7);
+    fill(bytes, new_size, 7);
+    size = new_size;
+  }
+
+  while (size > 1) {
+    usize new_size = size / 3;
+    new_size = MAX(new_size, 1);
+    bytes = heap_realloc(bytes, new_size);
+    passed &= filled(bytes, new_size, 7);
+    size = new_size;
+  }
+
+  // Resizing within the class it is already in doesn't move it
+  u8 *same = heap_alloc(100);
+  passed &= heap_realloc(same, 90) == same && heap_realloc(same, 112) == same;
+  heap_free(same);
+  heap_free(bytes);
+
+  return passed;
+}
+
+// What goes in one tag shows up there and nowhere else, and goes away again on free
+translation_local bool check_stats(void) {
+  bool passed = true;
+
+  Heap_Stats before[HEAP_TAG_COUNT];
+  for (u32 tag = 0; tag < HEAP_TAG_COUNT; tag++) {
+    before[tag] = heap_get_stats(tag);
+  }
+
+  void *small = heap_alloc_tagged(100, HEAP_TAG_ASSET);
+  void *large = heap_alloc_tagged(TEST_LARGE_SIZE, HEAP_TAG_ASSET);
+  void *render = heap_alloc_tagged(1000, HEAP_TAG_RENDER);
+
+  Heap_Stats asset = heap_get_stats(HEAP_TAG_ASSET);
+  passed &= asset.bytes_in_use - before[HEAP_TAG_ASSET].bytes_in_use == 100 + TEST_LARGE_SIZE;
+  passed &= asset.alloc_count - before[HEAP_TAG_ASSET].alloc_count == 2;
+  passed &= asset.bytes_peak >= asset.bytes_in_use;
+
+  // Realloc keeps the tag, both in the block and in the accounting
+  small = heap_realloc(small, 5000);
+  asset = heap_get_stats(HEAP_TAG_ASSET);
+  passed &= asset.bytes_in_use - before[HEAP_TAG_ASSET].bytes_in_use == 5000 + TEST_LARGE_SIZE;
+
+  Heap_Stats render_stats = heap_get_stats(HEAP_TAG_RENDER);
+  passed &= render_stats.bytes_in_use - before[HEAP_TAG_RENDER].bytes_in_use == 1000;
+
+  heap_free(small);
+  heap_free(large);
+  heap_free(render);
+
+  for (u32 tag = 0; tag < HEAP_TAG_COUNT; tag++) {
+    Heap_Stats after = heap_get_stats(tag);
+    passed &= after.bytes_in_use == before[tag].bytes_in_use;
+    passed &= after.alloc_count - after.free_count ==
+              before[tag].alloc_count - before[tag].free_count;
+  }
+
+  passed &= strcmp(heap_tag_name(HEAP_TAG_ASSET), "Asset") == 0;
+  return passed;
+}
+
+int main(void) {
+  printf("heap_test\n");
+
+  bool passed = report("size class edges", check_size_classes());
+  passed &= report("large mappings", check_large());
+  passed &= report("realloc across classes", check_realloc());
+  passed &= report("tag stats", check_stats());
+
+  printf("%s\n", passed ? "PASSED" : "FAILED");
+  return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,249 @@
+// Checks that every job runs exactly once, flat, forked from inside other jobs and as parallel_for
+// ranges, then with --bench times empty job throughput, fan-out/fan-in latency (hot and from
+// asleep) and how parallel_for scales the per entity transform work at 1k, 10k and 100k
+
+#include "core/job.h"
+#include "core/thread_context.h"
+#include "game/transform.h"
+#include "os/os.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+enum Test_Constants {
+  TEST_WORKER_COUNT = 4, // Fixed so the checks see stealing even on a machine with one core
+  TEST_FLAT_JOBS = 100000,
+  TEST_FORK_DEPTH = 14, // 2^14 leaves
+  TEST_BENCH_EMPTY_JOBS = 1 << 22,
+  TEST_BENCH_BATCH = 1024,
+  TEST_BENCH_FAN = 64,
+  TEST_BENCH_FAN_ROUNDS = 20000,
+  TEST_BENCH_SLEEP_ROUNDS = 200,
+  TEST_BENCH_ENTITY_RUNS = 30, // Best of
+  TEST_BENCH_ENTITY_GRAIN = 256,
+};
+
+translation_local _Atomic u64 job_sum;
+
+translation_local bool report(const char *name, bool passed) {
+  printf("  %-24s %s\n", name, passed ? "ok" : "FAILED");
+  return passed;
+}
+
+translation_local void add_job(void *data) {
+  atomic_fetch_add_explicit(&job_sum, (u64)(uintptr_t)data, memory_order_relaxed);
+}
+
+// Forks two of itself and waits on them, down to the leaves
+translation_local void fork_job(void *data) {
+  u32 depth = (u32)(uintptr_t)data;
+  if (depth == 0) {
+    atomic_fetch_add_explicit(&job_sum, 1, memory_order_relaxed);
+    return;
+  }
+
+  Job_Counter counter = {0};
+  job_run(fork_job, (void *)(uintptr_t)(depth - 1), &counter);
+  job_run(fork_job, (void *)(uintptr_t)(depth - 1), &counter);
+  job_wait(&counter);
+}
+
+// More jobs than fit in a deque, the overflow runs inline, still exactly once each
+translation_local bool check_flat(void) {
+  atomic_store(&job_sum, 0);
+
+  Job_Counter counter = {0};
+  for (u64 i = 1; i <= TEST_FLAT_JOBS; i++) {
+    job_run(add_job, (void *)(uintptr_t)i, &counter);
+  }
+  job_wait(&counter);
+
+  return atomic_load(&job_sum) == (u64)TEST_FLAT_JOBS * (TEST_FLAT_JOBS + 1) / 2;
+}
+
+translation_local bool check_fork_join(void) {
+  atomic_store(&job_sum, 0);
+
+  Job_Counter counter = {0};
+  job_run(fork_job, (void *)(uintptr_t)TEST_FORK_DEPTH, &counter);
+  job_wait(&counter);
+
+  return atomic_load(&job_sum) == 1u << TEST_FORK_DEPTH;
+}
+
+translation_local _Atomic u8 *range_hits;
+
+translation_local void hit_range(void *data, u32 start, u32 end) {
+  (void)data;
+  for (u32 i = start; i < end; i++) {
+    atomic_fetch_add_explicit(&range_hits[i], 1, memory_order_relaxed);
+  }
+}
+
+// Every index in exactly one range, whatever the count and grain
+translation_local bool check_parallel_for(void) {
+  u32 counts[] = {0, 1, 7, 1000, 100003};
+  u32 grains[] = {0, 1, 64, 1000000};
+  bool passed = true;
+
+  for (u32 c = 0; c < STATIC_ARRAY_COUNT(counts); c++) {
+    for (u32 g = 0; g < STATIC_ARRAY_COUNT(grains); g++) {
+      range_hits = calloc(MAX(counts[c], 1), sizeof(*range_hits));
+      job_parallel_for(counts[c], grains[g], hit_range, NULL);
+
+      for (u32 i = 0; i < counts[c]; i++) {
+        passed &= atomic_load(&range_hits[i]) == 1;
+      }
+      free(range_hits);
+    }
+  }
+
+  return passed;
+}
+
+// Benchmark -------------------------------------------------------------------
+
+// What a frame does for every root entity, spin it a little, rebuild its matrices and clip
+typedef struct Bench_Entities Bench_Entities;
+struct Bench_Entities {
+  Transform *transforms;
+  Transform_Matrices *matrices;
+  mat4 *clip_transforms;
+  mat4 proj_view;
+  quat spin;
+};
+
+translation_local void bench_entities_range(void *data, u32 start, u32 end) {
+  Bench_Entities *entities = data;
+  for (u32 i = start; i < end; i++) {
+    transform_rotate(&entities->transforms[i], entities->spin);
+    transform_update(&entities->transforms[i], &entities->matrices[i], NULL, NULL);
+  }
+  transform_clip_batch(&entities->matrices[start], end - start, entities->proj_view,
+                       &entities->clip_transforms[start]);
+}
+
+// Best run in us, grain of UINT32_MAX means straight through on this thread
+translation_local f64 bench_entities_run(Bench_Entities *entities, u32 count, u32 grain) {
+  u64 best = UINT64_MAX;
+  for (u32 run = 0; run < TEST_BENCH_ENTITY_RUNS; run++) {
+    u64 start = get_time_ns();
+    if (grain == UINT32_MAX) {
+      bench_entities_range(entities, 0, count);
+    } else {
+      job_parallel_for(count, grain, bench_entities_range, entities);
+    }
+    best = MIN(best, get_time_ns() - start);
+  }
+
+  return (f64)best / 1e3;
+}
+
+translation_local void bench_parallel_for(void) {
+  printf("  parallel_for, %u workers\n", job_worker_count());
+
+  u32 counts[] = {1000, 10000, 100000};
+  for (u32 c = 0; c < STATIC_ARRAY_COUNT(counts); c++) {
+    u32 count = counts[c];
+
+    Bench_Entities entities = {
+        .transforms = malloc(count * sizeof(Transform)),
+        .matrices = aligned_alloc(64, count * sizeof(Transform_Matrices)),
+        .clip_transforms = aligned_alloc(64, count * sizeof(mat4)),
+        .proj_view = mat4_perspective(RADIANS(90.0f), 16.0f / 9.0f, 0.1f, 1000.0f),
+        .spin = quat_from_axis_angle(vec3(0.0f, 1.0f, 0.0f), 0.01f),
+    };
+    for (u32 i = 0; i < count; i++) {
+      entities.transforms[i] =
+          transform_make(vec3((f32)i, 1.0f, -5.0f), quat_identity(), vec3(1.0f, 2.0f, 1.0f));
+    }
+
+    f64 serial = bench_entities_run(&entities, count, UINT32_MAX);
+    f64 automatic = bench_entities_run(&entities, count, 0);
+    f64 grained = bench_entities_run(&entities, count, TEST_BENCH_ENTITY_GRAIN);
+    printf("  %6u entities: serial %8.1f us, parallel_for grain auto %8.1f us (%.2fx), "
+           "%u %8.1f us (%.2fx)\n",
+           count, serial, automatic, serial / automatic, TEST_BENCH_ENTITY_GRAIN, grained,
+           serial / grained);
+
+    free(entities.transforms);
+    free(entities.matrices);
+    free(entities.clip_transforms);
+  }
+}
+
+translation_local void empty_job(void *data) { (void)data; }
+
+translation_local void bench(void) {
+  printf("  %u workers\n", job_worker_count());
+
+  // Throughput, batches of empty jobs waited on one after another
+  Job_Counter counter = {0};
+  Job *jobs = malloc(TEST_BENCH_BATCH * sizeof(Job));
+  for (u32 i = 0; i < TEST_BENCH_BATCH; i++) {
+    jobs[i] = (Job){.proc = empty_job, .counter = &counter};
+  }
+
+  u64 start = get_time_ns();
+  for (u32 i = 0; i < TEST_BENCH_EMPTY_JOBS / TEST_BENCH_BATCH; i++) {
+    job_run_batch(jobs, TEST_BENCH_BATCH);
+    job_wait(&counter);
+  }
+  f64 seconds = (f64)(get_time_ns() - start) / NSEC_PER_SEC;
+  printf("  %-28s %8.1f M/s\n", "empty jobs", TEST_BENCH_EMPTY_JOBS / seconds / 1e6);
+
+  // Latency, a frame's worth of fan-out and straight back in, workers still spinning
+  start = get_time_ns();
+  for (u32 round = 0; round < TEST_BENCH_FAN_ROUNDS; round++) {
+    job_run_batch(jobs, TEST_BENCH_FAN);
+    job_wait(&counter);
+  }
+  f64 us = (f64)(get_time_ns() - start) / 1e3 / TEST_BENCH_FAN_ROUNDS;
+  printf("  %-28s %8.2f us\n", "fan-out/fan-in 64", us);
+
+  // Same again after the workers have gone to sleep, pays for the futex wake
+  u64 total = 0;
+  for (u32 round = 0; round < TEST_BENCH_SLEEP_ROUNDS; round++) {
+    os_sleep_ms(1);
+    start = get_time_ns();
+    job_run_batch(jobs, TEST_BENCH_FAN);
+    job_wait(&counter);
+    total += get_time_ns() - start;
+  }
+  printf("  %-28s %8.2f us\n", "fan-out/fan-in 64 from sleep",
+         (f64)total / 1e3 / TEST_BENCH_SLEEP_ROUNDS);
+
+  free(jobs);
+}
+
+int main(int argc, char **argv) {
+  Thread_Context tctx;
+  thread_context_init(&tctx, "main");
+  printf("job_test\n");
+
+  job_system_init(TEST_WORKER_COUNT, false);
+  bool passed = report("flat jobs", check_flat());
+  passed &= report("nested fork/join", check_fork_join());
+  passed &= report("parallel_for ranges", check_parallel_for());
+  job_system_free();
+
+  // Timing is slow and noisy, only when asked. One worker per core for the job overheads, then
+  // parallel_for at doubling worker counts up to that
+  if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+    job_system_init(0, true);
+    bench();
+    job_system_free();
+
+    for (u32 workers = 1; workers <= os_core_count(); workers *= 2) {
+      job_system_init(workers, true);
+      bench_parallel_for();
+      job_system_free();
+    }
+  }
+
+  thread_context_free();
+
+  printf("%s\n", passed ? "PASSED" : "FAILED");
+  return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,258 @@
+// Checks the SIMD kernels in linear_algebra.h against their *_scalar references, then times both.
+// build.sh builds this once per instruction set with -DLINEAR_ALGEBRA_SIMD and -ffp-contract=off,
+// see the NOTE at the top of linear_algebra.h for what is promised to match bit for bit
+
+#include "core/linear_algebra.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+enum Test_Constants {
+  TEST_SAMPLES = 100000,
+  TEST_BENCH_COUNT = 1024, // Elements per timed pass, small enough to stay in L1/L2
+  TEST_BENCH_PASSES = 2000,
+  TEST_BENCH_RUNS = 7, // Best of, this is usually on a noisy machine
+};
+
+// vec4_dot sums pairwise, bound on its error in units of eps * sum |a * b|. The scalar sum is
+// within 3 of those, pairwise is tighter still
+#define TEST_DOT_MAX_ERROR 3.0
+// mat4_inverse is a different algorithm entirely, relative to the largest element of the inverse
+#define TEST_INVERSE_MAX_ERROR 1e-4
+
+translation_local u32 rng_state = 12345;
+
+// xorshift32, same sequence every run
+translation_local f32 random_f32(void) {
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 17;
+  rng_state ^= rng_state << 5;
+  return (rng_state / (f32)UINT32_MAX) * 200.0f - 100.0f;
+}
+
+translation_local vec4 random_vec4(void) {
+  return vec4_make(random_f32(), random_f32(), random_f32(), random_f32());
+}
+
+translation_local mat4 random_mat4(void) {
+  mat4 m;
+  for (u32 col = 0; col < 4; col++) {
+    m.cols[col] = random_vec4();
+  }
+
+  return m;
+}
+
+// Distance between two floats in representable steps, sign aware
+translation_local u64 ulp_distance(f32 a, f32 b) {
+  i32 ia = 0, ib = 0;
+  memcpy(&ia, &a, sizeof(ia));
+  memcpy(&ib, &b, sizeof(ib));
+  if (ia < 0)
+    ia = INT32_MIN - ia;
+  if (ib < 0)
+    ib = INT32_MIN - ib;
+
+  i64 distance = (i64)ia - ib;
+  return distance < 0 ? -distance : distance;
+}
+
+translation_local u64 max_ulp_distance(const f32 *a, const f32 *b, u32 count) {
+  u64 worst = 0;
+  for (u32 i = 0; i < count; i++) {
+    worst = MAX(worst, ulp_distance(a[i], b[i]));
+  }
+
+  return worst;
+}
+
+typedef struct Test_Result Test_Result;
+struct Test_Result {
+  const char *name;
+  u64 max_ulp;
+};
+
+translation_local bool check_bit_exact(void) {
+  Test_Result results[] = {
+      {.name = "mat4_mul"}, {.name = "mat4_mul_vec4"}, {.name = "mat4_transpose"},
+      {.name = "vec4_add"}, {.name = "vec4_sub"},      {.name = "vec4_mul"},
+      {.name = "vec4_div"},
+  };
+
+  for (u32 sample = 0; sample < TEST_SAMPLES; sample++) {
+    mat4 a = random_mat4();
+    mat4 b = random_mat4();
+    vec4 v = random_vec4();
+    vec4 w = random_vec4();
+    f32 s = random_f32();
+
+    mat4 m_simd = mat4_mul(a, b);
+    mat4 m_scalar = mat4_mul_scalar(a, b);
+    results[0].max_ulp = MAX(results[0].max_ulp, max_ulp_distance(&m_simd.m[0][0],
+                                                                  &m_scalar.m[0][0], 16));
+
+    vec4 v_simd = mat4_mul_vec4(a, v);
+    vec4 v_scalar = mat4_mul_vec4_scalar(a, v);
+    results[1].max_ulp =
+        MAX(results[1].max_ulp, max_ulp_distance(v_simd.elements, v_scalar.elements, 4));
+
+    m_simd = mat4_transpose(a);
+    m_scalar = mat4_transpose_scalar(a);
+    results[2].max_ulp = MAX(results[2].max_ulp, max_ulp_distance(&m_simd.m[0][0],
+                                                                  &m_scalar.m[0][0], 16));
+
+    v_simd = vec4_add(v, w);
+    v_scalar = vec4_add_scalar(v, w);
+    results[3].max_ulp =
+        MAX(results[3].max_ulp, max_ulp_distance(v_simd.elements, v_scalar.elements, 4));
+
+    v_simd = vec4_sub(v, w);
+    v_scalar = vec4_sub_scalar(v, w);
+    results[4].max_ulp =
+        MAX(results[4].max_ulp, max_ulp_distance(v_simd.elements, v_scalar.elements, 4));
+
+    v_simd = vec4_mul(v, s);
+    v_scalar = vec4_mul_scalar(v, s);
+    results[5].max_ulp =
+        MAX(results[5].max_ulp, max_ulp_distance(v_simd.elements, v_scalar.elements, 4));
+
+    v_simd = vec4_div(v, s);
+    v_scalar = vec4_div_scalar(v, s);
+    results[6].max_ulp =
+        MAX(results[6].max_ulp, max_ulp_distance(v_simd.elements, v_scalar.elements, 4));
+  }
+
+  bool passed = true;
+  for (u32 i = 0; i < STATIC_ARRAY_COUNT(results); i++) {
+    bool exact = results[i].max_ulp == 0;
+    printf("  %-16s max %lu ulp from scalar %s\n", results[i].name, results[i].max_ulp,
+           exact ? "ok" : "FAILED");
+    passed &= exact;
+  }
+
+  return passed;
+}
+
+translation_local bool check_dot(void) {
+  f64 worst_simd = 0.0;
+  f64 worst_scalar = 0.0;
+  for (u32 sample = 0; sample < TEST_SAMPLES; sample++) {
+    vec4 a = random_vec4();
+    vec4 b = random_vec4();
+
+    f64 exact = 0.0;
+    f64 magnitude = 0.0;
+    for (u32 i = 0; i < 4; i++) {
+      exact += (f64)a.elements[i] * b.elements[i];
+      magnitude += fabs((f64)a.elements[i] * b.elements[i]);
+    }
+
+    f64 unit = magnitude * 5.9604644775390625e-8; // 2^-24
+    worst_simd = MAX(worst_simd, fabs(vec4_dot(a, b) - exact) / unit);
+    worst_scalar = MAX(worst_scalar, fabs(vec4_dot_scalar(a, b) - exact) / unit);
+  }
+
+  bool passed = worst_simd <= TEST_DOT_MAX_ERROR;
+  printf("  %-16s %.2f eps*sum|ab| (scalar %.2f) %s\n", "vec4_dot", worst_simd, worst_scalar,
+         passed ? "ok" : "FAILED");
+
+  return passed;
+}
+
+translation_local bool check_inverse(void) {
+  f64 worst = 0.0;
+  for (u32 sample = 0; sample < TEST_SAMPLES; sample++) {
+    // Diagonally dominant so it's well conditioned, otherwise the two just disagree on noise
+    mat4 m = random_mat4();
+    for (u32 i = 0; i < 4; i++) {
+      m.cols[i].elements[i] += m.cols[i].elements[i] < 0.0f ? -400.0f : 400.0f;
+    }
+
+    mat4 simd = mat4_inverse(m);
+    mat4 scalar = mat4_inverse_scalar(m);
+
+    f64 largest = 0.0;
+    f64 difference = 0.0;
+    for (u32 i = 0; i < 16; i++) {
+      largest = MAX(largest, fabs((f64)(&scalar.m[0][0])[i]));
+      difference = MAX(difference, fabs((f64)(&simd.m[0][0])[i] - (&scalar.m[0][0])[i]));
+    }
+    worst = MAX(worst, difference / largest);
+  }
+
+  bool passed = worst <= TEST_INVERSE_MAX_ERROR;
+  printf("  %-16s %.2e relative to scalar %s\n", "mat4_inverse", worst, passed ? "ok" : "FAILED");
+
+  return passed;
+}
+
+// Benchmark -------------------------------------------------------------------
+
+translation_local mat4 bench_a[TEST_BENCH_COUNT];
+translation_local mat4 bench_b[TEST_BENCH_COUNT];
+translation_local mat4 bench_mat_out[TEST_BENCH_COUNT];
+translation_local vec4 bench_v[TEST_BENCH_COUNT];
+translation_local vec4 bench_w[TEST_BENCH_COUNT];
+translation_local vec4 bench_vec_out[TEST_BENCH_COUNT];
+
+// Best of a few runs, ns per element. The empty asm keeps the compiler from dropping passes
+#define BENCH(name, out, expr)                                                                     \
+  do {                                                                                             \
+    f64 best = 1e9;                                                                                \
+    for (u32 run = 0; run < TEST_BENCH_RUNS; run++) {                                              \
+      u64 start = get_time_ns();                                                                   \
+      for (u32 pass = 0; pass < TEST_BENCH_PASSES; pass++) {                                       \
+        for (u32 i = 0; i < TEST_BENCH_COUNT; i++) {                                               \
+          out[i] = expr;                                                                           \
+        }                                                                                          \
+        __asm__ volatile("" : : "g"(out) : "memory");                                              \
+      }                                                                                            \
+      f64 ns = (f64)(get_time_ns() - start) / ((f64)TEST_BENCH_COUNT * TEST_BENCH_PASSES);         \
+      best = MIN(best, ns);                                                                        \
+    }                                                                                              \
+    printf("  %-24s %6.2f ns\n", name, best);                                                      \
+  } while (0)
+
+translation_local void bench(void) {
+  for (u32 i = 0; i < TEST_BENCH_COUNT; i++) {
+    bench_a[i] = random_mat4();
+    bench_b[i] = random_mat4();
+    bench_v[i] = random_vec4();
+    bench_w[i] = random_vec4();
+  }
+
+  BENCH("mat4_mul", bench_mat_out, mat4_mul(bench_a[i], bench_b[i]));
+  BENCH("mat4_mul_scalar", bench_mat_out, mat4_mul_scalar(bench_a[i], bench_b[i]));
+  BENCH("mat4_mul_vec4", bench_vec_out, mat4_mul_vec4(bench_a[i], bench_v[i]));
+  BENCH("mat4_mul_vec4_scalar", bench_vec_out, mat4_mul_vec4_scalar(bench_a[i], bench_v[i]));
+  BENCH("mat4_transpose", bench_mat_out, mat4_transpose(bench_a[i]));
+  BENCH("mat4_transpose_scalar", bench_mat_out, mat4_transpose_scalar(bench_a[i]));
+  BENCH("mat4_inverse", bench_mat_out, mat4_inverse(bench_a[i]));
+  BENCH("mat4_inverse_scalar", bench_mat_out, mat4_inverse_scalar(bench_a[i]));
+  BENCH("vec4_add", bench_vec_out, vec4_add(bench_v[i], bench_w[i]));
+  BENCH("vec4_add_scalar", bench_vec_out, vec4_add_scalar(bench_v[i], bench_w[i]));
+}
+
+int main(int argc, char **argv) {
+#if LINEAR_ALGEBRA_AVX2
+  const char *backend = "AVX2";
+#elif LINEAR_ALGEBRA_SSE
+  const char *backend = "SSE4.1";
+#else
+  const char *backend = "scalar";
+#endif
+  printf("linear_algebra_test (%s), %u random samples\n", backend, TEST_SAMPLES);
+
+  bool passed = check_bit_exact();
+  passed &= check_dot();
+  passed &= check_inverse();
+
+  // Timing is slow and noisy, only when asked
+  if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+    bench();
+  }
+
+  printf("%s\n", passed ? "PASSED" : "FAILED");
+  return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,330 @@
+// Checks the SPSC and MPSC queues: partial and all-or-nothing batches, wraparound, ordering with
+// real producer and consumer threads going through the futex waits, and that a sleeping side wakes
+// up. With --bench times throughput at a couple of batch sizes and the round trip latency
+
+#include "core/ring_queue.h"
+#include "core/thread_context.h"
+#include "os/os.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+enum Test_Constants {
+  TEST_SMALL_CAPACITY = 8,
+  TEST_STRESS_CAPACITY = 64, // Small so both sides keep wrapping and waiting on each other
+  TEST_STRESS_COUNT = 1 << 20,
+  TEST_MAX_BATCH = 37, // Odd, so batches straddle the end of the ring
+  TEST_PRODUCER_COUNT = 4,
+  TEST_SLEEP_MS = 20,
+  TEST_BENCH_CAPACITY = 1024,
+  TEST_BENCH_COUNT = 1 << 22,
+  TEST_BENCH_ROUND_TRIPS = 100000,
+};
+
+// MPSC elements say who pushed them, their place in that producer's stream, and where they sit in
+// the batch they went in with
+#define ELEMENT_MAKE(producer, sequence, batch_offset)                                             \
+  (((u64)(producer) << 56) | ((u64)(batch_offset) << 40) | (u64)(sequence))
+#define ELEMENT_PRODUCER(element) ((u32)((element) >> 56))
+#define ELEMENT_BATCH_OFFSET(element) ((u32)(((element) >> 40) & 0xFFFF))
+#define ELEMENT_SEQUENCE(element) ((element) & 0xFFFFFFFFFFull)
+
+translation_local bool report(const char *name, bool passed) {
+  printf("  %-24s %s\n", name, passed ? "ok" : "FAILED");
+  return passed;
+}
+
+// xorshift32, each thread keeps its own state
+translation_local u32 random_u32(u32 *state) {
+  *state ^= *state << 13;
+  *state ^= *state >> 17;
+  *state ^= *state << 5;
+  return *state;
+}
+
+// Single Thread -----------------------------------------------------------------
+
+translation_local bool check_spsc_batches(void) {
+  SPSC_Queue queue = spsc_queue_make_type(TEST_SMALL_CAPACITY, u64);
+  bool passed = queue.capacity == TEST_SMALL_CAPACITY;
+
+  u64 in[TEST_SMALL_CAPACITY] = {0};
+  u64 out[TEST_SMALL_CAPACITY] = {0};
+  passed &= spsc_queue_pop(&queue, out, 1) == 0;
+
+  // Only as much as fits goes in, round and round the ring
+  u64 next_in = 0, next_out = 0;
+  for (u32 round = 0; round < 100; round++) {
+    for (u32 i = 0; i < 5; i++) {
+      in[i] = next_in + i;
+    }
+    u32 pushed = spsc_queue_push(&queue, in, 5);
+    next_in += pushed;
+    passed &= pushed == MIN(5, TEST_SMALL_CAPACITY - (next_in - pushed - next_out));
+
+    u32 popped = spsc_queue_pop(&queue, out, 3);
+    for (u32 i = 0; i < popped; i++) {
+      passed &= out[i] == next_out++;
+    }
+  }
+
+  spsc_queue_free(&queue);
+  return passed;
+}
+
+translation_local bool check_mpsc_batches(void) {
+  MPSC_Queue queue = mpsc_queue_make_type(TEST_SMALL_CAPACITY, u64);
+  bool passed = true;
+
+  u64 in[5] = {1, 2, 3, 4, 5};
+  u64 out[TEST_SMALL_CAPACITY] = {0};
+
+  // A batch that doesn't fit doesn't go in at all
+  passed &= mpsc_queue_push(&queue, in, 5);
+  passed &= !mpsc_queue_push(&queue, in, 5);
+  passed &= mpsc_queue_pop(&queue, out, TEST_SMALL_CAPACITY) == 5 && out[4] == 5;
+
+  // Across the end of the ring
+  for (u32 round = 0; round < 100; round++) {
+    passed &= mpsc_queue_push(&queue, in, 5);
+    passed &= mpsc_queue_pop(&queue, out, TEST_SMALL_CAPACITY) == 5;
+    passed &= out[0] == 1 && out[4] == 5;
+  }
+
+  mpsc_queue_free(&queue);
+  return passed;
+}
+
+// Threads -------------------------------------------------------------------------
+
+translation_local SPSC_Queue spsc_queue;
+translation_local MPSC_Queue mpsc_queue;
+
+translation_local void spsc_producer(void *arg) {
+  u32 rng = (u32)(uintptr_t)arg;
+  u64 batch[TEST_MAX_BATCH];
+
+  for (u64 sent = 0; sent < TEST_STRESS_COUNT;) {
+    u32 count = MIN(1 + random_u32(&rng) % TEST_MAX_BATCH, TEST_STRESS_COUNT - sent);
+    for (u32 i = 0; i < count; i++) {
+      batch[i] = sent + i;
+    }
+    spsc_queue_push_wait(&spsc_queue, batch, count);
+    sent += count;
+  }
+}
+
+// Random batch sizes on both sides, every element has to come out in the order it went in
+translation_local bool check_spsc_threads(void) {
+  spsc_queue = spsc_queue_make_type(TEST_STRESS_CAPACITY, u64);
+  OS_Thread producer = os_thread_make(spsc_producer, (void *)(uintptr_t)0x1234567u);
+
+  bool passed = true;
+  u32 rng = 0x89ABCDEFu;
+  u64 out[TEST_MAX_BATCH];
+  for (u64 expected = 0; expected < TEST_STRESS_COUNT;) {
+    u32 popped = spsc_queue_pop_wait(&spsc_queue, out, 1 + random_u32(&rng) % TEST_MAX_BATCH);
+    for (u32 i = 0; i < popped; i++) {
+      passed &= out[i] == expected++;
+    }
+  }
+
+  os_thread_join(producer);
+  spsc_queue_free(&spsc_queue);
+  return passed;
+}
+
+translation_local void mpsc_producer(void *arg) {
+  u32 producer = (u32)(uintptr_t)arg;
+  u32 rng = 0x9E3779B9u * (producer + 1);
+  u64 batch[TEST_MAX_BATCH];
+
+  u32 per_producer = TEST_STRESS_COUNT / TEST_PRODUCER_COUNT;
+  for (u32 sent = 0; sent < per_producer;) {
+    u32 count = MIN(1 + random_u32(&rng) % TEST_MAX_BATCH, per_producer - sent);
+    for (u32 i = 0; i < count; i++) {
+      batch[i] = ELEMENT_MAKE(producer, sent + i, i);
+    }
+    mpsc_queue_push_wait(&mpsc_queue, batch, count);
+    sent += count;
+  }
+}
+
+// Each producer's stream in order, and every batch in one piece
+translation_local bool check_mpsc_threads(void) {
+  mpsc_queue = mpsc_queue_make_type(TEST_STRESS_CAPACITY, u64);
+
+  OS_Thread producers[TEST_PRODUCER_COUNT];
+  for (u32 i = 0; i < TEST_PRODUCER_COUNT; i++) {
+    producers[i] = os_thread_make(mpsc_producer, (void *)(uintptr_t)i);
+  }
+
+  bool passed = true;
+  u64 next[TEST_PRODUCER_COUNT] = {0};
+  u64 previous = UINT64_MAX;
+  u64 out[TEST_MAX_BATCH];
+  for (u32 received = 0; received < TEST_STRESS_COUNT;) {
+    u32 popped = mpsc_queue_pop_wait(&mpsc_queue, out, TEST_MAX_BATCH);
+    for (u32 i = 0; i < popped; i++) {
+      u32 producer = ELEMENT_PRODUCER(out[i]);
+      passed &= producer < TEST_PRODUCER_COUNT && ELEMENT_SEQUENCE(out[i]) == next[producer]++;
+
+      // Past the first of a batch, the one right before has to be its neighbour from that batch
+      if (ELEMENT_BATCH_OFFSET(out[i]) > 0) {
+        passed &= previous != UINT64_MAX && ELEMENT_PRODUCER(previous) == producer &&
+                  ELEMENT_BATCH_OFFSET(previous) + 1 == ELEMENT_BATCH_OFFSET(out[i]);
+      }
+      previous = out[i];
+    }
+    received += popped;
+  }
+
+  for (u32 i = 0; i < TEST_PRODUCER_COUNT; i++) {
+    os_thread_join(producers[i]);
+  }
+  mpsc_queue_free(&mpsc_queue);
+  return passed;
+}
+
+translation_local void delayed_push(void *arg) {
+  (void)arg;
+  os_sleep_ms(TEST_SLEEP_MS);
+  u64 value = 42;
+  spsc_queue_push_wait(&spsc_queue, &value, 1);
+}
+
+translation_local void delayed_pop(void *arg) {
+  (void)arg;
+  os_sleep_ms(TEST_SLEEP_MS);
+  u64 out[TEST_SMALL_CAPACITY];
+  spsc_queue_pop_wait(&spsc_queue, out, TEST_SMALL_CAPACITY);
+}
+
+// Long enough that the waiting side is asleep on the futex and not spinning, it has to be woken.
+// If a wake is lost this never returns
+translation_local bool check_wake(void) {
+  spsc_queue = spsc_queue_make_type(TEST_SMALL_CAPACITY, u64);
+  bool passed = true;
+
+  OS_Thread pusher = os_thread_make(delayed_push, NULL);
+  u64 value = 0;
+  passed &= spsc_queue_pop_wait(&spsc_queue, &value, 1) == 1 && value == 42;
+  os_thread_join(pusher);
+
+  // Full, and the push blocks until the other side makes room
+  u64 fill[TEST_SMALL_CAPACITY + 1] = {0};
+  passed &= spsc_queue_push(&spsc_queue, fill, TEST_SMALL_CAPACITY) == TEST_SMALL_CAPACITY;
+  OS_Thread popper = os_thread_make(delayed_pop, NULL);
+  spsc_queue_push_wait(&spsc_queue, fill, 1);
+  os_thread_join(popper);
+  passed &= spsc_queue_pop(&spsc_queue, fill, TEST_SMALL_CAPACITY) == 1;
+
+  spsc_queue_free(&spsc_queue);
+  return passed;
+}
+
+// Benchmark -------------------------------------------------------------------
+
+translation_local u32 bench_batch;
+translation_local SPSC_Queue bench_reply;
+
+translation_local void bench_spsc_producer(void *arg) {
+  (void)arg;
+  u64 batch[TEST_MAX_BATCH] = {0};
+  for (u32 sent = 0; sent < TEST_BENCH_COUNT; sent += bench_batch) {
+    spsc_queue_push_wait(&spsc_queue, batch, bench_batch);
+  }
+}
+
+translation_local void bench_mpsc_producer(void *arg) {
+  (void)arg;
+  u64 batch[TEST_MAX_BATCH] = {0};
+  for (u32 sent = 0; sent < TEST_BENCH_COUNT / TEST_PRODUCER_COUNT; sent += bench_batch) {
+    mpsc_queue_push_wait(&mpsc_queue, batch, bench_batch);
+  }
+}
+
+translation_local void bench_echo(void *arg) {
+  (void)arg;
+  u64 value = 0;
+  for (u32 i = 0; i < TEST_BENCH_ROUND_TRIPS; i++) {
+    spsc_queue_pop_wait(&spsc_queue, &value, 1);
+    spsc_queue_push_wait(&bench_reply, &value, 1);
+  }
+}
+
+translation_local void bench(void) {
+  u64 out[TEST_MAX_BATCH];
+
+  u32 batches[] = {1, 32};
+  for (u32 b = 0; b < STATIC_ARRAY_COUNT(batches); b++) {
+    bench_batch = batches[b];
+
+    spsc_queue = spsc_queue_make_type(TEST_BENCH_CAPACITY, u64);
+    u64 start = get_time_ns();
+    OS_Thread producer = os_thread_make(bench_spsc_producer, NULL);
+    for (u32 received = 0; received < TEST_BENCH_COUNT;) {
+      received += spsc_queue_pop_wait(&spsc_queue, out, TEST_MAX_BATCH);
+    }
+    os_thread_join(producer);
+    f64 seconds = (f64)(get_time_ns() - start) / NSEC_PER_SEC;
+    printf("  spsc batch %2u              %8.1f M/s\n", bench_batch,
+           TEST_BENCH_COUNT / seconds / 1e6);
+    spsc_queue_free(&spsc_queue);
+
+    mpsc_queue = mpsc_queue_make_type(TEST_BENCH_CAPACITY, u64);
+    start = get_time_ns();
+    OS_Thread producers[TEST_PRODUCER_COUNT];
+    for (u32 i = 0; i < TEST_PRODUCER_COUNT; i++) {
+      producers[i] = os_thread_make(bench_mpsc_producer, NULL);
+    }
+    for (u32 received = 0; received < TEST_BENCH_COUNT;) {
+      received += mpsc_queue_pop_wait(&mpsc_queue, out, TEST_MAX_BATCH);
+    }
+    for (u32 i = 0; i < TEST_PRODUCER_COUNT; i++) {
+      os_thread_join(producers[i]);
+    }
+    seconds = (f64)(get_time_ns() - start) / NSEC_PER_SEC;
+    printf("  mpsc %u producers batch %2u %8.1f M/s\n", TEST_PRODUCER_COUNT, bench_batch,
+           TEST_BENCH_COUNT / seconds / 1e6);
+    mpsc_queue_free(&mpsc_queue);
+  }
+
+  // One element there and back, the latency of handing something to another thread and hearing back
+  spsc_queue = spsc_queue_make_type(TEST_SMALL_CAPACITY, u64);
+  bench_reply = spsc_queue_make_type(TEST_SMALL_CAPACITY, u64);
+  OS_Thread echo = os_thread_make(bench_echo, NULL);
+  u64 start = get_time_ns();
+  for (u64 i = 0; i < TEST_BENCH_ROUND_TRIPS; i++) {
+    spsc_queue_push_wait(&spsc_queue, &i, 1);
+    spsc_queue_pop_wait(&bench_reply, out, 1);
+  }
+  f64 us = (f64)(get_time_ns() - start) / 1e3 / TEST_BENCH_ROUND_TRIPS;
+  os_thread_join(echo);
+  printf("  spsc round trip            %8.2f us\n", us);
+  spsc_queue_free(&bench_reply);
+  spsc_queue_free(&spsc_queue);
+}
+
+int main(int argc, char **argv) {
+  Thread_Context tctx;
+  thread_context_init(&tctx, "main");
+  printf("ring_queue_test\n");
+
+  bool passed = report("spsc batches", check_spsc_batches());
+  passed &= report("mpsc batches", check_mpsc_batches());
+  passed &= report("spsc threaded order", check_spsc_threads());
+  passed &= report("mpsc threaded order", check_mpsc_threads());
+  passed &= report("futex wake", check_wake());
+
+  // Timing is slow and noisy, only when asked
+  if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+    bench();
+  }
+
+  thread_context_free();
+
+  printf("%s\n", passed ? "PASSED" : "FAILED");
+  return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
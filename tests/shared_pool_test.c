@@ -0,0 +1,259 @@
+// Checks Shared_Pool from one thread and then hammers it from several, handing blocks between
+// threads so they get popped into magazines other than the one they came out of. With --bench,
+// times alloc/free bursts against a mutex around a plain Pool for 1 to 8 threads
+
+#include "core/pool.h"
+#include "core/shared_pool.h"
+#include "core/thread_context.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+enum Test_Constants {
+  TEST_CAPACITY = 4096,
+  TEST_THREAD_COUNT = 4,
+  TEST_STRESS_ITERATIONS = 200000, // Per thread
+  TEST_STRESS_SLOTS = 256,         // Hand off spots, fewer than the pool so it never runs dry
+  TEST_BENCH_MAX_THREADS = 8,
+  TEST_BENCH_ITERATIONS = 100000, // Per thread
+  TEST_BENCH_BURST = 16,          // Blocks held at once by each thread
+};
+
+typedef struct Test_Block Test_Block;
+struct Test_Block {
+  alignas(64) u64 stamp;
+  u64 check; // ~stamp, anything else means two owners wrote to it
+  u64 padding[6];
+};
+
+translation_local bool report(const char *name, bool passed) {
+  printf("  %-24s %s\n", name, passed ? "ok" : "FAILED");
+  return passed;
+}
+
+// Single Thread -----------------------------------------------------------------
+
+// Every block handed out once, zeroed, aligned and distinct, then all of them again after popping
+translation_local bool check_capacity(void) {
+  Shared_Pool pool = shared_pool_make_type(TEST_CAPACITY, Test_Block);
+  bool passed = true;
+
+  Test_Block **blocks = malloc(TEST_CAPACITY * sizeof(*blocks));
+  for (u32 round = 0; round < 2; round++) {
+    for (u32 i = 0; i < TEST_CAPACITY; i++) {
+      blocks[i] = shared_pool_alloc(&pool);
+      passed &= ((uintptr_t)blocks[i] & (alignof(Test_Block) - 1)) == 0;
+      passed &= blocks[i]->stamp == 0 && blocks[i]->check == 0;
+      blocks[i]->stamp = i + 1;
+    }
+
+    // Stamps would have been overwritten if any block came out twice
+    for (u32 i = 0; i < TEST_CAPACITY; i++) {
+      passed &= blocks[i]->stamp == i + 1;
+      shared_pool_pop(&pool, blocks[i]);
+    }
+  }
+
+  free(blocks);
+  shared_pool_free(&pool);
+  return passed;
+}
+
+// A new pool made where an old one was must not see indices left in the old one's magazine
+translation_local bool check_pool_reuse(void) {
+  Shared_Pool pool = shared_pool_make(16, 64, 8);
+  shared_pool_pop(&pool, shared_pool_alloc(&pool));
+  shared_pool_free(&pool);
+
+  pool = shared_pool_make(4, 64, 8);
+  bool passed = true;
+  void *blocks[4];
+  for (u32 i = 0; i < 4; i++) {
+    blocks[i] = shared_pool_alloc(&pool);
+    for (u32 j = 0; j < i; j++) {
+      passed &= blocks[j] != blocks[i];
+    }
+  }
+
+  shared_pool_free(&pool);
+  return passed;
+}
+
+// Stress --------------------------------------------------------------------------
+
+translation_local Shared_Pool stress_pool;
+translation_local _Atomic(Test_Block *) stress_slots[TEST_STRESS_SLOTS];
+translation_local _Atomic u8 stress_in_use[TEST_CAPACITY];
+translation_local _Atomic u32 stress_errors;
+
+translation_local u32 stress_index(Test_Block *block) {
+  return (u32)(block - (Test_Block *)stress_pool.blocks);
+}
+
+translation_local Test_Block *stress_alloc(u64 stamp) {
+  Test_Block *block = shared_pool_alloc(&stress_pool);
+  if (atomic_exchange(&stress_in_use[stress_index(block)], 1) != 0 || block->stamp != 0) {
+    atomic_fetch_add(&stress_errors, 1);
+  }
+
+  block->stamp = stamp;
+  block->check = ~stamp;
+  return block;
+}
+
+translation_local void stress_pop(Test_Block *block) {
+  if (block->check != ~block->stamp ||
+      atomic_exchange(&stress_in_use[stress_index(block)], 0) != 1) {
+    atomic_fetch_add(&stress_errors, 1);
+  }
+
+  shared_pool_pop(&stress_pool, block);
+}
+
+// Swaps blocks in and out of the shared slots, so most blocks get popped by a thread other than the
+// one that allocated them
+translation_local void *stress_worker(void *arg) {
+  u32 thread_index = (u32)(uintptr_t)arg;
+  Thread_Context tctx;
+  thread_context_init(&tctx, "stress");
+
+  u32 rng = 0x9E3779B9u * (thread_index + 1);
+  for (u32 i = 0; i < TEST_STRESS_ITERATIONS; i++) {
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+
+    Test_Block *taken = atomic_exchange(&stress_slots[rng % TEST_STRESS_SLOTS], NULL);
+    if (taken != NULL) {
+      stress_pop(taken);
+    } else {
+      Test_Block *block = stress_alloc(((u64)thread_index << 32) | i);
+      Test_Block *evicted = atomic_exchange(&stress_slots[rng % TEST_STRESS_SLOTS], block);
+      if (evicted != NULL) {
+        stress_pop(evicted);
+      }
+    }
+  }
+
+  // Flushes this thread's magazine back to the pool
+  thread_context_free();
+  return NULL;
+}
+
+translation_local bool check_stress(void) {
+  stress_pool = shared_pool_make_type(TEST_CAPACITY, Test_Block);
+
+  pthread_t threads[TEST_THREAD_COUNT];
+  for (u32 i = 0; i < TEST_THREAD_COUNT; i++) {
+    pthread_create(&threads[i], NULL, stress_worker, (void *)(uintptr_t)i);
+  }
+  for (u32 i = 0; i < TEST_THREAD_COUNT; i++) {
+    pthread_join(threads[i], NULL);
+  }
+
+  for (u32 i = 0; i < TEST_STRESS_SLOTS; i++) {
+    Test_Block *block = atomic_exchange(&stress_slots[i], NULL);
+    if (block != NULL) {
+      stress_pop(block);
+    }
+  }
+
+  // Every block made it back through the magazines, none lost and none doubled up
+  for (u32 i = 0; i < TEST_CAPACITY; i++) {
+    stress_alloc(i);
+  }
+
+  shared_pool_free(&stress_pool);
+  return atomic_load(&stress_errors) == 0;
+}
+
+// Benchmark -------------------------------------------------------------------
+
+translation_local Shared_Pool bench_shared_pool;
+translation_local Pool bench_pool;
+translation_local pthread_mutex_t bench_mutex = PTHREAD_MUTEX_INITIALIZER;
+translation_local bool bench_use_shared;
+
+translation_local void *bench_worker(void *arg) {
+  (void)arg;
+  Thread_Context tctx;
+  thread_context_init(&tctx, "bench");
+
+  Test_Block *held[TEST_BENCH_BURST];
+  for (u32 i = 0; i < TEST_BENCH_ITERATIONS; i++) {
+    for (u32 j = 0; j < TEST_BENCH_BURST; j++) {
+      if (bench_use_shared) {
+        held[j] = shared_pool_alloc(&bench_shared_pool);
+      } else {
+        pthread_mutex_lock(&bench_mutex);
+        held[j] = pool_alloc(&bench_pool);
+        pthread_mutex_unlock(&bench_mutex);
+      }
+    }
+
+    for (u32 j = 0; j < TEST_BENCH_BURST; j++) {
+      if (bench_use_shared) {
+        shared_pool_pop(&bench_shared_pool, held[j]);
+      } else {
+        pthread_mutex_lock(&bench_mutex);
+        pool_pop(&bench_pool, held[j]);
+        pthread_mutex_unlock(&bench_mutex);
+      }
+    }
+  }
+
+  thread_context_free();
+  return NULL;
+}
+
+// Millions of alloc + pop pairs a second, across all threads
+translation_local f64 bench_run(u32 thread_count, bool use_shared) {
+  bench_use_shared = use_shared;
+
+  u64 start = get_time_ns();
+  pthread_t threads[TEST_BENCH_MAX_THREADS];
+  for (u32 i = 0; i < thread_count; i++) {
+    pthread_create(&threads[i], NULL, bench_worker, NULL);
+  }
+  for (u32 i = 0; i < thread_count; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  f64 seconds = (f64)(get_time_ns() - start) / NSEC_PER_SEC;
+
+  return (f64)thread_count * TEST_BENCH_ITERATIONS * TEST_BENCH_BURST / seconds / 1e6;
+}
+
+translation_local void bench(void) {
+  bench_shared_pool = shared_pool_make_type(TEST_CAPACITY, Test_Block);
+  bench_pool = pool_make_type(TEST_CAPACITY, Test_Block);
+
+  for (u32 thread_count = 1; thread_count <= TEST_BENCH_MAX_THREADS; thread_count *= 2) {
+    printf("  %u threads: shared_pool %7.1f M/s, mutex + pool %7.1f M/s\n", thread_count,
+           bench_run(thread_count, true), bench_run(thread_count, false));
+  }
+
+  pool_free(&bench_pool);
+  shared_pool_free(&bench_shared_pool);
+}
+
+int main(int argc, char **argv) {
+  Thread_Context tctx;
+  thread_context_init(&tctx, "main");
+  printf("shared_pool_test\n");
+
+  bool passed = report("capacity", check_capacity());
+  passed &= report("pool reuse", check_pool_reuse());
+  passed &= report("threaded hand off", check_stress());
+
+  // Timing is slow and noisy, only when asked
+  if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+    bench();
+  }
+
+  thread_context_free();
+
+  printf("%s\n", passed ? "PASSED" : "FAILED");
+  return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
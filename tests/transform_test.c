@@ -0,0 +1,203 @@
+// Checks the batch kernels against the per entity path they replace, at every tail length and with
+// parented, non uniformly scaled worlds, then with --bench times both for 1k and 100k entities
+
+#include "game/transform.h"
+#include "os/os.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+enum Test_Constants {
+  TEST_ENTITY_COUNT = 1000,
+  TEST_BENCH_RUNS = 30, // Best of
+};
+
+// Relative to the biggest element, the batch sums in the same order so this should stay at 0
+#define TEST_MAX_ERROR 1e-6f
+
+translation_local u32 rng_state = 12345;
+
+// xorshift32, same sequence every run
+translation_local u32 random_u32(void) {
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 17;
+  rng_state ^= rng_state << 5;
+  return rng_state;
+}
+
+translation_local f32 random_f32(f32 min, f32 max) {
+  return min + (max - min) * (f32)(random_u32() >> 8) / (f32)(1 << 24);
+}
+
+translation_local bool report(const char *name, bool passed) {
+  printf("  %-24s %s\n", name, passed ? "ok" : "FAILED");
+  return passed;
+}
+
+translation_local f32 max_error(const f32 *expected, const f32 *got, u32 count) {
+  f32 biggest = 0.0f, error = 0.0f;
+  for (u32 i = 0; i < count; i++) {
+    biggest = MAX(biggest, fabsf(expected[i]));
+    error = MAX(error, fabsf(expected[i] - got[i]));
+  }
+
+  return biggest > 0.0f ? error / biggest : error;
+}
+
+// Every other entity is parented to the one before it, so some worlds have shear in them
+translation_local void make_entities(Transform *transforms, Transform_Matrices *matrices,
+                                     u32 count) {
+  for (u32 i = 0; i < count; i++) {
+    vec3 axis = vec3_norm(vec3(random_f32(-1, 1), random_f32(-1, 1), random_f32(0.1f, 1)));
+    transforms[i] = transform_make(
+        vec3(random_f32(-100, 100), random_f32(-100, 100), random_f32(-100, 100)),
+        quat_from_axis_angle(axis, random_f32(-PI, PI)),
+        vec3(random_f32(0.1f, 4), random_f32(0.1f, 4), random_f32(0.1f, 4)));
+
+    bool parented = i % 2 == 1;
+    transform_update(&transforms[i], &matrices[i], parented ? &transforms[i - 1] : NULL,
+                     parented ? &matrices[i - 1] : NULL);
+  }
+}
+
+// Every count up to a couple of batches past a full one, so each tail length gets a go, and only
+// the count asked for gets written
+translation_local bool check_clip(void) {
+  Transform transforms[TEST_ENTITY_COUNT];
+  Transform_Matrices matrices[TEST_ENTITY_COUNT];
+  make_entities(transforms, matrices, TEST_ENTITY_COUNT);
+
+  mat4 proj_view = mat4_mul(mat4_perspective(RADIANS(70.0f), 16.0f / 9.0f, 0.1f, 1000.0f),
+                            mat4_look_at(vec3(3, 4, 5), vec3(0, 0, 0), vec3(0, 1, 0)));
+  mat4 expected[TEST_ENTITY_COUNT];
+  for (u32 i = 0; i < TEST_ENTITY_COUNT; i++) {
+    expected[i] = mat4_mul(proj_view, matrices[i].world);
+  }
+
+  bool passed = true;
+  mat4 clip[TEST_ENTITY_COUNT + 1];
+  for (u32 count = 0; count <= 3 * TRANSFORM_BATCH_LANES; count++) {
+    memset(clip, 0xFF, sizeof(clip));
+    transform_clip_batch(matrices, count, proj_view, clip);
+
+    passed &= max_error(expected[0].m[0], clip[0].m[0], count * 16) <= TEST_MAX_ERROR;
+    passed &= isnan(clip[count].m[0][0]);
+  }
+
+  transform_clip_batch(matrices, TEST_ENTITY_COUNT, proj_view, clip);
+  f32 error = max_error(expected[0].m[0], clip[0].m[0], TEST_ENTITY_COUNT * 16);
+  printf("  clip max relative error %g\n", error);
+
+  return passed && error <= TEST_MAX_ERROR;
+}
+
+// Only the rows asked for get rebuilt, in whatever order they come
+translation_local bool check_normal(void) {
+  Transform transforms[TEST_ENTITY_COUNT];
+  Transform_Matrices matrices[TEST_ENTITY_COUNT];
+  make_entities(transforms, matrices, TEST_ENTITY_COUNT);
+
+  Transform_Matrices expected[TEST_ENTITY_COUNT];
+  memcpy(expected, matrices, sizeof(matrices));
+
+  u32 rows[TEST_ENTITY_COUNT];
+  u32 row_count = 0;
+  for (u32 i = TEST_ENTITY_COUNT; i-- > 0;) {
+    matrices[i].normal = (mat3x4){0};
+    if (i % 3 != 0) {
+      rows[row_count++] = i;
+    }
+  }
+  transform_normal_batch(matrices, rows, row_count);
+
+  bool passed = true;
+  f32 error = 0.0f;
+  for (u32 i = 0; i < TEST_ENTITY_COUNT; i++) {
+    if (i % 3 == 0) {
+      passed &= memcmp(&matrices[i].normal, &(mat3x4){0}, sizeof(mat3x4)) == 0;
+    } else {
+      error = MAX(error, max_error(expected[i].normal.m[0], matrices[i].normal.m[0], 12));
+    }
+  }
+  printf("  normal max relative error %g\n", error);
+
+  return passed && error <= TEST_MAX_ERROR;
+}
+
+// Benchmark -------------------------------------------------------------------
+
+translation_local f64 bench_best_ns(u64 *best, u64 start, u32 count) {
+  *best = MIN(*best, get_time_ns() - start);
+  return (f64)*best / count;
+}
+
+translation_local void bench(void) {
+  u32 counts[] = {1000, 100000};
+  for (u32 c = 0; c < STATIC_ARRAY_COUNT(counts); c++) {
+    u32 count = counts[c];
+    Transform *transforms = malloc(count * sizeof(Transform));
+    Transform_Matrices *matrices = aligned_alloc(64, count * sizeof(Transform_Matrices));
+    mat4 *clip = aligned_alloc(64, count * sizeof(mat4));
+    u32 *rows = malloc(count * sizeof(u32));
+    make_entities(transforms, matrices, count);
+    for (u32 i = 0; i < count; i++) {
+      rows[i] = i;
+    }
+
+    mat4 proj_view = mat4_perspective(RADIANS(90.0f), 16.0f / 9.0f, 0.1f, 1000.0f);
+    u64 best[4] = {UINT64_MAX, UINT64_MAX, UINT64_MAX, UINT64_MAX};
+    f64 ns[4];
+    for (u32 run = 0; run < TEST_BENCH_RUNS; run++) {
+      u64 start = get_time_ns();
+      for (u32 i = 0; i < count; i++) {
+        clip[i] = mat4_mul(proj_view, matrices[i].world);
+      }
+      __asm__ volatile("" : : "g"(clip) : "memory");
+      ns[0] = bench_best_ns(&best[0], start, count);
+
+      start = get_time_ns();
+      transform_clip_batch(matrices, count, proj_view, clip);
+      __asm__ volatile("" : : "g"(clip) : "memory");
+      ns[1] = bench_best_ns(&best[1], start, count);
+
+      start = get_time_ns();
+      for (u32 i = 0; i < count; i++) {
+        matrices[i].normal = mat3_to_mat3x4(mat4_normal_mat3(matrices[i].world));
+      }
+      __asm__ volatile("" : : "g"(matrices) : "memory");
+      ns[2] = bench_best_ns(&best[2], start, count);
+
+      start = get_time_ns();
+      transform_normal_batch(matrices, rows, count);
+      __asm__ volatile("" : : "g"(matrices) : "memory");
+      ns[3] = bench_best_ns(&best[3], start, count);
+    }
+
+    printf("  %6u entities: clip per entity %5.2f ns, batch %5.2f ns (%.2fx)\n", count, ns[0],
+           ns[1], ns[0] / ns[1]);
+    printf("  %6u entities: normal per entity %5.2f ns, batch %5.2f ns (%.2fx)\n", count, ns[2],
+           ns[3], ns[2] / ns[3]);
+
+    free(transforms);
+    free(matrices);
+    free(clip);
+    free(rows);
+  }
+}
+
+int main(int argc, char **argv) {
+  printf("transform_test\n");
+
+  bool passed = report("clip batch", check_clip());
+  passed &= report("normal batch", check_normal());
+
+  // Timing is slow and noisy, only when asked
+  if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+    bench();
+  }
+
+  printf("%s\n", passed ? "PASSED" : "FAILED");
+  return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}